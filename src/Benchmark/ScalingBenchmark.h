@@ -0,0 +1,216 @@
+#ifndef BENCHMARK_SCALINGBENCHMARK_H
+#define BENCHMARK_SCALINGBENCHMARK_H
+
+#include "../GeneticAlgorithm/Multithreading.h"
+#include <vector>
+#include <string>
+#include <ostream>
+#include <iomanip>
+#include <chrono>
+#include <algorithm>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+namespace Benchmark {
+
+    /* 端到端的扩展性测试
+     *
+     * 对线程数、种群大小、染色体长度组成的网格中的每一格，用固定的随机数种子和固定的代数
+     * 运行 GeneticAlgorithm::Multithreading（每个线程一个种群，总工作量随线程数增长），
+     * 记录每秒代数、每秒计算的个体数、峰值内存和并行效率。每一格在 fork() 出来的子进程
+     * 中运行，峰值内存用 wait4() 得到的子进程 ru_maxrss ，互不影响。
+     *
+     * 并行效率 = 每个线程每秒计算的个体数 / 同一种群大小和长度下线程数最少的那一格的对应值，
+     * 线程数从 1 开始时就是通常的 E(T) / (T * E(1)) 。
+     *
+     * 结果是空格分隔的表格，第一行以 # 开头，可以直接给 gnuplot 或者 pandas 读取。
+     * 注意多个线程共用全局的随机数引擎，线程数大于 1 时每次运行的结果不完全相同。
+     */
+    class ScalingBenchmark {
+
+    public:
+
+        // 一格的结果
+        struct Result {
+            unsigned long threads;
+            unsigned long population;
+            unsigned long length;
+            unsigned long generations;
+            unsigned long evaluations;
+            double seconds;
+            double generationsPerSecond;
+            double evaluationsPerSecond;
+            long peakRss; // KB
+            double efficiency;
+        };
+
+        ScalingBenchmark() {
+            unsigned long hardware = std::thread::hardware_concurrency();
+            for (unsigned long threads = 1; threads <= (hardware < 1 ? 1 : hardware); threads *= 2) {
+                this->threads.push_back(threads);
+            }
+            this->populations = {250, 1000};
+            this->lengths = {25, 50, 100};
+        }
+
+        // 设置要测试的线程数
+        void setThreads(const std::vector<unsigned long>& threads) {
+            this->threads = threads;
+        }
+
+        // 设置要测试的种群大小
+        void setPopulations(const std::vector<unsigned long>& populations) {
+            this->populations = populations;
+        }
+
+        // 设置要测试的染色体长度
+        void setLengths(const std::vector<unsigned long>& lengths) {
+            this->lengths = lengths;
+        }
+
+        // 设置每一格运行的代数
+        void setGenerations(unsigned long generations) {
+            this->generations = generations < 1 ? 1 : generations;
+        }
+
+        // 设置随机数种子，每一格的第 i 个岛使用 seed + i
+        void setSeed(unsigned long seed) {
+            this->seed = seed;
+        }
+
+        /**
+         * 运行整个网格，每测完一格就往 out 写一行
+         *
+         * @param std::ostream& out
+         * @return std::vector<Result>
+         */
+        std::vector<Result> run(std::ostream& out) {
+            using namespace std;
+            if (this->threads.empty() || this->populations.empty() || this->lengths.empty()) {
+                throw "Error, empty grid, in Benchmark::ScalingBenchmark::run().";
+            }
+            vector<unsigned long> threads = this->threads;
+            sort(threads.begin(), threads.end());
+            threads.erase(unique(threads.begin(), threads.end()), threads.end());
+            if (0 == threads[0]) {
+                throw "Error, threads must be greater than 0, in Benchmark::ScalingBenchmark::run().";
+            }
+            vector<Result> results;
+            writeHeader(out);
+            for (unsigned long population : this->populations) {
+                for (unsigned long length : this->lengths) {
+                    double baseline = 0.0;
+                    for (unsigned long threadNumber : threads) {
+                        Result result = this->measure(threadNumber, population, length);
+                        double perThread = result.evaluationsPerSecond / result.threads;
+                        if (threadNumber == threads[0]) {
+                            baseline = perThread;
+                        }
+                        result.efficiency = baseline > 0 ? perThread / baseline : 0.0;
+                        writeRow(out, result);
+                        results.push_back(result);
+                    }
+                }
+            }
+            return results;
+        }
+
+        // 写表头
+        static void writeHeader(std::ostream& out) {
+            out << "# threads population length generations evaluations seconds generations_per_sec evaluations_per_sec peak_rss_kb efficiency" << std::endl;
+        }
+
+        // 写一行
+        static void writeRow(std::ostream& out, const Result& result) {
+            std::ios_base::fmtflags flags = out.flags();
+            std::streamsize precision = out.precision();
+            out << result.threads << ' ' << result.population << ' ' << result.length << ' '
+                << result.generations << ' ' << result.evaluations << ' '
+                << std::fixed << std::setprecision(4) << result.seconds << ' '
+                << std::setprecision(2) << result.generationsPerSecond << ' ' << result.evaluationsPerSecond << ' '
+                << result.peakRss << ' ' << std::setprecision(3) << result.efficiency << std::endl;
+            out.flags(flags);
+            out.precision(precision);
+        }
+
+    private:
+
+        // 线程数
+        std::vector<unsigned long> threads;
+        // 种群大小
+        std::vector<unsigned long> populations;
+        // 染色体长度
+        std::vector<unsigned long> lengths;
+        // 每一格的代数
+        unsigned long generations = 20;
+        // 随机数种子
+        unsigned long seed = 20210801;
+
+        // 私有，在子进程中测一格
+        Result measure(unsigned long threadNumber, unsigned long population, unsigned long length) {
+            int channel[2];
+            if (0 != pipe(channel)) {
+                throw "Error, pipe() failed, in Benchmark::ScalingBenchmark::measure().";
+            }
+            pid_t child = fork();
+            if (child < 0) {
+                close(channel[0]);
+                close(channel[1]);
+                throw "Error, fork() failed, in Benchmark::ScalingBenchmark::measure().";
+            }
+            if (0 == child) {
+                close(channel[0]);
+                Result result = this->work(threadNumber, population, length);
+                bool written = sizeof(result) == write(channel[1], &result, sizeof(result));
+                _exit(written ? 0 : 1);
+            }
+            close(channel[1]);
+            Result result;
+            ssize_t received = read(channel[0], &result, sizeof(result));
+            close(channel[0]);
+            int status = 0;
+            struct rusage usage;
+            while (wait4(child, &status, 0, &usage) < 0 && EINTR == errno) {
+            }
+            if (sizeof(result) != received || !WIFEXITED(status) || 0 != WEXITSTATUS(status)) {
+                throw "Error, benchmark child process failed, in Benchmark::ScalingBenchmark::measure().";
+            }
+            result.peakRss = usage.ru_maxrss;
+            return result;
+        }
+
+        // 私有，子进程中运行，stopFitness 大于 1 所以一定运行满 generations 代
+        Result work(unsigned long threadNumber, unsigned long population, unsigned long length) {
+            unsigned long keep = population / 2;
+            Result result;
+            result.threads = threadNumber;
+            result.population = population;
+            result.length = length;
+            result.efficiency = 0.0;
+            result.peakRss = 0;
+            GeneticAlgorithm::Multithreading process(threadNumber);
+            // 每个岛有自己的随机数引擎，第 i 个岛的种子是 seed + i
+            process.seed(this->seed);
+            auto begin = std::chrono::steady_clock::now();
+            try {
+                process.run(population, length, 0.0L, 4.0L, this->generations, 2.0L, keep, 0.1L);
+            } catch (const char*) {
+                _exit(2);
+            }
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            result.generations = process.getLoopNumber();
+            // 初始种群每个个体计算一次，之后每代计算 population - keep 个新个体
+            result.evaluations = threadNumber * (population + result.generations * (population - keep));
+            result.generationsPerSecond = result.seconds > 0 ? result.generations / result.seconds : 0.0;
+            result.evaluationsPerSecond = result.seconds > 0 ? result.evaluations / result.seconds : 0.0;
+            return result;
+        }
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,268 @@
+#include "GepApi.h"
+#include "../GeneticAlgorithm/MainProcess.h"
+#include "../GeneticAlgorithm/ChromosomeFactory.h"
+#include "../Expression/Program.h"
+#include "../Expression/Parser.h"
+#include "../Data/Dataset.h"
+#include "../Fitness/Objective.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <sstream>
+#include <cstring>
+#include <exception>
+
+struct gep_job {
+    // 数据集要比适应度函数活得长，成员按这个顺序构造和析构。适应度函数和随机数引擎都属于
+    // 这个任务（ MainProcess 的 EvolutionContext ），不同的任务可以在不同的线程里同时训练
+    Data::Dataset dataset;
+    std::unique_ptr<Fitness::Objective> objective;
+    GeneticAlgorithm::MainProcess process;
+    gep_job_options options;
+    std::string metric;
+};
+
+struct gep_model {
+    Expression::Program program;
+};
+
+namespace {
+
+    thread_local std::string lastError;
+
+    // 私有，记录失败的原因
+    void fail(const char* message) {
+        lastError = nullptr == message ? "Error, unknown failure." : message;
+    }
+
+    // 私有，按块打分，columns 只偏移指针，不复制数据
+    template<class T>
+    int score(const gep_model* model, const T* const* columns, size_t variables, size_t rows, T* output) {
+        if (nullptr == model || nullptr == output || (nullptr == columns && variables > 0)) {
+            fail("Error, null argument, in gep_model_score().");
+            return -1;
+        }
+        if ((size_t)model->program.getVariableNumber() > variables) {
+            fail("Error, model uses more variables than given, in gep_model_score().");
+            return -1;
+        }
+        const unsigned long blockRows = 1024;
+        static thread_local std::vector<T> workspace;
+        std::vector<const T*> block(variables);
+        try {
+            for (size_t begin = 0; begin < rows; begin += blockRows) {
+                size_t count = rows - begin < blockRows ? rows - begin : blockRows;
+                for (size_t j = 0; j < variables; j++) {
+                    block[j] = columns[j] + begin;
+                }
+                model->program.evaluateBlock<T>(block.data(), count, output + begin, workspace);
+            }
+        } catch (const char* message) {
+            fail(message);
+            return -1;
+        } catch (const std::exception& e) {
+            fail(e.what());
+            return -1;
+        } catch (...) {
+            fail("Error, unknown exception, in gep_model_score().");
+            return -1;
+        }
+        return 0;
+    }
+
+}
+
+extern "C" {
+
+void gep_job_options_init(gep_job_options* options) {
+    if (nullptr == options) {
+        return;
+    }
+    options->metric = "mse";
+    options->population = 1000;
+    options->length = 50;
+    options->min = -2.0;
+    options->max = 2.0;
+    options->keep = 500;
+    options->mutation_rate = 0.1;
+    options->stop_fitness = 1.0;
+    options->seed = 0;
+}
+
+gep_job* gep_job_create(const double* features, const double* targets, size_t rows, size_t variables, const gep_job_options* options) {
+    if ((nullptr == features && variables > 0) || nullptr == targets || 0 == rows) {
+        fail("Error, empty dataset, in gep_job_create().");
+        return nullptr;
+    }
+    std::unique_ptr<gep_job> job;
+    try {
+        job.reset(new gep_job());
+        gep_job_options_init(&job->options);
+        if (nullptr != options) {
+            job->options = *options;
+        }
+        job->metric = nullptr == job->options.metric ? "mse" : job->options.metric;
+        job->options.metric = job->metric.c_str();
+        if (job->options.keep >= job->options.population) {
+            fail("Error, keep must be less than population, in gep_job_create().");
+            return nullptr;
+        }
+        job->dataset = Data::Dataset(variables);
+        std::vector<long double> row(variables);
+        for (size_t i = 0; i < rows; i++) {
+            for (size_t j = 0; j < variables; j++) {
+                row[j] = features[i * variables + j];
+            }
+            job->dataset.addRow(row.data(), targets[i]);
+        }
+        job->objective.reset(Fitness::Objective::create(job->metric, job->dataset));
+        job->process.setDebug(false);
+        job->process.setObjective(job->objective.get());
+        if (0 != job->options.seed) {
+            job->process.seed(job->options.seed);
+        }
+        // 最大迭代次数为 0 ，只生成并计算初始种群
+        job->process.run(job->options.population, job->options.length, job->options.min, job->options.max, 0,
+            job->options.stop_fitness, job->options.keep, job->options.mutation_rate);
+    } catch (const char* message) {
+        fail(message);
+        return nullptr;
+    } catch (const std::exception& e) {
+        fail(e.what());
+        return nullptr;
+    } catch (...) {
+        fail("Error, unknown exception, in gep_job_create().");
+        return nullptr;
+    }
+    return job.release();
+}
+
+int gep_job_step(gep_job* job, unsigned long generations) {
+    if (nullptr == job) {
+        fail("Error, null job, in gep_job_step().");
+        return -1;
+    }
+    try {
+        job->process.runContinue(generations, job->options.stop_fitness, job->options.keep, job->options.mutation_rate);
+    } catch (const char* message) {
+        fail(message);
+        return -1;
+    } catch (const std::exception& e) {
+        fail(e.what());
+        return -1;
+    } catch (...) {
+        fail("Error, unknown exception, in gep_job_step().");
+        return -1;
+    }
+    return 0;
+}
+
+unsigned long gep_job_generation(const gep_job* job) {
+    return nullptr == job ? 0 : const_cast<gep_job*>(job)->process.getLoopNumber();
+}
+
+double gep_job_best_fitness(const gep_job* job) {
+    return nullptr == job ? 0.0 : (double)const_cast<gep_job*>(job)->process.getMaxFitness();
+}
+
+gep_model* gep_job_champion(gep_job* job) {
+    if (nullptr == job) {
+        fail("Error, null job, in gep_job_champion().");
+        return nullptr;
+    }
+    try {
+        std::unique_ptr<gep_model> model(new gep_model());
+        model->program = job->process.getMaxFitnessChromosome()->compile().simplify();
+        return model.release();
+    } catch (const char* message) {
+        fail(message);
+        return nullptr;
+    } catch (const std::exception& e) {
+        fail(e.what());
+        return nullptr;
+    } catch (...) {
+        fail("Error, unknown exception, in gep_job_champion().");
+        return nullptr;
+    }
+}
+
+size_t gep_job_champion_save(gep_job* job, char* buffer, size_t size) {
+    if (nullptr == job) {
+        fail("Error, null job, in gep_job_champion_save().");
+        return 0;
+    }
+    std::string text;
+    try {
+        std::ostringstream output;
+        job->process.getMaxFitnessChromosome()->save(output);
+        text = output.str();
+    } catch (const char* message) {
+        fail(message);
+        return 0;
+    } catch (const std::exception& e) {
+        fail(e.what());
+        return 0;
+    } catch (...) {
+        fail("Error, unknown exception, in gep_job_champion_save().");
+        return 0;
+    }
+    if (nullptr != buffer && size > 0) {
+        size_t length = text.size() < size - 1 ? text.size() : size - 1;
+        std::memcpy(buffer, text.data(), length);
+        buffer[length] = '\0';
+    }
+    return text.size();
+}
+
+void gep_job_destroy(gep_job* job) {
+    delete job;
+}
+
+gep_model* gep_model_load(const char* text) {
+    if (nullptr == text) {
+        fail("Error, null text, in gep_model_load().");
+        return nullptr;
+    }
+    try {
+        std::unique_ptr<gep_model> model(new gep_model());
+        if (0 == std::strncmp(text, "GEP-CHROMOSOME", 14)) {
+            std::istringstream input(text);
+            std::unique_ptr<GeneticAlgorithm::Chromosome> chromosome(GeneticAlgorithm::ChromosomeFactory().buildFromStream(input));
+            model->program = chromosome->compile().simplify();
+        } else {
+            model->program = Expression::Parser::parse(text).simplify();
+        }
+        return model.release();
+    } catch (const char* message) {
+        fail(message);
+        return nullptr;
+    } catch (const std::exception& e) {
+        fail(e.what());
+        return nullptr;
+    } catch (...) {
+        fail("Error, unknown exception, in gep_model_load().");
+        return nullptr;
+    }
+}
+
+size_t gep_model_variables(const gep_model* model) {
+    return nullptr == model ? 0 : (size_t)model->program.getVariableNumber();
+}
+
+int gep_model_score(const gep_model* model, const double* const* columns, size_t variables, size_t rows, double* output) {
+    return score<double>(model, columns, variables, rows, output);
+}
+
+int gep_model_score_float(const gep_model* model, const float* const* columns, size_t variables, size_t rows, float* output) {
+    return score<float>(model, columns, variables, rows, output);
+}
+
+void gep_model_destroy(gep_model* model) {
+    delete model;
+}
+
+const char* gep_last_error(void) {
+    return lastError.c_str();
+}
+
+}
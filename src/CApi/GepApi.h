@@ -0,0 +1,112 @@
+#ifndef CAPI_GEPAPI_H
+#define CAPI_GEPAPI_H
+
+/*
+ * libgep 的 C 接口，C 和 C++ 都可以使用，链接 libgep.a 或者 libgep.so
+ *
+ * 训练：gep_job_create() 用一个数据集创建任务并生成初始种群，之后反复调用 gep_job_step()
+ * 推进若干代，随时用 gep_job_best_fitness() 和 gep_job_champion() 查询当前的最优个体。
+ * 每个任务有自己的适应度函数和随机数引擎，不同的任务可以在不同的线程里同时创建和推进；
+ * 同一个任务同一时间只能在一个线程里使用。
+ *
+ * 打分：gep_model_score() 直接读取调用者的按列存储的数组，不复制输入，多个线程可以
+ * 同时对同一个模型打分。
+ *
+ * 失败时返回 NULL 或者 -1 ，gep_last_error() 给出原因。
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 进化任务 */
+typedef struct gep_job gep_job;
+
+/* 训练得到的模型，也就是化简后的表达式 */
+typedef struct gep_model gep_model;
+
+/* 任务的参数，先用 gep_job_options_init() 填上默认值再修改 */
+typedef struct gep_job_options {
+    /* 适应度："mse"、"mae"、"r2"、"hits" 或者 "accuracy" ，默认 "mse" */
+    const char* metric;
+    /* 种群大小，默认 1000 */
+    unsigned long population;
+    /* 染色体长度，默认 50 */
+    unsigned long length;
+    /* 初始种群中常数的范围，默认 -2 到 2 */
+    double min;
+    double max;
+    /* 每一代保留的上一代个体数，必须小于 population ，默认 500 */
+    unsigned long keep;
+    /* 变异概率，默认 0.1 */
+    double mutation_rate;
+    /* 最优适应度达到它以后 gep_job_step() 不再推进，默认 1 */
+    double stop_fitness;
+    /* 随机数种子，同样的种子和参数得到同样的结果；0 时从进程的全局引擎取一个种子 */
+    unsigned long seed;
+} gep_job_options;
+
+/* 默认参数 */
+void gep_job_options_init(gep_job_options* options);
+
+/*
+ * 创建任务并生成初始种群（第 0 代）
+ *
+ * features 按行存储，第 i 行第 j 个变量是 features[i * variables + j] ；targets 是 rows 个目标值。
+ * 数据会复制到任务内部，调用之后可以释放。options 为 NULL 时使用默认参数。
+ */
+gep_job* gep_job_create(const double* features, const double* targets, size_t rows, size_t variables, const gep_job_options* options);
+
+/* 推进 generations 代，成功时返回 0 */
+int gep_job_step(gep_job* job, unsigned long generations);
+
+/* 已经进化的代数 */
+unsigned long gep_job_generation(const gep_job* job);
+
+/* 当前最优个体的适应度 */
+double gep_job_best_fitness(const gep_job* job);
+
+/* 当前最优个体，化简后作为模型返回，用 gep_model_destroy() 释放 */
+gep_model* gep_job_champion(gep_job* job);
+
+/*
+ * 当前最优个体的染色体文本（ Chromosome::save() 的格式），可以用 gep_model_load() 读取
+ *
+ * 和 snprintf 一样：最多写入 size 个字节（包括结尾的 0），返回完整的长度（不包括结尾的 0），
+ * 失败时返回 0 。
+ */
+size_t gep_job_champion_save(gep_job* job, char* buffer, size_t size);
+
+/* 释放任务 */
+void gep_job_destroy(gep_job* job);
+
+/* 从染色体文本或者中缀表达式（例如 "x0*x1+1"）创建模型 */
+gep_model* gep_model_load(const char* text);
+
+/* 模型用到的输入变量个数，也就是最大的变量序号加 1 */
+size_t gep_model_variables(const gep_model* model);
+
+/*
+ * 对 rows 行数据打分
+ *
+ * columns[j] 是第 j 个变量的 rows 个值，variables 至少是 gep_model_variables() 。结果写到 output 。
+ * 成功时返回 0 。
+ */
+int gep_model_score(const gep_model* model, const double* const* columns, size_t variables, size_t rows, double* output);
+
+/* 和 gep_model_score() 相同，按 float 计算 */
+int gep_model_score_float(const gep_model* model, const float* const* columns, size_t variables, size_t rows, float* output);
+
+/* 释放模型 */
+void gep_model_destroy(gep_model* model);
+
+/* 当前线程最近一次失败的原因 */
+const char* gep_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
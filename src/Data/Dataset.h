@@ -0,0 +1,192 @@
+#ifndef DATA_DATASET_H
+#define DATA_DATASET_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdlib>
+
+namespace Data {
+
+    /* 训练数据，按列存储
+     *
+     * 每行若干个输入变量和一个或多个目标值，第 i 列对应表达式中的变量 xi 。按列存储是为了
+     * 直接交给 Expression::Program::evaluateBlock() 这样的批量计算。多个目标值用于同时拟合
+     * 多个输出，见 Fitness::MultiTargetObjective 。
+     */
+    class Dataset {
+
+    public:
+
+        /**
+         * @param unsigned long variableNumber 输入变量的个数
+         * @param unsigned long targetNumber 目标值的个数
+         */
+        Dataset(unsigned long variableNumber = 0, unsigned long targetNumber = 1) {
+            if (targetNumber < 1) {
+                throw "Error, targetNumber < 1, in Data::Dataset.";
+            }
+            this->columns.resize(variableNumber);
+            this->targets.resize(targetNumber);
+            this->refresh();
+        }
+
+        // 列指针指向自己的数据，拷贝时要重新建立
+        Dataset(const Dataset& another) {
+            *this = another;
+        }
+
+        Dataset& operator=(const Dataset& another) {
+            if (this != &another) {
+                this->columns = another.columns;
+                this->targets = another.targets;
+                this->refresh();
+            }
+            return *this;
+        }
+
+        /**
+         * 读取 CSV 文件，逗号分隔，最后 targetNumber 列是目标值，其它列依次是变量
+         *
+         * @param const std::string& fileName
+         * @param bool header 第一行是否为表头
+         * @param unsigned long targetNumber 目标值的列数
+         * @return Dataset
+         */
+        static Dataset fromCsv(const std::string& fileName, bool header = false, unsigned long targetNumber = 1) {
+            std::ifstream file(fileName.c_str());
+            if (!file) {
+                throw "Error, can not open file, in Data::Dataset::fromCsv().";
+            }
+            Dataset dataset(0, targetNumber);
+            std::string line;
+            std::vector<long double> values;
+            bool first = true;
+            while (std::getline(file, line)) {
+                if (first && header) {
+                    first = false;
+                    continue;
+                }
+                first = false;
+                if (line.find_first_not_of(" \t\r") == std::string::npos) {
+                    continue;
+                }
+                values.clear();
+                const char* p = line.c_str();
+                char* end;
+                while (true) {
+                    values.push_back(strtold(p, &end));
+                    if (end == p) {
+                        throw "Error, bad number, in Data::Dataset::fromCsv().";
+                    }
+                    while (' ' == *end || '\t' == *end || '\r' == *end) {
+                        end++;
+                    }
+                    if (',' != *end) {
+                        break;
+                    }
+                    p = end + 1;
+                }
+                if (0 == dataset.getRowNumber() && dataset.columns.empty()) {
+                    if (values.size() <= targetNumber) {
+                        throw "Error, wrong number of columns, in Data::Dataset::fromCsv().";
+                    }
+                    dataset.columns.resize(values.size() - targetNumber);
+                }
+                if (values.size() != dataset.columns.size() + targetNumber) {
+                    throw "Error, wrong number of columns, in Data::Dataset::fromCsv().";
+                }
+                dataset.addRow(values.data(), values.data() + dataset.columns.size());
+            }
+            return dataset;
+        }
+
+        /**
+         * 加入一行
+         *
+         * @param const long double* variables getVariableNumber() 个变量的值
+         * @param long double target 目标值
+         * @return void
+         */
+        void addRow(const long double* variables, long double target) {
+            if (1 != this->targets.size()) {
+                throw "Error, more than one target, in Data::Dataset::addRow().";
+            }
+            this->addRow(variables, &target);
+        }
+
+        /**
+         * 加入一行，有多个目标值
+         *
+         * @param const long double* variables getVariableNumber() 个变量的值
+         * @param const long double* targets getTargetNumber() 个目标值
+         * @return void
+         */
+        void addRow(const long double* variables, const long double* targets) {
+            for (unsigned long i = 0; i < this->columns.size(); i++) {
+                this->columns[i].push_back(variables[i]);
+            }
+            for (unsigned long i = 0; i < this->targets.size(); i++) {
+                this->targets[i].push_back(targets[i]);
+            }
+            this->refresh();
+        }
+
+        // 行数
+        unsigned long getRowNumber() const {
+            return this->targets[0].size();
+        }
+
+        // 目标值的个数
+        unsigned long getTargetNumber() const {
+            return this->targets.size();
+        }
+
+        // 输入变量的个数
+        unsigned long getVariableNumber() const {
+            return this->columns.size();
+        }
+
+        /**
+         * 所有变量的列，columns[i] 是第 i 个变量的 getRowNumber() 个值
+         *
+         * @return const long double* const*
+         */
+        const long double* const* getColumns() const {
+            return this->pointers.data();
+        }
+
+        /**
+         * 目标值的列
+         *
+         * @param unsigned long index 第几个目标值
+         * @return const long double*
+         */
+        const long double* getTarget(unsigned long index = 0) const {
+            return this->targets[index].data();
+        }
+
+    private:
+
+        /** @var std::vector<std::vector<long double>> 每个变量一列 */
+        std::vector<std::vector<long double>> columns;
+
+        /** @var std::vector<std::vector<long double>> 每个目标值一列 */
+        std::vector<std::vector<long double>> targets;
+
+        /** @var std::vector<const long double*> 每列的首地址 */
+        std::vector<const long double*> pointers;
+
+        // 私有，更新列指针，加入数据可能让列重新分配
+        void refresh() {
+            this->pointers.resize(this->columns.size());
+            for (unsigned long i = 0; i < this->columns.size(); i++) {
+                this->pointers[i] = this->columns[i].data();
+            }
+        }
+
+    };
+
+}
+
+#endif
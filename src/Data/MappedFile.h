@@ -0,0 +1,91 @@
+#ifndef DATA_MAPPEDFILE_H
+#define DATA_MAPPEDFILE_H
+
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace Data {
+
+    /* 以只读方式用 mmap 映射整个文件
+     */
+    class MappedFile {
+
+    public:
+
+        /**
+         * 打开并映射文件
+         *
+         * @param const std::string& fileName
+         */
+        MappedFile(const std::string& fileName) {
+            this->fileDescriptor = open(fileName.c_str(), O_RDONLY);
+            if (this->fileDescriptor < 0) {
+                throw "Error, can not open file, in Data::MappedFile.";
+            }
+            struct stat fileStat;
+            if (0 != fstat(this->fileDescriptor, &fileStat)) {
+                close(this->fileDescriptor);
+                throw "Error, fstat() failed, in Data::MappedFile.";
+            }
+            this->size = (unsigned long)fileStat.st_size;
+            if (0 == this->size) {
+                return;
+            }
+            void* address = mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, this->fileDescriptor, 0);
+            if (MAP_FAILED == address) {
+                close(this->fileDescriptor);
+                throw "Error, mmap() failed, in Data::MappedFile.";
+            }
+            madvise(address, this->size, MADV_SEQUENTIAL);
+            this->data = (const char*)address;
+        }
+
+        // 解除映射，关闭文件
+        ~MappedFile() {
+            if (nullptr != this->data) {
+                munmap((void*)this->data, this->size);
+            }
+            close(this->fileDescriptor);
+        }
+
+        MappedFile(const MappedFile&) = delete;
+
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        /**
+         * 文件内容，空文件时为 nullptr
+         *
+         * @return const char*
+         */
+        const char* getData() {
+            return this->data;
+        }
+
+        /**
+         * 文件大小，字节
+         *
+         * @return unsigned long
+         */
+        unsigned long getSize() {
+            return this->size;
+        }
+
+    private:
+
+        /** @var int 文件描述符 */
+        int fileDescriptor = -1;
+
+        /** @var const char* 映射的地址 */
+        const char* data = nullptr;
+
+        /** @var unsigned long 文件大小 */
+        unsigned long size = 0;
+
+    };
+
+}
+
+#endif
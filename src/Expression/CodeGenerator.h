@@ -0,0 +1,115 @@
+#ifndef EXPRESSION_CODEGENERATOR_H
+#define EXPRESSION_CODEGENERATOR_H
+
+#include "../Op.h"
+#include "Program.h"
+#include <string>
+#include <sstream>
+#include <limits>
+#include <vector>
+
+namespace Expression {
+
+    /* 把 Program 输出成独立的 C/C++ 函数
+     *
+     * 生成的代码不依赖本项目的任何头文件，既可以作为 C 编译，也可以作为 C++ 编译（带
+     * extern "C" ，方便用 dlsym 查找）。函数的参数 x 是一行输入变量。每条指令对应一个局部
+     * 常量，编译器可以完全展开。
+     */
+    class CodeGenerator {
+
+    public:
+
+        /**
+         * 生成函数的源码
+         *
+         * @param const Program& program 需要输出的程序，一般先调用 Program::simplify()
+         * @param const std::string& functionName 函数名
+         * @return std::string
+         */
+        std::string generate(const Program& program, const std::string& functionName) {
+            using namespace std;
+            if (0 == program.size()) {
+                throw "Error, empty program, in Expression::CodeGenerator::generate().";
+            }
+            ostringstream code;
+            code.precision(numeric_limits<long double>::max_digits10);
+            code << "/* Generated by GEP. */" << endl;
+            code << "#include <math.h>" << endl;
+            code << endl;
+            code << "#ifdef __cplusplus" << endl;
+            code << "extern \"C\" {" << endl;
+            code << "#endif" << endl;
+            code << endl;
+            code << "long double " << functionName << "(const long double* x) {" << endl;
+            if (0 == program.getVariableNumber()) {
+                code << "    (void)x;" << endl;
+            }
+            vector<unsigned long> stack;
+            vector<unsigned long> arguments;
+            unsigned long temporary = 0;
+            for (auto& instruction : program.getInstructions()) {
+                code << "    const long double t" << temporary << " = ";
+                if (Op::OP_NUMBER == instruction.code) {
+                    this->writeNumber(code, instruction.value);
+                    code << ";" << endl;
+                    stack.push_back(temporary++);
+                    continue;
+                }
+                if (Op::OP_VARIABLE == instruction.code) {
+                    code << "x[" << instruction.variable << "];" << endl;
+                    stack.push_back(temporary++);
+                    continue;
+                }
+                const FunctionRegistry::Function& function = FunctionRegistry::get(instruction.code);
+                if (function.cExpression.empty()) {
+                    throw "Error, function has no C expression, in Expression::CodeGenerator::generate().";
+                }
+                arguments.assign(stack.end() - function.arity, stack.end());
+                stack.resize(stack.size() - function.arity);
+                code << this->expand(function.cExpression, arguments) << ";" << endl;
+                stack.push_back(temporary++);
+            }
+            code << "    return t" << stack.back() << ";" << endl;
+            code << "}" << endl;
+            code << endl;
+            code << "#ifdef __cplusplus" << endl;
+            code << "}" << endl;
+            code << "#endif" << endl;
+            return code.str();
+        }
+
+    private:
+
+        // 私有，输出常数，inf 和 nan 没有字面量，用除法表示
+        void writeNumber(std::ostringstream& code, long double value) {
+            if (value != value) {
+                code << "(0.0L / 0.0L)";
+            } else if (value > std::numeric_limits<long double>::max()) {
+                code << "(1.0L / 0.0L)";
+            } else if (value < -std::numeric_limits<long double>::max()) {
+                code << "(-1.0L / 0.0L)";
+            } else {
+                code << value << "L";
+            }
+        }
+
+        // 私有，把表达式中的 $0 $1 $2 替换成对应的局部常量
+        std::string expand(const std::string& expression, const std::vector<unsigned long>& arguments) {
+            std::ostringstream result;
+            for (unsigned long i = 0; i < expression.size(); i++) {
+                if ('$' == expression[i] && i + 1 < expression.size() && expression[i + 1] >= '0' && expression[i + 1] <= '2') {
+                    result << "t" << arguments[expression[i + 1] - '0'];
+                    i++;
+                } else {
+                    result << expression[i];
+                }
+            }
+            return result.str();
+        }
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,10 @@
+#include "ExpressionStore.h"
+
+namespace Expression {
+
+    // 常用的数值类型，库的使用者不必再实例化
+    template void ExpressionStore::evaluateBlock<float>(const float* const* columns, unsigned long count, std::vector<float>& workspace);
+    template void ExpressionStore::evaluateBlock<double>(const double* const* columns, unsigned long count, std::vector<double>& workspace);
+    template void ExpressionStore::evaluateBlock<long double>(const long double* const* columns, unsigned long count, std::vector<long double>& workspace);
+
+}
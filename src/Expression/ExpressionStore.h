@@ -0,0 +1,287 @@
+#ifndef EXPRESSION_EXPRESSIONSTORE_H
+#define EXPRESSION_EXPRESSIONSTORE_H
+
+#include "../Op.h"
+#include "../FunctionRegistry.h"
+#include "Program.h"
+#include <vector>
+#include <unordered_set>
+#include <functional>
+#include <algorithm>
+
+namespace Expression {
+
+    /* 整个种群共用的表达式存储
+     *
+     * 结构相同（运算符、常数、变量都相同）的子表达式只保存一份，得到一个有向无环图。
+     * 节点总是在它的子节点之后加入，所以按序号顺序计算就是合法的拓扑顺序，每个不同的
+     * 子表达式只计算一次，所有包含它的个体共用结果。加法和乘法的两个子节点按序号排序，
+     * a+b 和 b+a 会合并成同一个节点，结果完全相同。
+     */
+    class ExpressionStore {
+
+    public:
+
+        ExpressionStore() {
+        }
+
+        // 哈希表引用了 nodes ，拷贝时要重新建立
+        ExpressionStore(const ExpressionStore& another) {
+            *this = another;
+        }
+
+        ExpressionStore& operator=(const ExpressionStore& another) {
+            if (this != &another) {
+                this->nodes = another.nodes;
+                this->values = another.values;
+                this->referenceNumber = another.referenceNumber;
+                this->index.clear();
+                for (unsigned long i = 0; i < this->nodes.size(); i++) {
+                    this->index.insert(i);
+                }
+            }
+            return *this;
+        }
+
+        /**
+         * 清空，一般在每一代开始的时候调用
+         *
+         * @return void
+         */
+        void clear() {
+            this->nodes.clear();
+            this->index.clear();
+            this->referenceNumber = 0;
+        }
+
+        /**
+         * 把程序加入存储，返回它的根节点
+         *
+         * @param const Program& program
+         * @return unsigned long
+         */
+        unsigned long add(const Program& program) {
+            std::vector<unsigned long>& stack = this->stack;
+            stack.clear();
+            Node node;
+            for (auto& instruction : program.getInstructions()) {
+                node.code = instruction.code;
+                node.variable = 0;
+                node.value = 0.0L;
+                node.arity = 0;
+                if (Op::OP_NUMBER == instruction.code) {
+                    node.value = instruction.value;
+                } else if (Op::OP_VARIABLE == instruction.code) {
+                    node.variable = instruction.variable;
+                } else {
+                    node.arity = FunctionRegistry::getArity(instruction.code);
+                    stack.resize(stack.size() - node.arity);
+                    for (int k = 0; k < node.arity; k++) {
+                        node.children[k] = stack[stack.size() + k];
+                    }
+                    if (2 == node.arity && (Op::ADD == node.code || Op::PRO == node.code) && node.children[0] > node.children[1]) {
+                        std::swap(node.children[0], node.children[1]);
+                    }
+                }
+                stack.push_back(this->intern(node));
+            }
+            if (1 != stack.size()) {
+                throw "Error, bad program, in Expression::ExpressionStore::add().";
+            }
+            return stack[0];
+        }
+
+        /**
+         * 计算所有节点的值，每个节点只计算一次
+         *
+         * @param const long double* variables 输入变量，没有变量时可以是 nullptr
+         * @return void
+         */
+        void evaluate(const long double* variables = nullptr) {
+            this->values.resize(this->nodes.size());
+            long double arguments[3];
+            for (unsigned long i = 0; i < this->nodes.size(); i++) {
+                const Node& node = this->nodes[i];
+                if (Op::OP_NUMBER == node.code) {
+                    this->values[i] = node.value;
+                } else if (Op::OP_VARIABLE == node.code) {
+                    this->values[i] = nullptr == variables ? 0.0L : variables[node.variable];
+                } else {
+                    for (int k = 0; k < node.arity; k++) {
+                        arguments[k] = this->values[node.children[k]];
+                    }
+                    this->values[i] = FunctionRegistry::apply<long double>(node.code, arguments);
+                }
+            }
+        }
+
+        /**
+         * 获取 evaluate() 算出来的节点的值
+         *
+         * @param unsigned long node add() 返回的根节点
+         * @return long double
+         */
+        long double getValue(unsigned long node) {
+            return this->values[node];
+        }
+
+        /**
+         * 对一批数据计算所有节点的值，每个节点对这一批数据只计算一次
+         *
+         * 结果保存在 workspace 中，每个节点占 count 个位置，用 getBlockValue() 读取。
+         * 一般按数据块循环调用，workspace 在多次调用之间重复使用。
+         *
+         * @param const T* const* columns columns[i] 是第 i 个变量的 count 个值
+         * @param unsigned long count 数据的行数
+         * @param std::vector<T>& workspace
+         * @return void
+         */
+        template<class T>
+        void evaluateBlock(const T* const* columns, unsigned long count, std::vector<T>& workspace) {
+            if (workspace.size() < this->nodes.size() * count) {
+                workspace.resize(this->nodes.size() * count);
+            }
+            const T* arguments[3];
+            for (unsigned long i = 0; i < this->nodes.size(); i++) {
+                const Node& node = this->nodes[i];
+                T* result = workspace.data() + i * count;
+                if (Op::OP_NUMBER == node.code) {
+                    std::fill(result, result + count, (T)node.value);
+                } else if (Op::OP_VARIABLE == node.code) {
+                    std::copy(columns[node.variable], columns[node.variable] + count, result);
+                } else {
+                    for (int k = 0; k < node.arity; k++) {
+                        arguments[k] = workspace.data() + node.children[k] * count;
+                    }
+                    FunctionRegistry::applyBlock<T>(node.code, result, arguments, count);
+                }
+            }
+        }
+
+        /**
+         * 获取 evaluateBlock() 算出来的节点的值
+         *
+         * @param const std::vector<T>& workspace
+         * @param unsigned long count 数据的行数
+         * @param unsigned long node add() 返回的根节点
+         * @return const T*
+         */
+        template<class T>
+        const T* getBlockValue(const std::vector<T>& workspace, unsigned long count, unsigned long node) {
+            return workspace.data() + node * count;
+        }
+
+        /**
+         * 不同的子表达式的个数，也就是每次 evaluate() 实际计算的节点数
+         *
+         * @return unsigned long
+         */
+        unsigned long getNodeNumber() {
+            return this->nodes.size();
+        }
+
+        /**
+         * 用到的输入变量的个数，也就是最大的变量序号加 1
+         *
+         * @return int
+         */
+        int getVariableNumber() {
+            int number = 0;
+            for (auto& node : this->nodes) {
+                if (Op::OP_VARIABLE == node.code && node.variable >= number) {
+                    number = node.variable + 1;
+                }
+            }
+            return number;
+        }
+
+        /**
+         * 加入的所有程序的节点总数，没有共用的话每次要计算这么多个节点
+         *
+         * @return unsigned long
+         */
+        unsigned long getReferenceNumber() {
+            return this->referenceNumber;
+        }
+
+    private:
+
+        // 图中的节点
+        struct Node {
+            int code;
+            int variable;
+            int arity;
+            long double value;
+            unsigned long children[3];
+        };
+
+        // 哈希表的键，只用来查找，节点内容保存在 nodes 中
+        struct NodeHash {
+            const std::vector<Node>* nodes;
+            std::size_t operator()(unsigned long id) const {
+                const Node& node = (*this->nodes)[id];
+                std::size_t seed = std::hash<int>()(node.code);
+                seed ^= std::hash<int>()(node.variable) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+                seed ^= std::hash<long double>()(node.value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+                for (int k = 0; k < node.arity; k++) {
+                    seed ^= std::hash<unsigned long>()(node.children[k]) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+                }
+                return seed;
+            }
+        };
+
+        struct NodeEqual {
+            const std::vector<Node>* nodes;
+            bool operator()(unsigned long a, unsigned long b) const {
+                const Node& x = (*this->nodes)[a];
+                const Node& y = (*this->nodes)[b];
+                if (x.code != y.code || x.variable != y.variable || x.arity != y.arity || !(x.value == y.value)) {
+                    return false;
+                }
+                for (int k = 0; k < x.arity; k++) {
+                    if (x.children[k] != y.children[k]) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+        };
+
+        /** @var std::vector<Node> 所有不同的节点，子节点总在父节点前面 */
+        std::vector<Node> nodes;
+
+        /** @var std::unordered_set 节点序号的集合，按节点内容查找 */
+        std::unordered_set<unsigned long, NodeHash, NodeEqual> index{16, NodeHash{&nodes}, NodeEqual{&nodes}};
+
+        /** @var std::vector<long double> evaluate() 的结果 */
+        std::vector<long double> values;
+
+        /** @var std::vector<unsigned long> add() 用的栈 */
+        std::vector<unsigned long> stack;
+
+        /** @var unsigned long 加入的节点总数 */
+        unsigned long referenceNumber = 0;
+
+        // 私有，查找相同的节点，找不到就加入
+        unsigned long intern(const Node& node) {
+            this->referenceNumber++;
+            this->nodes.push_back(node);
+            unsigned long id = this->nodes.size() - 1;
+            auto found = this->index.find(id);
+            if (found != this->index.end()) {
+                this->nodes.pop_back();
+                return *found;
+            }
+            this->index.insert(id);
+            return id;
+        }
+
+    };
+
+    extern template void ExpressionStore::evaluateBlock<float>(const float* const* columns, unsigned long count, std::vector<float>& workspace);
+    extern template void ExpressionStore::evaluateBlock<double>(const double* const* columns, unsigned long count, std::vector<double>& workspace);
+    extern template void ExpressionStore::evaluateBlock<long double>(const long double* const* columns, unsigned long count, std::vector<long double>& workspace);
+
+}
+
+#endif
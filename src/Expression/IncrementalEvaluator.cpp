@@ -0,0 +1,15 @@
+#include "IncrementalEvaluator.h"
+
+namespace Expression {
+
+    unsigned long IncrementalEvaluator::memoryBudget = 256UL * 1024 * 1024;
+
+    std::atomic<unsigned long> IncrementalEvaluator::usedBytes(0);
+
+    std::mutex IncrementalEvaluator::cacheLock;
+
+    std::list<IncrementalEvaluator::Rows*> IncrementalEvaluator::recent;
+
+    thread_local IncrementalEvaluator::Pinned IncrementalEvaluator::lastResult;
+
+}
@@ -0,0 +1,524 @@
+#ifndef EXPRESSION_INCREMENTALEVALUATOR_H
+#define EXPRESSION_INCREMENTALEVALUATOR_H
+
+#include "../Op.h"
+#include "../FunctionRegistry.h"
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+
+namespace Expression {
+
+    /* 保留中间结果的表达式求值
+     *
+     * 按和 Program::decode() 相同的规则解码一个基因，记住每个节点的值（一个数，或者每行
+     * 一个数的向量）。点变异之后调用 update() ，如果树的形状没有变，只把从被修改的节点
+     * 到根节点的这条路径标记为需要重新计算，其它节点的值直接使用。
+     *
+     * 向量在拷贝之间共用：拷贝对象（交叉、复制基因）不复制数据，变异后需要重新计算的节点
+     * 如果向量还被别的对象使用，就换一个新的向量（写时复制）。所有对象的向量按最近使用的
+     * 顺序排在一个全局的链表里，共用一个内存预算，每次 evaluateRows() 之后如果超出预算，
+     * 就从最久没有使用的向量开始释放，不管它属于哪个对象，需要时再重新计算。正在计算中
+     * 读写的向量和每个线程最近一次返回的结果不会被释放。
+     */
+    class IncrementalEvaluator {
+
+    public:
+
+        // update() 的结果
+        enum Change {
+            UNCHANGED, // 被修改的位置没有表达出来，值不变
+            PATH,      // 形状没变，只需要重新计算一条路径
+            REBUILD    // 形状变了，需要重新解码
+        };
+
+        /**
+         * 解码基因
+         *
+         * @param Op** genes 基因数组
+         * @param unsigned long length 基因数组的长度
+         * @param unsigned long beginOfTail 尾部开始的位置
+         */
+        IncrementalEvaluator(Op** genes, unsigned long length, unsigned long beginOfTail) {
+            this->positionNode.assign(length, NOT_READ);
+            if (nullptr == genes[0]) {
+                throw "Error, nullptr == genes[0], in Expression::IncrementalEvaluator.";
+            }
+            if (this->isEnd(genes[0])) {
+                // 根节点是 END 时整个表达式是常数 0 ，只有位置 0 会影响结果
+                this->addNode(0, nullptr);
+                this->positionNode[0] = END_READ;
+                return;
+            }
+            this->addNode(0, genes[0]);
+            unsigned long offset = 1;
+            for (unsigned long k = 0; k < this->nodes.size(); k++) {
+                this->nodes[k].firstChild = this->nodes.size();
+                for (int child = 0; child < this->nodes[k].arity; child++) {
+                    if (offset >= length) {
+                        throw "Error, out of size, in Expression::IncrementalEvaluator.";
+                    }
+                    if (this->isEnd(genes[offset])) {
+                        this->positionNode[offset] = NOT_READ == this->positionNode[offset] ? END_READ : MULTIPLE_READ;
+                        offset = beginOfTail;
+                    }
+                    this->addNode(offset, genes[offset]);
+                    this->nodes.back().parent = k;
+                    offset++;
+                }
+            }
+        }
+
+        // 向量是共用的，拷贝不复制数据
+        IncrementalEvaluator(const IncrementalEvaluator&) = default;
+
+        IncrementalEvaluator& operator=(const IncrementalEvaluator&) = delete;
+
+        /**
+         * 基因数组中 position 位置的基因被换成了 op
+         *
+         * @param unsigned long position 在这个基因里面的位置
+         * @param Op* op 新的基因
+         * @return Change
+         */
+        Change update(unsigned long position, Op* op) {
+            if (position >= this->positionNode.size()) {
+                return REBUILD;
+            }
+            long node = this->positionNode[position];
+            if (NOT_READ == node) {
+                return UNCHANGED;
+            }
+            if (END_READ == node) {
+                return this->isEnd(op) ? UNCHANGED : REBUILD;
+            }
+            if (MULTIPLE_READ == node) {
+                return REBUILD;
+            }
+            Node& target = this->nodes[node];
+            if (nullptr == op || this->isEnd(op) || target.isEnd) {
+                return REBUILD;
+            }
+            if (Op::OP_OPERATION == op->getOpType()) {
+                if (target.arity != FunctionRegistry::getArity(op->getTypeValue()) || 0 == target.arity) {
+                    return REBUILD;
+                }
+            } else if (0 != target.arity) {
+                return REBUILD;
+            }
+            this->setNode(target, op);
+            this->invalidatePath(node);
+            return PATH;
+        }
+
+        /**
+         * 计算一次，只有被 update() 标记的节点会重新计算
+         *
+         * @param const long double* variables 输入变量，没有变量时可以是 nullptr
+         * @return long double
+         */
+        long double evaluate(const long double* variables = nullptr) {
+            if (variables != this->variables) {
+                this->variables = variables;
+                for (auto& node : this->nodes) {
+                    node.isValueValid = false;
+                }
+            }
+            long double arguments[3];
+            for (unsigned long k = this->nodes.size(); k-- > 0;) {
+                Node& node = this->nodes[k];
+                if (node.isValueValid) {
+                    continue;
+                }
+                if (Op::OP_VARIABLE == node.code) {
+                    node.value = nullptr == variables ? 0.0L : variables[node.variable];
+                } else if (node.arity > 0) {
+                    for (int child = 0; child < node.arity; child++) {
+                        arguments[child] = this->nodes[node.firstChild + child].value;
+                    }
+                    node.value = FunctionRegistry::apply<long double>(node.code, arguments);
+                }
+                node.isValueValid = true;
+            }
+            return this->nodes[0].value;
+        }
+
+        /**
+         * 对一批数据计算，只重新计算被 update() 标记的节点和已经被释放的节点
+         *
+         * 数据按列存储，地址或者行数变了就当作新的数据，所有节点都会重新计算。不同线程可以
+         * 同时调用不同的对象，包括共用向量的拷贝。
+         *
+         * @param const long double* const* columns columns[i] 是第 i 个变量的 count 个值
+         * @param unsigned long count 数据的行数
+         * @return const long double* count 个结果，这个线程下一次调用任何对象的 evaluateRows() 之前有效
+         */
+        const long double* evaluateRows(const long double* const* columns, unsigned long count) {
+            if (columns != this->columns || count != this->count) {
+                this->columns = columns;
+                this->count = count;
+                for (auto& node : this->nodes) {
+                    node.isRowsValid = false;
+                }
+            }
+            std::vector<char>& needed = this->needed;
+            std::vector<Rows*>& reading = this->reading;
+            reading.clear();
+            // 先放开这个线程上一次返回的结果，它可能就是这里的根节点，放开后才能直接覆盖
+            {
+                std::shared_ptr<Rows> previous;
+                std::lock_guard<std::mutex> guard(cacheLock);
+                if (lastResult.rows) {
+                    lastResult.rows->pins--;
+                    previous.swap(lastResult.rows);
+                }
+            }
+            {
+                std::lock_guard<std::mutex> guard(cacheLock);
+                // 从根节点往下找出要计算的节点，有效的节点下面不用再看
+                needed.assign(this->nodes.size(), 0);
+                needed[0] = this->isRowsReady(0) ? 0 : NEED_NEW;
+                for (unsigned long k = 0; k < this->nodes.size(); k++) {
+                    if (!needed[k]) {
+                        continue;
+                    }
+                    Node& node = this->nodes[k];
+                    // 只有自己用的向量直接覆盖，和别的对象共用的换新的
+                    if (nullptr != node.rows && 1 == node.rows.use_count()) {
+                        needed[k] = NEED_REUSE;
+                        this->pin(node.rows.get());
+                    }
+                    for (int child = 0; child < node.arity; child++) {
+                        unsigned long c = node.firstChild + child;
+                        if (!this->isRowsReady(c)) {
+                            needed[c] = NEED_NEW;
+                        } else if (Op::OP_VARIABLE != this->nodes[c].code) {
+                            this->pin(this->nodes[c].rows.get());
+                        }
+                    }
+                }
+                if (!needed[0] && Op::OP_VARIABLE != this->nodes[0].code) {
+                    this->pin(this->nodes[0].rows.get());
+                }
+            }
+            // 计算不持有锁，读写的向量都已经固定，不会被别的线程释放
+            const long double* arguments[3];
+            for (unsigned long k = this->nodes.size(); k-- > 0;) {
+                if (!needed[k]) {
+                    continue;
+                }
+                Node& node = this->nodes[k];
+                if (Op::OP_VARIABLE == node.code) {
+                    node.isRowsValid = true;
+                    continue;
+                }
+                if (NEED_NEW == needed[k]) {
+                    node.rows = std::make_shared<Rows>();
+                }
+                long double* values = node.rows->resize(count);
+                if (0 == node.arity) {
+                    std::fill(values, values + count, node.value);
+                } else {
+                    for (int child = 0; child < node.arity; child++) {
+                        arguments[child] = this->rowsOf(node.firstChild + child);
+                    }
+                    FunctionRegistry::applyBlock<long double>(node.code, values, arguments, count);
+                }
+                node.isRowsValid = true;
+            }
+            const long double* result = this->rowsOf(0);
+            {
+                std::lock_guard<std::mutex> guard(cacheLock);
+                for (unsigned long k = 0; k < this->nodes.size(); k++) {
+                    if (needed[k] && Op::OP_VARIABLE != this->nodes[k].code) {
+                        this->nodes[k].rows->store();
+                    }
+                }
+                for (Rows* rows : reading) {
+                    rows->pins--;
+                }
+                if (Op::OP_VARIABLE != this->nodes[0].code) {
+                    lastResult.rows = this->nodes[0].rows;
+                    lastResult.rows->pins++;
+                }
+                evict();
+            }
+            return result;
+        }
+
+        /**
+         * 表达出来的节点个数
+         *
+         * @return unsigned long
+         */
+        unsigned long size() {
+            return this->nodes.size();
+        }
+
+        /**
+         * 用到的输入变量的个数，也就是最大的变量序号加 1
+         *
+         * @return int
+         */
+        int getVariableNumber() {
+            int number = 0;
+            for (auto& node : this->nodes) {
+                if (Op::OP_VARIABLE == node.code && node.variable >= number) {
+                    number = node.variable + 1;
+                }
+            }
+            return number;
+        }
+
+        /**
+         * 设置所有对象的向量共用的内存预算，字节
+         *
+         * @param unsigned long bytes
+         * @return void
+         */
+        static void setMemoryBudget(unsigned long bytes) {
+            memoryBudget = bytes;
+        }
+
+        /**
+         * 所有对象的向量当前占用的内存，字节，共用的向量只算一次
+         *
+         * @return unsigned long
+         */
+        static unsigned long getUsedMemory() {
+            return usedBytes;
+        }
+
+    private:
+
+        // positionNode 中的特殊值：没有读到的位置，读到了 END 的位置，读了不止一次的位置（多个 END 都会跳到尾部的开始）
+        enum {
+            NOT_READ = -1,
+            END_READ = -2,
+            MULTIPLE_READ = -3
+        };
+
+        // needed 中要计算的节点：换一个新的向量，或者覆盖只有自己用的向量
+        enum {
+            NEED_NEW = 1,
+            NEED_REUSE = 2
+        };
+
+        // 一个节点每行的值，可以被多个对象共用，放在全局的最近使用链表里。除了 values 的内容，
+        // 其它成员和链表都只在持有 cacheLock 时读写
+        struct Rows {
+            // 不用 std::vector ，每次换新的向量时不需要先清零
+            std::unique_ptr<long double[]> values;
+            unsigned long size = 0;
+            // 计入预算的字节数
+            unsigned long bytes = 0;
+            // 正在被读写的次数，大于 0 时不能释放
+            unsigned long pins = 0;
+            // 被释放了，需要重新计算
+            bool isEvicted = false;
+            bool isLinked = false;
+            std::list<Rows*>::iterator position;
+
+            // 持有 cacheLock 时调用，算完以后放到链表最前面并重新计算占用的内存
+            void store() {
+                if (this->isLinked) {
+                    recent.erase(this->position);
+                }
+                recent.push_front(this);
+                this->position = recent.begin();
+                this->isLinked = true;
+                this->isEvicted = false;
+                usedBytes -= this->bytes;
+                this->bytes = this->size * sizeof(long double);
+                usedBytes += this->bytes;
+            }
+
+            // 计算前调用，行数变了才重新分配
+            long double* resize(unsigned long count) {
+                if (count != this->size) {
+                    this->values.reset(new long double[count]);
+                    this->size = count;
+                }
+                return this->values.get();
+            }
+
+            // 最后一个使用者放开时归还预算
+            ~Rows() {
+                std::lock_guard<std::mutex> guard(cacheLock);
+                if (this->isLinked) {
+                    recent.erase(this->position);
+                }
+                usedBytes -= this->bytes;
+            }
+        };
+
+        // 每个线程最近一次返回的结果，固定到这个线程下一次调用 evaluateRows() 或者线程结束
+        struct Pinned {
+            std::shared_ptr<Rows> rows;
+
+            ~Pinned() {
+                std::shared_ptr<Rows> released;
+                std::lock_guard<std::mutex> guard(cacheLock);
+                if (this->rows) {
+                    this->rows->pins--;
+                    released.swap(this->rows);
+                }
+            }
+        };
+
+        // 表达式树的节点，子节点在数组里面是连续的
+        struct Node {
+            int code;
+            int variable;
+            int arity;
+            bool isEnd;
+            long double value;
+            unsigned long parent;
+            unsigned long firstChild;
+            bool isValueValid;
+            bool isRowsValid;
+            std::shared_ptr<Rows> rows;
+        };
+
+        /** @var std::vector<Node> 广度优先顺序的节点，父节点总在子节点前面 */
+        std::vector<Node> nodes;
+
+        /** @var std::vector<long> 基因位置对应的节点，或者 NOT_READ 、 END_READ 、 MULTIPLE_READ */
+        std::vector<long> positionNode;
+
+        /** @var const long double* evaluate() 上一次的输入 */
+        const long double* variables = nullptr;
+
+        /** @var const long double* const* evaluateRows() 上一次的输入 */
+        const long double* const* columns = nullptr;
+
+        /** @var unsigned long evaluateRows() 上一次的行数 */
+        unsigned long count = 0;
+
+        /** @var std::vector<char> evaluateRows() 用的临时标记 */
+        std::vector<char> needed;
+
+        /** @var std::vector<Rows*> evaluateRows() 固定的向量 */
+        std::vector<Rows*> reading;
+
+        /** @var unsigned long 内存预算，字节 */
+        static unsigned long memoryBudget;
+
+        /** @var std::atomic<unsigned long> 所有对象的向量占用的内存，字节 */
+        static std::atomic<unsigned long> usedBytes;
+
+        /** @var std::mutex 保护最近使用链表和向量的状态 */
+        static std::mutex cacheLock;
+
+        /** @var std::list<Rows*> 所有算过的向量，最近使用的在前面 */
+        static std::list<Rows*> recent;
+
+        /** @var Pinned 这个线程最近一次返回的结果 */
+        static thread_local Pinned lastResult;
+
+        // 私有，是否为 END
+        bool isEnd(Op* op) {
+            return nullptr != op && Op::OP_OPERATION == op->getOpType() && Op::END == op->getTypeValue();
+        }
+
+        // 私有，加入一个节点，op 为 nullptr 时是常数
+        void addNode(unsigned long position, Op* op) {
+            Node node;
+            node.parent = 0;
+            node.firstChild = 0;
+            node.isValueValid = false;
+            node.isRowsValid = false;
+            this->setNode(node, op);
+            this->nodes.push_back(node);
+            if (NOT_READ == this->positionNode[position]) {
+                this->positionNode[position] = this->nodes.size() - 1;
+            } else {
+                this->positionNode[position] = MULTIPLE_READ;
+            }
+        }
+
+        // 私有，按基因设置节点的内容
+        void setNode(Node& node, Op* op) {
+            node.code = Op::OP_NUMBER;
+            node.variable = 0;
+            node.arity = 0;
+            node.isEnd = this->isEnd(op);
+            node.value = 0.0L;
+            if (nullptr == op) {
+                return;
+            }
+            if (Op::OP_VARIABLE == op->getOpType()) {
+                node.code = Op::OP_VARIABLE;
+                node.variable = op->getTypeValue();
+            } else if (Op::OP_OPERATION == op->getOpType() && !node.isEnd) {
+                node.code = op->getTypeValue();
+                node.arity = FunctionRegistry::getArity(node.code);
+            } else {
+                node.value = op->getValue();
+            }
+        }
+
+        // 私有，节点和它所有的祖先都需要重新计算
+        void invalidatePath(unsigned long k) {
+            while (true) {
+                this->nodes[k].isValueValid = false;
+                this->nodes[k].isRowsValid = false;
+                if (0 == k) {
+                    return;
+                }
+                k = this->nodes[k].parent;
+            }
+        }
+
+        // 私有，节点的向量，变量直接使用输入的列
+        const long double* rowsOf(unsigned long k) {
+            if (Op::OP_VARIABLE == this->nodes[k].code) {
+                return this->columns[this->nodes[k].variable];
+            }
+            return this->nodes[k].rows->values.get();
+        }
+
+        // 私有，持有 cacheLock 时调用，节点的向量可以直接使用
+        bool isRowsReady(unsigned long k) {
+            const Node& node = this->nodes[k];
+            if (Op::OP_VARIABLE == node.code) {
+                return node.isRowsValid;
+            }
+            return node.isRowsValid && nullptr != node.rows && !node.rows->isEvicted;
+        }
+
+        // 私有，持有 cacheLock 时调用，这次计算结束前不释放这个向量，同时移到链表最前面
+        void pin(Rows* rows) {
+            rows->pins++;
+            this->reading.push_back(rows);
+            if (rows->isLinked) {
+                recent.splice(recent.begin(), recent, rows->position);
+            }
+        }
+
+        // 私有，持有 cacheLock 时调用，超出预算时从最久没有使用的向量开始释放，跳过固定的向量
+        static void evict() {
+            for (auto it = recent.end(); it != recent.begin() && usedBytes > memoryBudget;) {
+                --it;
+                Rows* rows = *it;
+                if (rows->pins > 0) {
+                    continue;
+                }
+                usedBytes -= rows->bytes;
+                rows->bytes = 0;
+                rows->values.reset();
+                rows->size = 0;
+                rows->isEvicted = true;
+                rows->isLinked = false;
+                it = recent.erase(it);
+            }
+        }
+
+    };
+
+}
+
+#endif
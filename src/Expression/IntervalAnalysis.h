@@ -0,0 +1,398 @@
+#ifndef EXPRESSION_INTERVALANALYSIS_H
+#define EXPRESSION_INTERVALANALYSIS_H
+
+#include "../Op.h"
+#include "Program.h"
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace Expression {
+
+    /* 一个子表达式在所有输入上可能取到的值
+     *
+     * 实数部分是闭区间 [lower, upper] ，lower > upper 时为空；inf 也可以是端点。nan 表示还
+     * 可能是 nan ，nan 不在区间里。
+     */
+    struct Interval {
+        long double lower;
+        long double upper;
+        bool nan;
+
+        // [lower, upper]
+        static Interval make(long double lower, long double upper, bool nan = false) {
+            Interval interval;
+            interval.lower = lower;
+            interval.upper = upper;
+            interval.nan = nan;
+            return interval;
+        }
+
+        // 任意值，包括 nan
+        static Interval any() {
+            return make(-std::numeric_limits<long double>::infinity(), std::numeric_limits<long double>::infinity(), true);
+        }
+
+        // 实数部分是否为空
+        bool isEmpty() const {
+            return this->lower > this->upper;
+        }
+
+        // 是否一定不是有限的数：只能是 inf 、 -inf 或者 nan
+        bool isNonFinite() const {
+            return this->isEmpty() || (this->lower == this->upper && std::isinf(this->lower));
+        }
+    };
+
+    // 区间分析的结果
+    struct IntervalReport {
+        // 程序的值域
+        Interval range;
+        // 一定走保护分支的运算的个数：除数总是小于 1E-18 的除法，参数绝对值总是小于 1E-18 的 log
+        unsigned long protectedOperations;
+        // 结果一定不是有限的数的运算的个数，也就是一定溢出（或者一定是 nan）
+        unsigned long nonFiniteOperations;
+
+        // 是否可以证明程序是退化的，不必计算就可以淘汰：程序的值在每一行上都是 inf 、-inf 或者 nan 。
+        // 走保护分支的运算只是得到 0 ，程序的其余部分仍然有用，不算退化
+        bool isDegenerate() const {
+            return this->range.isNonFinite();
+        }
+    };
+
+    /* 区间分析
+     *
+     * 已知每个输入变量的范围（例如数据集每一列的最小值和最大值）时，按后缀表达式的顺序用区间
+     * 算术求出每个子表达式可能取到的值，规则和 FunctionRegistry::apply() 的受保护计算一致。
+     * 每次运算后把有限的端点向外放宽一点，覆盖 long double 和 double 计算的舍入误差，所以
+     * 报告的“一定”是可以证明的：
+     *   - 除数的上界小于 1E-18 时这个除法在每一行上都是 0 ，注意负的除数也走保护分支，
+     *     结果按 [0, 0] 继续往上计算
+     *   - 值域只有 inf 、-inf 或者 nan 时每一行都溢出，程序的值域是这样时程序是退化的
+     * 自定义函数不知道规则，结果当作任意值。
+     *
+     * 同样的信息可以用来化简（ simplify() ）。
+     */
+    class IntervalAnalysis {
+
+    public:
+
+        /**
+         * @param const std::vector<Interval>& variables 每个输入变量的范围，程序用到的变量超出时当作任意值
+         */
+        IntervalAnalysis(const std::vector<Interval>& variables = std::vector<Interval>()) : variables(variables) {
+        }
+
+        /**
+         * 分析程序
+         *
+         * @param const Program& program
+         * @return IntervalReport
+         */
+        IntervalReport analyze(const Program& program) const {
+            if (0 == program.size()) {
+                throw "Error, empty program, in Expression::IntervalAnalysis::analyze().";
+            }
+            IntervalReport report;
+            report.protectedOperations = 0;
+            report.nonFiniteOperations = 0;
+            std::vector<Interval> stack;
+            stack.reserve(program.size());
+            Interval result;
+            bool guarded;
+            int arity;
+            for (auto& instruction : program.getInstructions()) {
+                if (Op::OP_NUMBER == instruction.code || Op::OP_VARIABLE == instruction.code) {
+                    stack.push_back(this->leaf(instruction));
+                    continue;
+                }
+                arity = FunctionRegistry::getArity(instruction.code);
+                result = this->apply(instruction.code, &stack[stack.size() - arity], guarded);
+                if (guarded) {
+                    report.protectedOperations++;
+                } else if (result.isNonFinite()) {
+                    report.nonFiniteOperations++;
+                }
+                stack.resize(stack.size() - arity);
+                stack.push_back(result);
+            }
+            report.range = stack.back();
+            return report;
+        }
+
+        /**
+         * 利用变量的范围化简，返回新的程序
+         *
+         * 在输入的范围内结果不变：一定走保护分支的除法和 log 换成 0 ；条件一定成立或者一定
+         * 不成立的 if 只留下对应的分支；两个参数的范围不相交的 min 、max 只留下对应的参数；
+         * 参数一定不小于 0 的 abs 去掉。最后再调用 Program::simplify() 折叠常数。
+         *
+         * @param const Program& program
+         * @return Program
+         */
+        Program simplify(const Program& program) const {
+            // 栈里记录每个子表达式在 result 中开始的位置和它的范围
+            struct Segment {
+                unsigned long begin;
+                Interval interval;
+            };
+            std::vector<Instruction> result;
+            std::vector<Segment> stack;
+            Segment segment;
+            Interval arguments[3];
+            bool guarded;
+            int arity, keep;
+            for (auto& instruction : program.getInstructions()) {
+                if (Op::OP_NUMBER == instruction.code || Op::OP_VARIABLE == instruction.code) {
+                    segment.begin = result.size();
+                    segment.interval = this->leaf(instruction);
+                    stack.push_back(segment);
+                    result.push_back(instruction);
+                    continue;
+                }
+                arity = FunctionRegistry::getArity(instruction.code);
+                for (int k = 0; k < arity; k++) {
+                    arguments[k] = stack[stack.size() - arity + k].interval;
+                }
+                segment.begin = stack[stack.size() - arity].begin;
+                segment.interval = this->apply(instruction.code, arguments, guarded);
+                keep = this->select(instruction.code, arguments);
+                if (guarded) {
+                    result.resize(segment.begin);
+                    Instruction zero;
+                    zero.code = Op::OP_NUMBER;
+                    zero.variable = 0;
+                    zero.value = 0.0L;
+                    result.push_back(zero);
+                } else if (keep >= 0) {
+                    // 只保留第 keep 个参数：先删掉后面的参数，再删掉前面的
+                    unsigned long begin = stack[stack.size() - arity + keep].begin;
+                    unsigned long end = keep + 1 < arity ? stack[stack.size() - arity + keep + 1].begin : result.size();
+                    result.resize(end);
+                    result.erase(result.begin() + segment.begin, result.begin() + begin);
+                } else {
+                    result.push_back(instruction);
+                }
+                stack.resize(stack.size() - arity);
+                stack.push_back(segment);
+            }
+            Program simplified;
+            for (auto& instruction : result) {
+                if (Op::OP_NUMBER == instruction.code) {
+                    simplified.pushNumber(instruction.value);
+                } else if (Op::OP_VARIABLE == instruction.code) {
+                    simplified.pushVariable(instruction.variable);
+                } else {
+                    simplified.pushOperation(instruction.code);
+                }
+            }
+            return simplified.simplify();
+        }
+
+    private:
+        // 输入变量的范围
+        std::vector<Interval> variables;
+
+        // 私有，常数和变量的范围
+        Interval leaf(const Instruction& instruction) const {
+            if (Op::OP_NUMBER == instruction.code) {
+                long double value = instruction.value;
+                return value != value ? Interval::make(1.0L, 0.0L, true) : Interval::make(value, value);
+            }
+            if (instruction.variable < 0 || (unsigned long)instruction.variable >= this->variables.size()) {
+                return Interval::any();
+            }
+            return this->variables[instruction.variable];
+        }
+
+        // 私有，一个运算的结果范围，guarded 表示一定走保护分支
+        Interval apply(int code, const Interval* arguments, bool& guarded) const {
+            const Interval& a = arguments[0];
+            const Interval& b = arguments[1];
+            guarded = false;
+            switch (code) {
+                case 1:
+                    return this->combine(a, b, code);
+                case 2:
+                    return this->combine(a, b, code);
+                case 3:
+                    return this->combine(a, b, code);
+                case 4: {
+                    // b < 1E-18 ? 0 : a / b ，b 是 nan 时比较不成立，结果是 nan
+                    if (!b.nan && b.upper < 1E-18L) {
+                        guarded = true;
+                        return Interval::make(0.0L, 0.0L);
+                    }
+                    Interval divisor = Interval::make(std::max(b.lower, 1E-18L), b.upper, b.nan);
+                    Interval result = this->combine(a, divisor, code);
+                    if (b.isEmpty() || b.lower < 1E-18L) {
+                        result = this->join(result, Interval::make(0.0L, 0.0L));
+                    }
+                    return result;
+                }
+                case 6: {
+                    Interval magnitude = this->magnitude(a);
+                    return this->widen(Interval::make(std::sqrt(magnitude.lower), std::sqrt(magnitude.upper), a.nan));
+                }
+                case 7:
+                    return this->widen(Interval::make(std::exp(std::min(a.lower, 700.0L)), std::exp(std::min(a.upper, 700.0L)), a.nan));
+                case 8: {
+                    // |a| < 1E-18 ? 0 : log(|a|)
+                    Interval magnitude = this->magnitude(a);
+                    if (!a.nan && magnitude.upper < 1E-18L) {
+                        guarded = true;
+                        return Interval::make(0.0L, 0.0L);
+                    }
+                    Interval result = this->widen(Interval::make(std::log(std::max(magnitude.lower, 1E-18L)), std::log(magnitude.upper), a.nan));
+                    if (magnitude.isEmpty() || magnitude.lower < 1E-18L) {
+                        result = this->join(result, Interval::make(0.0L, 0.0L));
+                    }
+                    return result;
+                }
+                case 9: {
+                    // sin(inf) 是 nan
+                    bool nan = a.nan || std::isinf(a.lower) || std::isinf(a.upper);
+                    if (a.isEmpty() || (a.lower == a.upper && std::isinf(a.lower))) {
+                        return Interval::make(1.0L, 0.0L, nan);
+                    }
+                    if (a.lower == a.upper) {
+                        return this->widen(Interval::make(std::sin(a.lower), std::sin(a.lower), nan));
+                    }
+                    return Interval::make(-1.0L, 1.0L, nan);
+                }
+                case 10: {
+                    Interval magnitude = this->magnitude(a);
+                    magnitude.nan = a.nan;
+                    return magnitude;
+                }
+                case 11:
+                case 12:
+                    // a < b ? a : b ，a > b ? a : b ，有 nan 时比较不成立，结果是 b
+                    if (a.nan || b.nan || a.isEmpty() || b.isEmpty()) {
+                        return this->join(a, b);
+                    }
+                    if (11 == code) {
+                        return Interval::make(std::min(a.lower, b.lower), std::min(a.upper, b.upper));
+                    }
+                    return Interval::make(std::max(a.lower, b.lower), std::max(a.upper, b.upper));
+                case 13: {
+                    int branch = this->select(code, arguments);
+                    return branch > 0 ? arguments[branch] : this->join(arguments[1], arguments[2]);
+                }
+                default:
+                    break;
+            }
+            return Interval::any();
+        }
+
+        // 私有，结果一定等于第几个参数，不能确定时返回 -1
+        int select(int code, const Interval* arguments) const {
+            const Interval& a = arguments[0];
+            switch (code) {
+                case 10:
+                    return !a.nan && !a.isEmpty() && a.lower >= 0.0L ? 0 : -1;
+                case 11:
+                case 12: {
+                    const Interval& b = arguments[1];
+                    if (a.nan || b.nan || a.isEmpty() || b.isEmpty()) {
+                        return -1;
+                    }
+                    const Interval& low = 11 == code ? a : b;
+                    const Interval& high = 11 == code ? b : a;
+                    // 比较一定成立时是 a ，一定不成立时是 b
+                    if (low.upper < high.lower) {
+                        return 0;
+                    }
+                    if ((11 == code && b.upper <= a.lower) || (12 == code && a.upper <= b.lower)) {
+                        return 1;
+                    }
+                    return -1;
+                }
+                case 13:
+                    // a > 0 ? b : c ，a 是 nan 时是 c
+                    if (!a.nan && !a.isEmpty() && a.lower > 0.0L) {
+                        return 1;
+                    }
+                    if (a.isEmpty() || a.upper <= 0.0L) {
+                        return 2;
+                    }
+                    return -1;
+                default:
+                    return -1;
+            }
+        }
+
+        // 私有，加减乘除的区间运算：端点两两运算取最小和最大，出现 nan（例如 inf-inf 、0*inf）的组合只记录 nan
+        Interval combine(const Interval& a, const Interval& b, int code) const {
+            Interval result = Interval::make(std::numeric_limits<long double>::infinity(), -std::numeric_limits<long double>::infinity(), a.nan || b.nan);
+            if (a.isEmpty() || b.isEmpty()) {
+                return result;
+            }
+            const long double left[2] = {a.lower, a.upper};
+            // 减法是加上 -b ，端点交换
+            const long double right[2] = {2 == code ? -b.upper : b.lower, 2 == code ? -b.lower : b.upper};
+            long double value;
+            for (int i = 0; i < 2; i++) {
+                for (int j = 0; j < 2; j++) {
+                    value = 3 == code ? left[i] * right[j] : (4 == code ? left[i] / right[j] : left[i] + right[j]);
+                    if (value != value) {
+                        result.nan = true;
+                        continue;
+                    }
+                    result.lower = std::min(result.lower, value);
+                    result.upper = std::max(result.upper, value);
+                }
+            }
+            // 乘法中 0 在区间内部、另一边有 inf 时，端点之外也会得到 nan
+            if (3 == code && ((a.lower < 0.0L && a.upper > 0.0L && (std::isinf(b.lower) || std::isinf(b.upper))) || (b.lower < 0.0L && b.upper > 0.0L && (std::isinf(a.lower) || std::isinf(a.upper))))) {
+                result.nan = true;
+            }
+            return this->widen(result);
+        }
+
+        // 私有，|a| 的范围
+        Interval magnitude(const Interval& a) const {
+            if (a.isEmpty()) {
+                return a;
+            }
+            if (a.lower >= 0.0L) {
+                return Interval::make(a.lower, a.upper);
+            }
+            if (a.upper <= 0.0L) {
+                return Interval::make(-a.upper, -a.lower);
+            }
+            return Interval::make(0.0L, std::max(-a.lower, a.upper));
+        }
+
+        // 私有，两个范围的并
+        Interval join(const Interval& a, const Interval& b) const {
+            if (a.isEmpty()) {
+                return Interval::make(b.lower, b.upper, a.nan || b.nan);
+            }
+            if (b.isEmpty()) {
+                return Interval::make(a.lower, a.upper, a.nan || b.nan);
+            }
+            return Interval::make(std::min(a.lower, b.lower), std::max(a.upper, b.upper), a.nan || b.nan);
+        }
+
+        // 私有，有限的端点向外放宽，覆盖舍入误差
+        Interval widen(const Interval& a) const {
+            Interval result = a;
+            if (result.isEmpty()) {
+                return result;
+            }
+            if (std::isfinite(result.lower)) {
+                result.lower -= std::fabs(result.lower) * 1E-14L + std::numeric_limits<long double>::denorm_min();
+            }
+            if (std::isfinite(result.upper)) {
+                result.upper += std::fabs(result.upper) * 1E-14L + std::numeric_limits<long double>::denorm_min();
+            }
+            return result;
+        }
+
+    };
+
+}
+
+#endif
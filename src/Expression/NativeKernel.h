@@ -0,0 +1,127 @@
+#ifndef EXPRESSION_NATIVEKERNEL_H
+#define EXPRESSION_NATIVEKERNEL_H
+
+#include "Program.h"
+#include "CodeGenerator.h"
+#include <string>
+#include <fstream>
+#include <cstdlib>
+#include <cstdio>
+#include <unistd.h>
+#include <dlfcn.h>
+
+namespace Expression {
+
+    /* 用本机的编译器把 Program 编译成动态库并加载
+     *
+     * 需要 POSIX 的 dlopen ，静态链接的程序不能用，所以只有打开 CMake 选项
+     * GEP_ENABLE_NATIVE_KERNEL 时才会编译进来。编译器默认是 cc ，可以通过环境变量
+     * GEP_KERNEL_CC 指定。
+     */
+    class NativeKernel {
+
+    public:
+
+        // 编译出来的函数的类型
+        typedef long double (*Function)(const long double*);
+
+        /**
+         * 生成代码、编译并加载
+         *
+         * @param const Program& program
+         * @param const std::string& functionName 函数名
+         */
+        NativeKernel(const Program& program, const std::string& functionName = "gep_kernel") {
+            using namespace std;
+            char directoryTemplate[] = "/tmp/gep-kernel-XXXXXX";
+            if (nullptr == mkdtemp(directoryTemplate)) {
+                throw "Error, mkdtemp() failed, in Expression::NativeKernel.";
+            }
+            this->directory = directoryTemplate;
+            this->sourceFile = this->directory + "/kernel.c";
+            this->libraryFile = this->directory + "/kernel.so";
+            ofstream source(this->sourceFile.c_str());
+            source << CodeGenerator().generate(program, functionName);
+            source.close();
+            if (!source) {
+                this->cleanFiles();
+                throw "Error, can not write kernel source, in Expression::NativeKernel.";
+            }
+            const char* compiler = getenv("GEP_KERNEL_CC");
+            string command = string(nullptr == compiler ? "cc" : compiler)
+                + " -O2 -shared -fPIC -o '" + this->libraryFile + "' '" + this->sourceFile + "' -lm";
+            if (0 != system(command.c_str())) {
+                this->cleanFiles();
+                throw "Error, failed to compile kernel, in Expression::NativeKernel.";
+            }
+            this->handle = dlopen(this->libraryFile.c_str(), RTLD_NOW | RTLD_LOCAL);
+            if (nullptr == this->handle) {
+                this->cleanFiles();
+                throw "Error, dlopen() failed, in Expression::NativeKernel.";
+            }
+            this->function = (Function)dlsym(this->handle, functionName.c_str());
+            if (nullptr == this->function) {
+                dlclose(this->handle);
+                this->cleanFiles();
+                throw "Error, dlsym() failed, in Expression::NativeKernel.";
+            }
+        }
+
+        // 卸载动态库，删除临时文件
+        ~NativeKernel() {
+            dlclose(this->handle);
+            this->cleanFiles();
+        }
+
+        NativeKernel(const NativeKernel&) = delete;
+
+        NativeKernel& operator=(const NativeKernel&) = delete;
+
+        /**
+         * 获取编译好的函数
+         *
+         * @return Function
+         */
+        Function getFunction() {
+            return this->function;
+        }
+
+        /**
+         * 调用编译好的函数
+         *
+         * @param const long double* variables 一行输入变量
+         * @return long double
+         */
+        long double call(const long double* variables) {
+            return this->function(variables);
+        }
+
+    private:
+
+        /** @var std::string 存放源码和动态库的临时目录 */
+        std::string directory;
+
+        /** @var std::string 源码文件 */
+        std::string sourceFile;
+
+        /** @var std::string 动态库文件 */
+        std::string libraryFile;
+
+        /** @var void* dlopen() 返回的句柄 */
+        void* handle = nullptr;
+
+        /** @var Function 函数指针 */
+        Function function = nullptr;
+
+        // 私有，删除临时文件
+        void cleanFiles() {
+            std::remove(this->sourceFile.c_str());
+            std::remove(this->libraryFile.c_str());
+            rmdir(this->directory.c_str());
+        }
+
+    };
+
+}
+
+#endif
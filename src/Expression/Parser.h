@@ -0,0 +1,185 @@
+#ifndef EXPRESSION_PARSER_H
+#define EXPRESSION_PARSER_H
+
+#include "../Op.h"
+#include "../FunctionRegistry.h"
+#include "Program.h"
+#include <string>
+#include <cstdlib>
+#include <cctype>
+
+namespace Expression {
+
+    /* 中缀表达式解析，得到后缀形式的 Program
+     *
+     * 能读回 Chromosome::dump() 打印的格式：完全加括号的 (a+b)、负数 (-1.5)、变量 x0、
+     * 前缀函数 sqrt(a)、min(a,b)，末尾的 "=值" 会被忽略。也接受不加括号的写法，按通常的
+     * 优先级：* / 高于 + - ，同级从左到右，一元负号写成 0-a 。
+     */
+    class Parser {
+
+    public:
+
+        /**
+         * 解析表达式
+         *
+         * @param const std::string& text
+         * @return Program
+         */
+        static Program parse(const std::string& text) {
+            Parser parser(text);
+            Program program;
+            parser.parseSum(program);
+            parser.skipSpace();
+            if ('=' == parser.peek()) { // dump() 输出的值
+                parser.position = parser.text.size();
+            }
+            if (parser.position != parser.text.size()) {
+                throw "Error, unexpected character, in Expression::Parser::parse().";
+            }
+            return program;
+        }
+
+    private:
+
+        /** @var std::string 表达式 */
+        std::string text;
+
+        /** @var unsigned long 当前位置 */
+        unsigned long position = 0;
+
+        Parser(const std::string& text) : text(text) {
+        }
+
+        // 私有，加减
+        void parseSum(Program& program) {
+            this->parseProduct(program);
+            while (true) {
+                this->skipSpace();
+                char c = this->peek();
+                if ('+' != c && '-' != c) {
+                    return;
+                }
+                this->position++;
+                this->parseProduct(program);
+                program.pushOperation('+' == c ? Op::ADD : Op::SUB);
+            }
+        }
+
+        // 私有，乘除
+        void parseProduct(Program& program) {
+            this->parseUnary(program);
+            while (true) {
+                this->skipSpace();
+                char c = this->peek();
+                if ('*' != c && '/' != c) {
+                    return;
+                }
+                this->position++;
+                this->parseUnary(program);
+                program.pushOperation('*' == c ? Op::PRO : Op::DES);
+            }
+        }
+
+        // 私有，一元负号：负数直接作为常数，其它写成 0-a
+        void parseUnary(Program& program) {
+            this->skipSpace();
+            if ('-' != this->peek()) {
+                this->parsePrimary(program);
+                return;
+            }
+            this->position++;
+            this->skipSpace();
+            if (isdigit((unsigned char)this->peek()) || '.' == this->peek()) {
+                program.pushNumber(-this->parseNumber());
+                return;
+            }
+            program.pushNumber(0.0L);
+            this->parseUnary(program);
+            program.pushOperation(Op::SUB);
+        }
+
+        // 私有，数字、变量、函数调用、括号
+        void parsePrimary(Program& program) {
+            this->skipSpace();
+            char c = this->peek();
+            if ('(' == c) {
+                this->position++;
+                this->parseSum(program);
+                this->expect(')');
+                return;
+            }
+            if (isdigit((unsigned char)c) || '.' == c) {
+                program.pushNumber(this->parseNumber());
+                return;
+            }
+            if (!isalpha((unsigned char)c) && '_' != c) {
+                throw "Error, expect an operand, in Expression::Parser::parse().";
+            }
+            unsigned long begin = this->position;
+            while (this->position < this->text.size() && (isalnum((unsigned char)this->text[this->position]) || '_' == this->text[this->position])) {
+                this->position++;
+            }
+            std::string name = this->text.substr(begin, this->position - begin);
+            this->skipSpace();
+            if ('(' != this->peek()) {
+                if (name.size() > 1 && 'x' == name[0] && name.find_first_not_of("0123456789", 1) == std::string::npos) {
+                    program.pushVariable((int)strtol(name.c_str() + 1, nullptr, 10));
+                    return;
+                }
+                throw "Error, unknown name, in Expression::Parser::parse().";
+            }
+            int id = FunctionRegistry::find(name);
+            if (0 == id) {
+                throw "Error, unknown function, in Expression::Parser::parse().";
+            }
+            int arity = FunctionRegistry::getArity(id);
+            this->position++;
+            for (int k = 0; k < arity; k++) {
+                if (k > 0) {
+                    this->expect(',');
+                }
+                this->parseSum(program);
+            }
+            this->expect(')');
+            program.pushOperation(id);
+        }
+
+        // 私有，读一个非负数
+        long double parseNumber() {
+            const char* begin = this->text.c_str() + this->position;
+            char* end;
+            long double value = strtold(begin, &end);
+            if (end == begin) {
+                throw "Error, bad number, in Expression::Parser::parse().";
+            }
+            this->position += end - begin;
+            return value;
+        }
+
+        // 私有，下一个字符必须是 c
+        void expect(char c) {
+            this->skipSpace();
+            if (c != this->peek()) {
+                throw ',' == c ? "Error, expect ',', in Expression::Parser::parse()." : "Error, expect ')', in Expression::Parser::parse().";
+            }
+            this->position++;
+        }
+
+        // 私有，跳过空白
+        void skipSpace() {
+            while (this->position < this->text.size() && isspace((unsigned char)this->text[this->position])) {
+                this->position++;
+            }
+        }
+
+        // 私有，当前字符，到结尾时是 '\0'
+        char peek() {
+            return this->position < this->text.size() ? this->text[this->position] : '\0';
+        }
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,14 @@
+#include "Program.h"
+
+namespace Expression {
+
+    // 常用的数值类型，库的使用者不必再实例化
+    template float Program::evaluate<float>(const float* variables) const;
+    template double Program::evaluate<double>(const double* variables) const;
+    template long double Program::evaluate<long double>(const long double* variables) const;
+
+    template void Program::evaluateBlock<float>(const float* const* columns, unsigned long count, float* output, std::vector<float>& workspace) const;
+    template void Program::evaluateBlock<double>(const double* const* columns, unsigned long count, double* output, std::vector<double>& workspace) const;
+    template void Program::evaluateBlock<long double>(const long double* const* columns, unsigned long count, long double* output, std::vector<long double>& workspace) const;
+
+}
@@ -0,0 +1,382 @@
+#ifndef EXPRESSION_PROGRAM_H
+#define EXPRESSION_PROGRAM_H
+
+#include "../Op.h"
+#include <vector>
+#include <algorithm>
+
+namespace Expression {
+
+    /* 指令，后缀表达式中的一项
+     */
+    struct Instruction {
+        // Op::OP_NUMBER 表示常数，Op::OP_VARIABLE 表示输入变量，否则是运算符的类型，例如 Op::ADD
+        int code;
+        // code 为 Op::OP_VARIABLE 时，变量的序号
+        int variable;
+        // code 为 Op::OP_NUMBER 时，常数的值
+        long double value;
+    };
+
+    /* 后缀表达式（逆波兰式）形式的程序
+     *
+     * 由染色体的基因直接解码得到，和 Chromosome::buildTree() 构造出来的语法树计算结果
+     * 一致。顺序执行指令数组不需要构造树、不需要分配节点，也方便做化简和生成代码。
+     */
+    class Program {
+
+    private:
+
+        /** @var std::vector<Instruction> 后缀表达式 */
+        std::vector<Instruction> instructions;
+
+    public:
+
+        Program() {
+        }
+
+        /**
+         * 按照 Karva 表示法解码基因，得到后缀表达式
+         *
+         * 规则和 Chromosome::buildTree() 相同：广度优先地按参数个数给运算符填充子节点，
+         * 遇到 Op::END 时跳到尾部取数字。
+         *
+         * @param Op** genes 基因数组
+         * @param unsigned long length 基因数组的长度
+         * @param unsigned long beginOfTail 尾部开始的位置
+         * @return Program
+         */
+        static Program decode(Op** genes, unsigned long length, unsigned long beginOfTail) {
+            Program program;
+            if (nullptr == genes[0]) {
+                throw "Error, nullptr == genes[0], in Expression::Program::decode().";
+            }
+            if (Op::OP_OPERATION == genes[0]->getOpType() && Op::END == genes[0]->getTypeValue()) {
+                program.pushNumber(0.0L);
+                return program;
+            }
+            // 广度优先，按层记录每个节点对应的基因位置，子节点在数组里面是连续的
+            std::vector<unsigned long> nodeGene;
+            std::vector<unsigned long> firstChild;
+            nodeGene.reserve(length);
+            firstChild.reserve(length);
+            nodeGene.push_back(0);
+            unsigned long offset = 1;
+            Op* childOp;
+            for (unsigned long k = 0; k < nodeGene.size(); k++) {
+                firstChild.push_back(nodeGene.size());
+                if (Op::OP_OPERATION != genes[nodeGene[k]]->getOpType()) {
+                    continue;
+                }
+                int arity = FunctionRegistry::getArity(genes[nodeGene[k]]->getTypeValue());
+                for (int child = 0; child < arity; child++) {
+                    if (offset >= length) {
+                        throw "Error, out of size, in Expression::Program::decode().";
+                    }
+                    childOp = genes[offset];
+                    if (Op::OP_OPERATION == childOp->getOpType() && Op::END == childOp->getTypeValue()) {
+                        offset = beginOfTail;
+                    }
+                    nodeGene.push_back(offset);
+                    offset++;
+                }
+            }
+            program.instructions.reserve(nodeGene.size());
+            program.emit(genes, nodeGene, firstChild, 0);
+            return program;
+        }
+
+        /**
+         * 在末尾追加一个常数
+         *
+         * @param long double value
+         * @return void
+         */
+        void pushNumber(long double value) {
+            Instruction instruction;
+            instruction.code = Op::OP_NUMBER;
+            instruction.variable = 0;
+            instruction.value = value;
+            this->instructions.push_back(instruction);
+        }
+
+        /**
+         * 在末尾追加一个输入变量
+         *
+         * @param int index 变量的序号，从 0 开始
+         * @return void
+         */
+        void pushVariable(int index) {
+            Instruction instruction;
+            instruction.code = Op::OP_VARIABLE;
+            instruction.variable = index;
+            instruction.value = 0.0L;
+            this->instructions.push_back(instruction);
+        }
+
+        /**
+         * 在末尾追加一个运算符
+         *
+         * @param int code 运算符类型，例如 Op::ADD
+         * @return void
+         */
+        void pushOperation(int code) {
+            Instruction instruction;
+            instruction.code = code;
+            instruction.variable = 0;
+            instruction.value = 0.0L;
+            this->instructions.push_back(instruction);
+        }
+
+        /**
+         * 在末尾追加另一个程序的全部指令，它的结果会留在栈顶
+         *
+         * @param const Program& another
+         * @return void
+         */
+        void append(const Program& another) {
+            this->instructions.insert(this->instructions.end(), another.instructions.begin(), another.instructions.end());
+        }
+
+        /**
+         * 获取指令数组
+         *
+         * @return const std::vector<Instruction>&
+         */
+        const std::vector<Instruction>& getInstructions() const {
+            return this->instructions;
+        }
+
+        /**
+         * 获取指令的数量
+         *
+         * @return unsigned long
+         */
+        unsigned long size() const {
+            return this->instructions.size();
+        }
+
+        /**
+         * 程序用到的输入变量的个数，也就是最大的变量序号加 1
+         *
+         * @return int
+         */
+        int getVariableNumber() const {
+            int number = 0;
+            for (auto& instruction : this->instructions) {
+                if (Op::OP_VARIABLE == instruction.code && instruction.variable >= number) {
+                    number = instruction.variable + 1;
+                }
+            }
+            return number;
+        }
+
+        /**
+         * 计算时栈的最大深度
+         *
+         * @return unsigned long
+         */
+        unsigned long getMaxDepth() const {
+            unsigned long depth = 0, maxDepth = 0;
+            for (auto& instruction : this->instructions) {
+                if (Op::OP_NUMBER == instruction.code || Op::OP_VARIABLE == instruction.code) {
+                    depth++;
+                    if (depth > maxDepth) {
+                        maxDepth = depth;
+                    }
+                } else {
+                    depth -= FunctionRegistry::getArity(instruction.code) - 1;
+                }
+            }
+            return maxDepth;
+        }
+
+        /**
+         * 是否整个程序只是一个常数
+         *
+         * @return bool
+         */
+        bool isConstant() const {
+            return 1 == this->instructions.size() && Op::OP_NUMBER == this->instructions[0].code;
+        }
+
+        /**
+         * 计算程序的值
+         *
+         * @param const T* variables 输入变量，程序中没有变量时可以是 nullptr
+         * @return T
+         */
+        template<class T>
+        T evaluate(const T* variables = nullptr) const {
+            if (this->instructions.empty()) {
+                throw "Error, empty program, in Expression::Program::evaluate().";
+            }
+            std::vector<T> stack(this->instructions.size());
+            unsigned long top = 0;
+            for (auto& instruction : this->instructions) {
+                if (Op::OP_NUMBER == instruction.code) {
+                    stack[top++] = (T)instruction.value;
+                    continue;
+                }
+                if (Op::OP_VARIABLE == instruction.code) {
+                    stack[top++] = nullptr == variables ? (T)0 : variables[instruction.variable];
+                    continue;
+                }
+                top -= FunctionRegistry::getArity(instruction.code);
+                stack[top] = FunctionRegistry::apply<T>(instruction.code, &stack[top]);
+                top++;
+            }
+            return stack[0];
+        }
+
+        /**
+         * 对一批数据计算程序的值
+         *
+         * 按列存储输入，每条指令对整批数据执行一个简单的循环，编译器可以向量化。
+         *
+         * @param const T* const* columns columns[i] 是第 i 个变量的 count 个值
+         * @param unsigned long count 数据的行数
+         * @param T* output 输出 count 个结果
+         * @param std::vector<T>& workspace 工作空间，会按需扩大，可以在多次调用之间重复使用
+         * @return void
+         */
+        template<class T>
+        void evaluateBlock(const T* const* columns, unsigned long count, T* output, std::vector<T>& workspace) const {
+            if (this->instructions.empty()) {
+                throw "Error, empty program, in Expression::Program::evaluateBlock().";
+            }
+            if (workspace.size() < this->getMaxDepth() * count) {
+                workspace.resize(this->getMaxDepth() * count);
+            }
+            T* stack = workspace.data();
+            unsigned long top = 0;
+            const T* arguments[3];
+            int arity;
+            for (auto& instruction : this->instructions) {
+                if (Op::OP_NUMBER == instruction.code) {
+                    std::fill(stack + top * count, stack + (top + 1) * count, (T)instruction.value);
+                    top++;
+                    continue;
+                }
+                if (Op::OP_VARIABLE == instruction.code) {
+                    std::copy(columns[instruction.variable], columns[instruction.variable] + count, stack + top * count);
+                    top++;
+                    continue;
+                }
+                arity = FunctionRegistry::getArity(instruction.code);
+                top -= arity;
+                for (int k = 0; k < arity; k++) {
+                    arguments[k] = stack + (top + k) * count;
+                }
+                FunctionRegistry::applyBlock<T>(instruction.code, stack + top * count, arguments, count);
+                top++;
+            }
+            std::copy(stack, stack + count, output);
+        }
+
+        /**
+         * 化简，返回新的程序
+         *
+         * 折叠只含常数的子表达式，并去掉 x+0、0+x、x-0、x*1、1*x、x/1 这样的运算。
+         * 不处理 0*x ，因为 x 溢出成 inf 的时候结果是 nan 而不是 0 。
+         *
+         * @return Program
+         */
+        Program simplify() const {
+            // 栈里记录每个子表达式在 result 中开始的位置
+            struct Segment {
+                unsigned long begin;
+                bool isNumber;
+                long double value;
+            };
+            Program result;
+            std::vector<Segment> stack;
+            Segment left = Segment(), right = Segment(), segment;
+            long double values[3];
+            bool allNumber;
+            int arity;
+            for (auto& instruction : this->instructions) {
+                if (Op::OP_VARIABLE == instruction.code) {
+                    segment.begin = result.instructions.size();
+                    segment.isNumber = false;
+                    segment.value = 0.0L;
+                    stack.push_back(segment);
+                    result.instructions.push_back(instruction);
+                    continue;
+                }
+                if (Op::OP_NUMBER == instruction.code) {
+                    segment.begin = result.instructions.size();
+                    segment.isNumber = true;
+                    segment.value = instruction.value;
+                    stack.push_back(segment);
+                    result.instructions.push_back(instruction);
+                    continue;
+                }
+                arity = FunctionRegistry::getArity(instruction.code);
+                allNumber = true;
+                for (int k = 0; k < arity; k++) {
+                    allNumber = allNumber && stack[stack.size() - arity + k].isNumber;
+                    values[k] = stack[stack.size() - arity + k].value;
+                }
+                segment.begin = stack[stack.size() - arity].begin;
+                segment.isNumber = false;
+                segment.value = 0.0L;
+                if (2 == arity) {
+                    right = stack.back();
+                    left = stack[stack.size() - 2];
+                }
+                stack.resize(stack.size() - arity);
+                if (allNumber) {
+                    result.instructions.resize(segment.begin);
+                    segment.isNumber = true;
+                    segment.value = FunctionRegistry::apply<long double>(instruction.code, values);
+                    result.pushNumber(segment.value);
+                } else if (2 != arity) {
+                    result.instructions.push_back(instruction);
+                } else if (right.isNumber && 0.0L == right.value && (Op::ADD == instruction.code || Op::SUB == instruction.code)) {
+                    result.instructions.resize(right.begin);
+                } else if (right.isNumber && 1.0L == right.value && (Op::PRO == instruction.code || Op::DES == instruction.code)) {
+                    result.instructions.resize(right.begin);
+                } else if (left.isNumber && ((0.0L == left.value && Op::ADD == instruction.code) || (1.0L == left.value && Op::PRO == instruction.code))) {
+                    result.instructions.erase(result.instructions.begin() + left.begin);
+                } else {
+                    result.instructions.push_back(instruction);
+                }
+                stack.push_back(segment);
+            }
+            return result;
+        }
+
+    private:
+
+        // 私有，按后序遍历输出以 node 为根的子树
+        void emit(Op** genes, const std::vector<unsigned long>& nodeGene, const std::vector<unsigned long>& firstChild, unsigned long node) {
+            Op* op = genes[nodeGene[node]];
+            if (Op::OP_VARIABLE == op->getOpType()) {
+                this->pushVariable(op->getTypeValue());
+                return;
+            }
+            if (Op::OP_OPERATION != op->getOpType() || Op::END == op->getTypeValue()) {
+                this->pushNumber(op->getValue());
+                return;
+            }
+            int arity = FunctionRegistry::getArity(op->getTypeValue());
+            for (int child = 0; child < arity; child++) {
+                this->emit(genes, nodeGene, firstChild, firstChild[node] + child);
+            }
+            this->pushOperation(op->getTypeValue());
+        }
+
+    };
+
+    extern template float Program::evaluate<float>(const float* variables) const;
+    extern template double Program::evaluate<double>(const double* variables) const;
+    extern template long double Program::evaluate<long double>(const long double* variables) const;
+
+    extern template void Program::evaluateBlock<float>(const float* const* columns, unsigned long count, float* output, std::vector<float>& workspace) const;
+    extern template void Program::evaluateBlock<double>(const double* const* columns, unsigned long count, double* output, std::vector<double>& workspace) const;
+    extern template void Program::evaluateBlock<long double>(const long double* const* columns, unsigned long count, long double* output, std::vector<long double>& workspace) const;
+
+}
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef FITNESS_BLOCKEDEVALUATION_H
+#define FITNESS_BLOCKEDEVALUATION_H
+
+#include "Policies.h"
+#include "../Expression/Program.h"
+#include "../Expression/ExpressionStore.h"
+#include "../Data/Dataset.h"
+#include <vector>
+#include <thread>
+#include <unistd.h>
+
+namespace Fitness {
+
+    /* 整个种群一起在数据集上计算适应度
+     *
+     * 一个一个个体地用 score() 计算时，每个个体都把整个数据集从内存读一遍，一代要读种群大小
+     * 那么多遍。这里反过来分块：取出能放进二级缓存的一块行，所有待计算的个体依次在这块上
+     * 计算并累加各自的策略状态，再换下一块。每个线程负责一部分个体，数据集从内存读的次数
+     * 从个体数降到线程数。
+     */
+    class BlockedEvaluation {
+
+    public:
+
+        /**
+         * 二级缓存的大小，系统报告不了时按 256 KiB
+         *
+         * @return unsigned long
+         */
+        static unsigned long getCacheSize() {
+            static const unsigned long size = detectCacheSize();
+            return size;
+        }
+
+        /**
+         * 一块的行数：这块的输入列、目标值、输出和最深的工作栈一起放得进二级缓存的一半，
+         * 另一半留给程序和其它数据
+         *
+         * @param unsigned long variableNumber
+         * @param unsigned long maxDepth 程序的最大栈深度
+         * @return unsigned long
+         */
+        static unsigned long getBlockRows(unsigned long variableNumber, unsigned long maxDepth) {
+            unsigned long rows = getCacheSize() / 2 / (sizeof(long double) * (variableNumber + maxDepth + 2));
+            // 太小时每条指令的循环太短，太大时失去意义
+            return rows < 64 ? 64 : (rows > 8192 ? 8192 : rows);
+        }
+
+    private:
+
+        // 私有，读取二级缓存的大小
+        static unsigned long detectCacheSize() {
+#ifdef _SC_LEVEL2_CACHE_SIZE
+            long size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+            if (size > 0) {
+                return (unsigned long)size;
+            }
+#endif
+            return 256UL << 10;
+        }
+
+    };
+
+    /**
+     * 用策略计算一批程序在数据集上的适应度，分块、多线程，见 BlockedEvaluation
+     *
+     * 结果和对每个程序调用 score() 相同。
+     *
+     * @param const Policy& policy
+     * @param const Expression::Program* programs
+     * @param unsigned long count 程序的个数
+     * @param const Data::Dataset& dataset
+     * @param long double* fitness 写入 count 个适应度
+     * @param unsigned long threadNumber 线程数，0 时使用硬件线程数
+     * @return void
+     */
+    template<class Policy>
+    void scorePopulation(const Policy& policy, const Expression::Program* programs, unsigned long count, const Data::Dataset& dataset, long double* fitness, unsigned long threadNumber = 1) {
+        unsigned long maxDepth = 1;
+        int variableNumber = 0;
+        for (unsigned long i = 0; i < count; i++) {
+            // 线程里不能抛出异常，先检查
+            if (0 == programs[i].size()) {
+                throw "Error, empty program, in Fitness::scorePopulation().";
+            }
+            variableNumber = programs[i].getVariableNumber() > variableNumber ? programs[i].getVariableNumber() : variableNumber;
+            maxDepth = programs[i].getMaxDepth() > maxDepth ? programs[i].getMaxDepth() : maxDepth;
+        }
+        checkDataset(dataset, variableNumber);
+        if (0 == threadNumber) {
+            threadNumber = std::thread::hardware_concurrency();
+        }
+        threadNumber = threadNumber < 1 ? 1 : (threadNumber > count ? count : threadNumber);
+        const unsigned long blockRows = BlockedEvaluation::getBlockRows(dataset.getVariableNumber(), maxDepth);
+        // 第 thread 个线程计算下标为 thread、thread + threadNumber、…… 的程序，长短程序分得比较均匀
+        auto work = [&policy, programs, count, &dataset, fitness, threadNumber, blockRows](unsigned long thread) {
+            std::vector<long double> output(blockRows), workspace;
+            scoreBlocks(policy, dataset, blockRows, (count - thread + threadNumber - 1) / threadNumber, false, [programs, thread, threadNumber, &output, &workspace](unsigned long k, const long double* const* columns, unsigned long size) -> const long double* {
+                programs[thread + k * threadNumber].evaluateBlock<long double>(columns, size, output.data(), workspace);
+                return output.data();
+            }, ScoreAllRows(), fitness + thread, threadNumber);
+        };
+        if (1 >= threadNumber) {
+            if (count > 0) {
+                work(0);
+            }
+            return;
+        }
+        std::vector<std::thread> threads;
+        for (unsigned long thread = 1; thread < threadNumber; thread++) {
+            threads.push_back(std::thread(work, thread));
+        }
+        work(0);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    /**
+     * 用策略计算共用子表达式的存储中每个根节点在数据集上的适应度
+     *
+     * 按块调用 Expression::ExpressionStore::evaluateBlock() ，每个不同的子表达式在每块上只
+     * 计算一次，再把每个根节点的这块结果交给各自的策略状态累加。结果和对每个根节点对应的
+     * 程序调用 score() 相同。
+     *
+     * @param const Policy& policy
+     * @param Expression::ExpressionStore& store
+     * @param const unsigned long* roots store.add() 返回的根节点
+     * @param unsigned long count 根节点的个数
+     * @param const Data::Dataset& dataset
+     * @param long double* fitness 写入 count 个适应度
+     * @return void
+     */
+    template<class Policy>
+    void scoreStore(const Policy& policy, Expression::ExpressionStore& store, const unsigned long* roots, unsigned long count, const Data::Dataset& dataset, long double* fitness) {
+        static thread_local std::vector<long double> workspace;
+        checkDataset(dataset, store.getVariableNumber());
+        // 每块要保存所有节点的结果，按节点数代替栈深度估计一块的行数
+        const unsigned long blockRows = BlockedEvaluation::getBlockRows(dataset.getVariableNumber(), store.getNodeNumber());
+        // 每块只在第一个根节点时计算整个存储，其它根节点读取各自的结果
+        scoreBlocks(policy, dataset, blockRows, count, false, [&store, roots](unsigned long i, const long double* const* columns, unsigned long size) -> const long double* {
+            if (0 == i) {
+                store.evaluateBlock<long double>(columns, size, workspace);
+            }
+            return store.getBlockValue<long double>(workspace, size, roots[i]);
+        }, ScoreAllRows(), fitness);
+    }
+
+}
+
+#endif
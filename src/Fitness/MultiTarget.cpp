@@ -0,0 +1,24 @@
+#include "MultiTarget.h"
+
+namespace Fitness {
+
+    MultiTargetObjective* MultiTargetObjective::create(const std::string& name, const Data::Dataset& dataset) {
+        if ("mse" == name) {
+            return new MultiTargetPolicyObjective<MeanSquaredError>(dataset);
+        }
+        if ("mae" == name) {
+            return new MultiTargetPolicyObjective<MeanAbsoluteError>(dataset);
+        }
+        if ("r2" == name) {
+            return new MultiTargetPolicyObjective<RSquared>(dataset);
+        }
+        if ("hits" == name) {
+            return new MultiTargetPolicyObjective<HitCount>(dataset);
+        }
+        if ("accuracy" == name) {
+            return new MultiTargetPolicyObjective<ClassificationAccuracy>(dataset);
+        }
+        throw "Error, unknown objective, in Fitness::MultiTargetObjective::create().";
+    }
+
+}
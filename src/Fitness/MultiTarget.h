@@ -0,0 +1,119 @@
+#ifndef FITNESS_MULTITARGET_H
+#define FITNESS_MULTITARGET_H
+
+#include "Policies.h"
+#include "../Expression/Program.h"
+#include "../Data/Dataset.h"
+#include <string>
+#include <vector>
+
+namespace Fitness {
+
+    /* 同时对多个目标值计算适应度
+     *
+     * 每个个体的程序只计算一次，同一份结果和每个目标值比较，一次调用得到所有目标值的适应度。
+     * 用于 GeneticAlgorithm::MultiTargetProcess ，同一类公式拟合几十个目标值或者输出列时，
+     * 不需要为每个目标值单独运行一遍。
+     */
+    class MultiTargetObjective {
+
+    public:
+
+        virtual ~MultiTargetObjective() {
+        }
+
+        /**
+         * 目标值的个数
+         *
+         * @return unsigned long
+         */
+        virtual unsigned long getTargetNumber() const = 0;
+
+        /**
+         * 输入变量的个数，没有数据集时是 0
+         *
+         * @return unsigned long
+         */
+        virtual unsigned long getVariableNumber() const = 0;
+
+        /**
+         * 计算程序对每个目标值的适应度，越大越好，多个线程可以同时调用
+         *
+         * @param const Expression::Program& program
+         * @param long double* fitness 写入 getTargetNumber() 个适应度
+         * @return void
+         */
+        virtual void evaluate(const Expression::Program& program, long double* fitness) const = 0;
+
+        /**
+         * 按名字创建内置的适应度函数，和 Objective::create() 相同：mse、mae、r2、hits、accuracy
+         *
+         * @param const std::string& name
+         * @param const Data::Dataset& dataset 要比返回的对象活得长
+         * @return MultiTargetObjective* 用 new 创建，由调用者释放
+         */
+        static MultiTargetObjective* create(const std::string& name, const Data::Dataset& dataset);
+
+    };
+
+    // 没有数据集，表达式的值逼近若干个常数，每个常数的适应度和原来的 1 / ((目标 - 值)² + 1) 一样
+    class ConstantTargetObjective : public MultiTargetObjective {
+
+    public:
+
+        ConstantTargetObjective(const std::vector<long double>& targets) : targets(targets) {
+            if (this->targets.empty()) {
+                throw "Error, empty targets, in Fitness::ConstantTargetObjective.";
+            }
+        }
+
+        unsigned long getTargetNumber() const override {
+            return this->targets.size();
+        }
+
+        unsigned long getVariableNumber() const override {
+            return 0;
+        }
+
+        void evaluate(const Expression::Program& program, long double* fitness) const override {
+            long double value = program.evaluate<long double>();
+            for (unsigned long k = 0; k < this->targets.size(); k++) {
+                long double different = this->targets[k] - value;
+                fitness[k] = 1.0L / (different * different + 1.0L);
+                fitness[k] = fitness[k] == fitness[k] ? fitness[k] : 0.0L;
+            }
+        }
+
+    private:
+        std::vector<long double> targets;
+    };
+
+    // 用编译期的策略对数据集的每个目标值列计算适应度
+    template<class Policy>
+    class MultiTargetPolicyObjective : public MultiTargetObjective {
+
+    public:
+
+        MultiTargetPolicyObjective(const Data::Dataset& dataset, const Policy& policy = Policy()) : dataset(dataset), policy(policy) {
+        }
+
+        unsigned long getTargetNumber() const override {
+            return this->dataset.getTargetNumber();
+        }
+
+        unsigned long getVariableNumber() const override {
+            return this->dataset.getVariableNumber();
+        }
+
+        void evaluate(const Expression::Program& program, long double* fitness) const override {
+            scoreTargets(this->policy, program, this->dataset, fitness);
+        }
+
+    private:
+        const Data::Dataset& dataset;
+        Policy policy;
+    };
+
+}
+
+#endif
@@ -0,0 +1,24 @@
+#include "Objective.h"
+
+namespace Fitness {
+
+    Objective* Objective::create(const std::string& name, const Data::Dataset& dataset) {
+        if ("mse" == name) {
+            return new PolicyObjective<MeanSquaredError>(dataset);
+        }
+        if ("mae" == name) {
+            return new PolicyObjective<MeanAbsoluteError>(dataset);
+        }
+        if ("r2" == name) {
+            return new PolicyObjective<RSquared>(dataset);
+        }
+        if ("hits" == name) {
+            return new PolicyObjective<HitCount>(dataset);
+        }
+        if ("accuracy" == name) {
+            return new PolicyObjective<ClassificationAccuracy>(dataset);
+        }
+        throw "Error, unknown objective, in Fitness::Objective::create().";
+    }
+
+}
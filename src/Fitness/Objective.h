@@ -0,0 +1,232 @@
+#ifndef FITNESS_OBJECTIVE_H
+#define FITNESS_OBJECTIVE_H
+
+#include "Policies.h"
+#include "BlockedEvaluation.h"
+#include "../Expression/Program.h"
+#include "../Expression/ExpressionStore.h"
+#include "../Data/Dataset.h"
+#include <string>
+#include <vector>
+#include <functional>
+
+namespace Fitness {
+
+    /* 运行时选择的适应度函数
+     *
+     * 每个个体只有一次虚函数调用，行循环在 PolicyObjective 里按具体的策略编译，仍然是内联的。
+     * 对象引用数据集，数据集要比它活得长。
+     */
+    class Objective {
+
+    public:
+
+        /**
+         * @param const Data::Dataset& dataset
+         */
+        Objective(const Data::Dataset& dataset) : dataset(dataset) {
+        }
+
+        virtual ~Objective() {
+        }
+
+        /**
+         * 计算程序的适应度，越大越好，多个线程可以同时调用
+         *
+         * @param const Expression::Program& program
+         * @return long double
+         */
+        virtual long double evaluate(const Expression::Program& program) const = 0;
+
+        /**
+         * 竞赛式计算，确定适应度小于 threshold 时可以提前结束，见 Fitness::race()
+         *
+         * 默认完整计算。
+         *
+         * @param const Expression::Program& program
+         * @param long double threshold
+         * @param unsigned long& count 实际计算的行数
+         * @return long double 完整计算时是适应度，提前结束时是小于 threshold 的上界
+         */
+        virtual long double race(const Expression::Program& program, long double /* threshold */, unsigned long& count) const {
+            count = this->dataset.getRowNumber();
+            return this->evaluate(program);
+        }
+
+        /**
+         * 计算一批程序的适应度，见 BlockedEvaluation
+         *
+         * 默认逐个调用 evaluate() 。
+         *
+         * @param const std::vector<Expression::Program>& programs
+         * @param long double* fitness 写入 programs.size() 个适应度
+         * @param unsigned long threadNumber 线程数，0 时使用硬件线程数
+         * @return void
+         */
+        virtual void evaluateAll(const std::vector<Expression::Program>& programs, long double* fitness, unsigned long /* threadNumber */ = 1) const {
+            for (unsigned long i = 0; i < programs.size(); i++) {
+                fitness[i] = this->evaluate(programs[i]);
+            }
+        }
+
+        /**
+         * 是否支持 evaluatePredicted() ，默认不支持，调用者改用 evaluate()
+         *
+         * @return bool
+         */
+        virtual bool canEvaluatePredicted() const {
+            return false;
+        }
+
+        /**
+         * 用已经算好的数据集每一行的预测值计算适应度，例如 Chromosome 用每个基因保留的中间结果
+         * 算出的预测值，见 EvolutionContext::setIncrementalEvaluation()
+         *
+         * @param const long double* predicted 数据集每一行的预测值
+         * @return long double
+         */
+        virtual long double evaluatePredicted(const long double* /* predicted */) const {
+            throw "Error, not supported, in Fitness::Objective::evaluatePredicted().";
+        }
+
+        /**
+         * 计算共用子表达式的存储中每个根节点的适应度，见 scoreStore()
+         *
+         * 默认不支持，调用者改为逐个计算。
+         *
+         * @param Expression::ExpressionStore& store
+         * @param const unsigned long* roots store.add() 返回的根节点
+         * @param unsigned long count 根节点的个数
+         * @param long double* fitness 写入 count 个适应度
+         * @return bool 不支持时返回 false ，没有写入任何适应度
+         */
+        virtual bool evaluateStore(Expression::ExpressionStore& /* store */, const unsigned long* /* roots */, unsigned long /* count */, long double* /* fitness */) const {
+            return false;
+        }
+
+        /**
+         * 在另一个数据集上创建同样的适应度函数，例如 RacingEvaluator 的随机子集
+         *
+         * @param const Data::Dataset& dataset
+         * @return Objective* 用 new 创建，由调用者释放；不支持时返回 nullptr
+         */
+        virtual Objective* createForDataset(const Data::Dataset& /* dataset */) const {
+            return nullptr;
+        }
+
+        /**
+         * 数据集
+         *
+         * @return const Data::Dataset&
+         */
+        const Data::Dataset& getDataset() const {
+            return this->dataset;
+        }
+
+        /**
+         * 按名字创建内置的适应度函数：mse、mae、r2、hits、accuracy
+         *
+         * @param const std::string& name
+         * @param const Data::Dataset& dataset
+         * @return Objective* 用 new 创建，由调用者释放
+         */
+        static Objective* create(const std::string& name, const Data::Dataset& dataset);
+
+    protected:
+
+        /** @var const Data::Dataset& 数据集 */
+        const Data::Dataset& dataset;
+
+    };
+
+    // 用编译期的策略实现的适应度函数
+    template<class Policy>
+    class PolicyObjective : public Objective {
+
+    public:
+
+        // 策略有 forDataset() 时按这个数据集准备，见 Policies.h
+        PolicyObjective(const Data::Dataset& dataset, const Policy& policy = Policy()) : Objective(dataset), policy(Fitness::forDataset(policy, dataset, 0)) {
+        }
+
+        long double evaluate(const Expression::Program& program) const override {
+            return score(this->policy, program, this->dataset);
+        }
+
+        long double race(const Expression::Program& program, long double threshold, unsigned long& count) const override {
+            return Fitness::race(this->policy, program, this->dataset, threshold, count);
+        }
+
+        void evaluateAll(const std::vector<Expression::Program>& programs, long double* fitness, unsigned long threadNumber = 1) const override {
+            scorePopulation(this->policy, programs.data(), programs.size(), this->dataset, fitness, threadNumber);
+        }
+
+        bool canEvaluatePredicted() const override {
+            return true;
+        }
+
+        long double evaluatePredicted(const long double* predicted) const override {
+            return scorePredicted(this->policy, predicted, this->dataset);
+        }
+
+        bool evaluateStore(Expression::ExpressionStore& store, const unsigned long* roots, unsigned long count, long double* fitness) const override {
+            scoreStore(this->policy, store, roots, count, this->dataset, fitness);
+            return true;
+        }
+
+        Objective* createForDataset(const Data::Dataset& dataset) const override {
+            return new PolicyObjective<Policy>(dataset, this->policy);
+        }
+
+    private:
+        Policy policy;
+    };
+
+    /* 完全自定义的适应度函数，拿到整个数据集的预测值和目标值
+     *
+     * 例如 CustomObjective(dataset, [](const long double* predicted, const long double* target, unsigned long count) { ... })
+     */
+    class CustomObjective : public Objective {
+
+    public:
+
+        typedef std::function<long double(const long double* predicted, const long double* target, unsigned long count)> Function;
+
+        CustomObjective(const Data::Dataset& dataset, Function function) : Objective(dataset), function(function) {
+            if (!this->function) {
+                throw "Error, empty function, in Fitness::CustomObjective.";
+            }
+        }
+
+        long double evaluate(const Expression::Program& program) const override {
+            static thread_local std::vector<long double> output, workspace;
+            unsigned long rows = this->dataset.getRowNumber();
+            if ((unsigned long)program.getVariableNumber() > this->dataset.getVariableNumber()) {
+                throw "Error, program uses more variables than the dataset has, in Fitness::CustomObjective.";
+            }
+            output.resize(rows);
+            program.evaluateBlock<long double>(this->dataset.getColumns(), rows, output.data(), workspace);
+            long double fitness = this->function(output.data(), this->dataset.getTarget(), rows);
+            return fitness == fitness ? fitness : 0.0L;
+        }
+
+        bool canEvaluatePredicted() const override {
+            return true;
+        }
+
+        long double evaluatePredicted(const long double* predicted) const override {
+            long double fitness = this->function(predicted, this->dataset.getTarget(), this->dataset.getRowNumber());
+            return fitness == fitness ? fitness : 0.0L;
+        }
+
+        Objective* createForDataset(const Data::Dataset& dataset) const override {
+            return new CustomObjective(dataset, this->function);
+        }
+
+    private:
+        Function function;
+    };
+
+}
+
+#endif
@@ -0,0 +1,380 @@
+#ifndef FITNESS_POLICIES_H
+#define FITNESS_POLICIES_H
+
+#include "../Expression/Program.h"
+#include "../Data/Dataset.h"
+#include <vector>
+#include <cmath>
+#include <limits>
+
+namespace Fitness {
+
+    /* 内置的适应度策略
+     *
+     * 策略是一个普通的类，编译期作为模板参数传给 score() ，不需要虚函数：
+     *   struct State              每次计算的累加状态，值初始化就是初始状态
+     *   void add(State&, long double predicted, long double target) const
+     *                             累加一行，在 score() 的行循环里被内联
+     *   long double finish(const State&, unsigned long count) const
+     *                             得到适应度，越大越好
+     * 可选：
+     *   long double bound(const State&, unsigned long count, unsigned long rows) const
+     *                             已经累加了 count 行时，rows 行全部算完后适应度的上界，
+     *                             race() 用它提前结束
+     *   Policy forDataset(const Data::Dataset&) const
+     *                             按数据集准备好的策略，PolicyObjective 创建时调用，
+     *                             例如 R² 的上界要用整个数据集的目标值
+     *
+     * 误差类的策略返回 1 / (误差 + 1) ，和原来的适应度一样最大为 1 。
+     */
+
+    // 均方误差
+    struct MeanSquaredError {
+        struct State {
+            long double sum;
+        };
+        void add(State& state, long double predicted, long double target) const {
+            long double different = predicted - target;
+            state.sum += different * different;
+        }
+        long double finish(const State& state, unsigned long count) const {
+            return 1.0L / (state.sum / count + 1.0L);
+        }
+        // 误差的和只会增加
+        long double bound(const State& state, unsigned long, unsigned long rows) const {
+            return this->finish(state, rows);
+        }
+    };
+
+    // 平均绝对误差
+    struct MeanAbsoluteError {
+        struct State {
+            long double sum;
+        };
+        void add(State& state, long double predicted, long double target) const {
+            state.sum += std::fabs(predicted - target);
+        }
+        long double finish(const State& state, unsigned long count) const {
+            return 1.0L / (state.sum / count + 1.0L);
+        }
+        long double bound(const State& state, unsigned long, unsigned long rows) const {
+            return this->finish(state, rows);
+        }
+    };
+
+    // 决定系数 R² ，一次遍历同时累加残差平方和以及目标值的和、平方和
+    struct RSquared {
+        // forDataset() 算出的整个数据集目标值的总平方和，没有时不能提前结束
+        long double total = 0.0L;
+        bool hasTotal = false;
+        struct State {
+            long double residual;
+            long double sum;
+            long double squareSum;
+        };
+        void add(State& state, long double predicted, long double target) const {
+            long double different = predicted - target;
+            state.residual += different * different;
+            state.sum += target;
+            state.squareSum += target * target;
+        }
+        long double finish(const State& state, unsigned long count) const {
+            long double total = state.squareSum - state.sum * state.sum / count;
+            if (total <= 0) {
+                return state.residual > 0 ? 0.0L : 1.0L;
+            }
+            return 1.0L - state.residual / total;
+        }
+        // 总平方和按 add() 和 finish() 相同的顺序计算，和算完所有行时的分母完全相同
+        RSquared forDataset(const Data::Dataset& dataset) const {
+            RSquared policy;
+            unsigned long rows = dataset.getRowNumber();
+            if (0 == rows) {
+                return policy;
+            }
+            State state = State();
+            const long double* target = dataset.getTarget();
+            for (unsigned long i = 0; i < rows; i++) {
+                state.sum += target[i];
+                state.squareSum += target[i] * target[i];
+            }
+            policy.total = state.squareSum - state.sum * state.sum / rows;
+            policy.hasTotal = true;
+            return policy;
+        }
+        // 残差平方和只会增加，分母是 forDataset() 的数据集的总平方和
+        long double bound(const State& state, unsigned long, unsigned long) const {
+            if (!this->hasTotal) {
+                return std::numeric_limits<long double>::infinity();
+            }
+            if (this->total <= 0) {
+                return state.residual > 0 ? 0.0L : 1.0L;
+            }
+            return 1.0L - state.residual / this->total;
+        }
+    };
+
+    // 误差不超过 tolerance 的行的比例
+    struct HitCount {
+        long double tolerance;
+        HitCount(long double tolerance = 0.01L) : tolerance(tolerance) {
+        }
+        struct State {
+            unsigned long hits;
+        };
+        void add(State& state, long double predicted, long double target) const {
+            state.hits += std::fabs(predicted - target) <= this->tolerance ? 1 : 0;
+        }
+        long double finish(const State& state, unsigned long count) const {
+            return (long double)state.hits / count;
+        }
+        // 剩下的行全部命中
+        long double bound(const State& state, unsigned long count, unsigned long rows) const {
+            return (long double)(state.hits + rows - count) / rows;
+        }
+    };
+
+    // 二分类的准确率，预测值和目标值都以 threshold 为界分成两类
+    struct ClassificationAccuracy {
+        long double threshold;
+        ClassificationAccuracy(long double threshold = 0.5L) : threshold(threshold) {
+        }
+        struct State {
+            unsigned long correct;
+        };
+        void add(State& state, long double predicted, long double target) const {
+            state.correct += (predicted > this->threshold) == (target > this->threshold) ? 1 : 0;
+        }
+        long double finish(const State& state, unsigned long count) const {
+            return (long double)state.correct / count;
+        }
+        long double bound(const State& state, unsigned long count, unsigned long rows) const {
+            return (long double)(state.correct + rows - count) / rows;
+        }
+    };
+
+    /**
+     * 检查数据集可以用来计算适应度：不能是空的，变量不能比程序用到的少
+     *
+     * @param const Data::Dataset& dataset
+     * @param int variableNumber 程序用到的变量个数
+     * @return void
+     */
+    inline void checkDataset(const Data::Dataset& dataset, int variableNumber) {
+        if (0 == dataset.getRowNumber()) {
+            throw "Error, empty dataset, in Fitness::checkDataset().";
+        }
+        if ((unsigned long)variableNumber > dataset.getVariableNumber()) {
+            throw "Error, program uses more variables than the dataset has, in Fitness::checkDataset().";
+        }
+    }
+
+    /**
+     * 累加完 rows 行以后的适应度，nan 的结果返回 0
+     *
+     * @param const Policy& policy
+     * @param const typename Policy::State& state
+     * @param unsigned long rows
+     * @return long double
+     */
+    template<class Policy>
+    long double finishScore(const Policy& policy, const typename Policy::State& state, unsigned long rows) {
+        long double fitness = policy.finish(state, rows);
+        return fitness == fitness ? fitness : 0.0L;
+    }
+
+    // scoreBlocks() 的 sink ，总是算完所有行
+    struct ScoreAllRows {
+        template<class State>
+        bool operator()(const State*, unsigned long) const {
+            return true;
+        }
+    };
+
+    /**
+     * 按块计算适应度的公共循环，score()、race()、scoreTargets()、scorePopulation()、scoreStore() 都用它
+     *
+     * 数据集每 blockRows 行一块，columns 指向这块的开头。每块对第 i 个累加状态调用
+     * evaluate(i, columns, size) 得到这块 size 个预测值，和目标值的这块一起交给 policy.add() ，
+     * 目标值是第 0 列，eachTarget 时是第 i 列。每块之后调用 sink(states, 已经算完的行数) ，
+     * 返回 false 时提前结束。调用前先用 checkDataset() 检查数据集。
+     *
+     * @param const Policy& policy
+     * @param const Data::Dataset& dataset
+     * @param unsigned long blockRows 一块的行数
+     * @param unsigned long stateNumber 累加状态的个数
+     * @param bool eachTarget 第 i 个状态和第 i 个目标值比较
+     * @param Evaluate evaluate
+     * @param Sink sink
+     * @param long double* fitness 算完所有行时写入 fitness[i * stride] ，nan 写 0
+     * @param unsigned long stride
+     * @return bool 是否算完了所有行
+     */
+    template<class Policy, class Evaluate, class Sink>
+    bool scoreBlocks(const Policy& policy, const Data::Dataset& dataset, unsigned long blockRows, unsigned long stateNumber, bool eachTarget, Evaluate evaluate, Sink sink, long double* fitness, unsigned long stride = 1) {
+        static thread_local std::vector<const long double*> columns;
+        static thread_local std::vector<typename Policy::State> states;
+        unsigned long rows = dataset.getRowNumber();
+        states.assign(stateNumber, typename Policy::State());
+        columns.resize(dataset.getVariableNumber());
+        for (unsigned long begin = 0; begin < rows;) {
+            unsigned long size = rows - begin < blockRows ? rows - begin : blockRows;
+            for (unsigned long j = 0; j < columns.size(); j++) {
+                columns[j] = dataset.getColumns()[j] + begin;
+            }
+            for (unsigned long i = 0; i < stateNumber; i++) {
+                const long double* output = evaluate(i, columns.data(), size);
+                const long double* target = dataset.getTarget(eachTarget ? i : 0) + begin;
+                typename Policy::State& state = states[i];
+                for (unsigned long j = 0; j < size; j++) {
+                    policy.add(state, output[j], target[j]);
+                }
+            }
+            begin += size;
+            if (!sink(states.data(), begin)) {
+                return false;
+            }
+        }
+        for (unsigned long i = 0; i < stateNumber; i++) {
+            fitness[i * stride] = finishScore(policy, states[i], rows);
+        }
+        return true;
+    }
+
+    /**
+     * 用策略计算程序在数据集上的适应度
+     *
+     * 按块调用 Program::evaluateBlock() ，每块算完后在同一个循环里把预测值交给策略累加，
+     * 策略的 add() 在这里内联，自定义的策略没有额外的调用开销。nan 的结果返回 0 。
+     *
+     * @param const Policy& policy
+     * @param const Expression::Program& program
+     * @param const Data::Dataset& dataset
+     * @return long double
+     */
+    template<class Policy>
+    long double score(const Policy& policy, const Expression::Program& program, const Data::Dataset& dataset) {
+        // 一块的行数，让每条指令的中间结果留在缓存里
+        const unsigned long blockRows = 1024;
+        static thread_local std::vector<long double> output(blockRows), workspace;
+        checkDataset(dataset, program.getVariableNumber());
+        long double fitness = 0.0L;
+        scoreBlocks(policy, dataset, blockRows, 1, false, [&program](unsigned long, const long double* const* columns, unsigned long size) -> const long double* {
+            program.evaluateBlock<long double>(columns, size, output.data(), workspace);
+            return output.data();
+        }, ScoreAllRows(), &fitness);
+        return fitness;
+    }
+
+    /**
+     * 用策略计算已经算好的预测值的适应度，predicted 是数据集每一行的预测值
+     *
+     * nan 的结果返回 0 。
+     *
+     * @param const Policy& policy
+     * @param const long double* predicted
+     * @param const Data::Dataset& dataset
+     * @return long double
+     */
+    template<class Policy>
+    long double scorePredicted(const Policy& policy, const long double* predicted, const Data::Dataset& dataset) {
+        checkDataset(dataset, 0);
+        unsigned long rows = dataset.getRowNumber();
+        typename Policy::State state = typename Policy::State();
+        const long double* target = dataset.getTarget();
+        for (unsigned long i = 0; i < rows; i++) {
+            policy.add(state, predicted[i], target[i]);
+        }
+        return finishScore(policy, state, rows);
+    }
+
+    // 策略有 bound() 时使用它
+    template<class Policy>
+    auto bound(const Policy& policy, const typename Policy::State& state, unsigned long count, unsigned long rows, int)
+        -> decltype(policy.bound(state, count, rows)) {
+        return policy.bound(state, count, rows);
+    }
+
+    // 没有 bound() 的策略不能提前结束
+    template<class Policy>
+    long double bound(const Policy&, const typename Policy::State&, unsigned long, unsigned long, long) {
+        return std::numeric_limits<long double>::infinity();
+    }
+
+    // 策略有 forDataset() 时使用它
+    template<class Policy>
+    auto forDataset(const Policy& policy, const Data::Dataset& dataset, int) -> decltype(policy.forDataset(dataset)) {
+        return policy.forDataset(dataset);
+    }
+
+    // 没有 forDataset() 的策略和数据集无关
+    template<class Policy>
+    Policy forDataset(const Policy& policy, const Data::Dataset&, long) {
+        return policy;
+    }
+
+    /**
+     * 竞赛式计算：和 score() 相同，但每块算完后检查适应度的上界，确定小于 threshold 时提前结束
+     *
+     * 策略没有 bound() 时等同于 score() 。结果是 nan 时直接结束并返回 0 。
+     *
+     * @param const Policy& policy
+     * @param const Expression::Program& program
+     * @param const Data::Dataset& dataset
+     * @param long double threshold
+     * @param unsigned long& count 实际计算的行数
+     * @return long double 算完所有行时是适应度，提前结束时是小于 threshold 的上界
+     */
+    template<class Policy>
+    long double race(const Policy& policy, const Expression::Program& program, const Data::Dataset& dataset, long double threshold, unsigned long& count) {
+        const unsigned long blockRows = 1024;
+        static thread_local std::vector<long double> output(blockRows), workspace;
+        checkDataset(dataset, program.getVariableNumber());
+        unsigned long rows = dataset.getRowNumber();
+        long double fitness = 0.0L, upper = 0.0L;
+        bool finished = scoreBlocks(policy, dataset, blockRows, 1, false, [&program](unsigned long, const long double* const* columns, unsigned long size) -> const long double* {
+            program.evaluateBlock<long double>(columns, size, output.data(), workspace);
+            return output.data();
+        }, [&policy, &count, &upper, rows, threshold](const typename Policy::State* states, unsigned long done) -> bool {
+            count = done;
+            if (done >= rows) {
+                return true;
+            }
+            upper = bound(policy, states[0], done, rows, 0);
+            return upper == upper && !(upper < threshold);
+        }, &fitness);
+        if (!finished) {
+            return upper == upper ? upper : 0.0L;
+        }
+        return fitness;
+    }
+
+    /**
+     * 用策略计算程序对数据集每个目标值的适应度
+     *
+     * 每块只调用一次 Program::evaluateBlock() ，同一块预测值依次和每个目标值的列比较，
+     * 表达式的计算由所有目标值共享。nan 的结果写 0 。
+     *
+     * @param const Policy& policy
+     * @param const Expression::Program& program
+     * @param const Data::Dataset& dataset
+     * @param long double* fitness 写入 dataset.getTargetNumber() 个适应度
+     * @return void
+     */
+    template<class Policy>
+    void scoreTargets(const Policy& policy, const Expression::Program& program, const Data::Dataset& dataset, long double* fitness) {
+        const unsigned long blockRows = 1024;
+        static thread_local std::vector<long double> output(blockRows), workspace;
+        checkDataset(dataset, program.getVariableNumber());
+        // 每块只在第一个目标值时计算，其它目标值使用同一块预测值
+        scoreBlocks(policy, dataset, blockRows, dataset.getTargetNumber(), true, [&program](unsigned long k, const long double* const* columns, unsigned long size) -> const long double* {
+            if (0 == k) {
+                program.evaluateBlock<long double>(columns, size, output.data(), workspace);
+            }
+            return output.data();
+        }, ScoreAllRows(), fitness);
+    }
+
+}
+
+#endif
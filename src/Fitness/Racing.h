@@ -0,0 +1,162 @@
+#ifndef FITNESS_RACING_H
+#define FITNESS_RACING_H
+
+#include "Objective.h"
+#include "../Expression/Program.h"
+#include "../Data/Dataset.h"
+#include <vector>
+#include <memory>
+#include <random>
+
+namespace Fitness {
+
+    // 竞赛式计算的统计
+    struct RacingStatistics {
+        // 计算过的个体
+        unsigned long candidates;
+        // 在随机子集上就被淘汰的个体
+        unsigned long sampleRejections;
+        // 完整计算中途确定比阈值差而结束的个体
+        unsigned long earlyAborts;
+        // 完整算完所有行的个体
+        unsigned long fullEvaluations;
+        // 实际计算的行数，包括随机子集
+        unsigned long long rowsEvaluated;
+        // 每个个体都完整计算时的行数
+        unsigned long long rowsFull;
+
+        // 节省的行数
+        unsigned long long getRowsSaved() const {
+            return this->rowsFull > this->rowsEvaluated ? this->rowsFull - this->rowsEvaluated : 0;
+        }
+    };
+
+    /**
+     * 竞赛式的适应度计算
+     *
+     * 一代里的新个体大多比第 keep 个精英差，替换进种群以后很快又被淘汰，不必在整个数据集上
+     * 算完。每个新个体分两步：
+     *   1. 在随机抽取的 sampleRows 行上计算，适应度低于阈值（第 keep 个精英的适应度）的个体
+     *   直接用这个估计值，不再完整计算
+     *   2. 其余个体在整个数据集上用 Objective::race() 计算，上界低于阈值时提前结束
+     * 第 2 步的上界是严格的，所以能进入前 keep 名的个体一定是完整算出的适应度；第 1 步是估计，
+     * 可能误伤接近阈值的个体，随机子集每代重新抽取（ resample() ），不会一直偏向同一批行。
+     * 没有算完整个数据集的结果（估计值和上界）由 evaluate() 的 exact 标出，不能和完整算出的
+     * 适应度直接比较。
+     *
+     * 适应度函数不支持 createForDataset() 时跳过第 1 步，策略没有 bound() 时第 2 步不能提前结束。
+     */
+    class RacingEvaluator {
+
+    public:
+
+        RacingEvaluator() {
+        }
+
+        // 复制设置和统计，随机子集在下一次 resample() 时重新抽取
+        RacingEvaluator(const RacingEvaluator& another) : sampleRows(another.sampleRows), statistics(another.statistics) {
+        }
+
+        RacingEvaluator& operator=(const RacingEvaluator& another) {
+            this->sampleRows = another.sampleRows;
+            this->statistics = another.statistics;
+            this->sampleObjective.reset();
+            return *this;
+        }
+
+        // 设置随机子集的行数，0 时不抽样，只在完整计算中提前结束
+        void setSampleRows(unsigned long sampleRows) {
+            this->sampleRows = sampleRows;
+        }
+
+        /**
+         * 为新的一代重新抽取随机子集
+         *
+         * @param const Objective& objective
+         * @param std::default_random_engine& engine
+         * @return void
+         */
+        void resample(const Objective& objective, std::default_random_engine& engine) {
+            const Data::Dataset& dataset = objective.getDataset();
+            unsigned long rows = dataset.getRowNumber();
+            this->sampleObjective.reset();
+            // 子集不比整个数据集小很多时没有意义
+            if (0 == this->sampleRows || 4 * this->sampleRows > rows) {
+                return;
+            }
+            if (this->order.size() != rows) {
+                this->order.resize(rows);
+                for (unsigned long i = 0; i < rows; i++) {
+                    this->order[i] = i;
+                }
+            }
+            // 部分 Fisher-Yates 洗牌，前 sampleRows 个就是不重复的随机行
+            this->sample = Data::Dataset(dataset.getVariableNumber());
+            std::vector<long double> variables(dataset.getVariableNumber());
+            for (unsigned long i = 0; i < this->sampleRows; i++) {
+                std::uniform_int_distribution<unsigned long> pick(i, rows - 1);
+                std::swap(this->order[i], this->order[pick(engine)]);
+                unsigned long row = this->order[i];
+                for (unsigned long j = 0; j < variables.size(); j++) {
+                    variables[j] = dataset.getColumns()[j][row];
+                }
+                this->sample.addRow(variables.data(), dataset.getTarget()[row]);
+            }
+            this->sampleObjective.reset(objective.createForDataset(this->sample));
+        }
+
+        /**
+         * 计算一个新个体，见类的说明
+         *
+         * @param const Objective& objective 和 resample() 的相同
+         * @param const Expression::Program& program
+         * @param long double threshold 第 keep 个精英的适应度
+         * @param bool& exact 是否在整个数据集上算完
+         * @return long double 适应度；没有算完时是低于 threshold 的估计值或者上界
+         */
+        long double evaluate(const Objective& objective, const Expression::Program& program, long double threshold, bool& exact) {
+            unsigned long rows = objective.getDataset().getRowNumber();
+            exact = false;
+            this->statistics.candidates++;
+            this->statistics.rowsFull += rows;
+            if (this->sampleObjective) {
+                long double estimate = this->sampleObjective->evaluate(program);
+                this->statistics.rowsEvaluated += this->sampleRows;
+                if (estimate < threshold) {
+                    this->statistics.sampleRejections++;
+                    return estimate;
+                }
+            }
+            unsigned long count = 0;
+            long double fitness = objective.race(program, threshold, count);
+            this->statistics.rowsEvaluated += count;
+            if (count < rows) {
+                this->statistics.earlyAborts++;
+            } else {
+                this->statistics.fullEvaluations++;
+                exact = true;
+            }
+            return fitness;
+        }
+
+        // 到目前为止的统计
+        RacingStatistics getStatistics() const {
+            return this->statistics;
+        }
+
+    private:
+        // 随机子集的行数
+        unsigned long sampleRows = 256;
+        // 行的排列，前 sampleRows 个是这一代的随机子集
+        std::vector<unsigned long> order;
+        // 这一代的随机子集
+        Data::Dataset sample;
+        // 随机子集上的适应度函数
+        std::unique_ptr<Objective> sampleObjective;
+        // 统计
+        RacingStatistics statistics = RacingStatistics();
+    };
+
+}
+
+#endif
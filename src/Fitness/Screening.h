@@ -0,0 +1,151 @@
+#ifndef FITNESS_SCREENING_H
+#define FITNESS_SCREENING_H
+
+#include "Objective.h"
+#include "../Expression/IntervalAnalysis.h"
+#include "../Expression/Program.h"
+#include "../Data/Dataset.h"
+#include <vector>
+#include <memory>
+#include <atomic>
+
+namespace Fitness {
+
+    /**
+     * 数据集每个输入变量的范围，也就是每一列的最小值和最大值
+     *
+     * @param const Data::Dataset& dataset
+     * @return std::vector<Expression::Interval>
+     */
+    inline std::vector<Expression::Interval> getVariableRanges(const Data::Dataset& dataset) {
+        std::vector<Expression::Interval> ranges;
+        for (unsigned long j = 0; j < dataset.getVariableNumber(); j++) {
+            const long double* column = dataset.getColumns()[j];
+            Expression::Interval range = Expression::Interval::make(1.0L, 0.0L);
+            for (unsigned long i = 0; i < dataset.getRowNumber(); i++) {
+                if (column[i] != column[i]) {
+                    range.nan = true;
+                    continue;
+                }
+                if (range.isEmpty()) {
+                    range.lower = range.upper = column[i];
+                }
+                range.lower = column[i] < range.lower ? column[i] : range.lower;
+                range.upper = column[i] > range.upper ? column[i] : range.upper;
+            }
+            ranges.push_back(range);
+        }
+        return ranges;
+    }
+
+    /* 先做区间分析的适应度函数
+     *
+     * 包装另一个适应度函数。每个程序先用 Expression::IntervalAnalysis 在数据集每一列的范围上
+     * 分析，可以证明每一行的值都是 inf 、-inf 或者 nan 的程序直接得到 penalty ，不在数据集上
+     * 计算；其余的交给被包装的适应度函数。一定走保护分支的运算（例如除数总是负的除法）按 0
+     * 继续分析，不会让整个程序被淘汰。分析只和程序的长度有关，和行数无关。
+     *
+     * 被包装的适应度函数要比它活得长。
+     */
+    class ScreenedObjective : public Objective {
+
+    public:
+
+        /**
+         * @param const Objective& objective 被包装的适应度函数
+         * @param long double penalty 退化的程序得到的适应度
+         */
+        ScreenedObjective(const Objective& objective, long double penalty = 0.0L)
+            : Objective(objective.getDataset()), objective(&objective, [](const Objective*) {}),
+            analysis(getVariableRanges(objective.getDataset())), penalty(penalty), screened(new std::atomic<unsigned long>(0)) {
+        }
+
+        long double evaluate(const Expression::Program& program) const override {
+            if (this->screen(program)) {
+                return this->penalty;
+            }
+            return this->objective->evaluate(program);
+        }
+
+        long double race(const Expression::Program& program, long double threshold, unsigned long& count) const override {
+            if (this->screen(program)) {
+                count = 0;
+                return this->penalty;
+            }
+            return this->objective->race(program, threshold, count);
+        }
+
+        void evaluateAll(const std::vector<Expression::Program>& programs, long double* fitness, unsigned long threadNumber = 1) const override {
+            std::vector<Expression::Program> rest;
+            std::vector<unsigned long> offsets;
+            for (unsigned long i = 0; i < programs.size(); i++) {
+                if (this->screen(programs[i])) {
+                    fitness[i] = this->penalty;
+                } else {
+                    rest.push_back(programs[i]);
+                    offsets.push_back(i);
+                }
+            }
+            std::vector<long double> result(rest.size());
+            this->objective->evaluateAll(rest, result.data(), threadNumber);
+            for (unsigned long i = 0; i < offsets.size(); i++) {
+                fitness[offsets[i]] = result[i];
+            }
+        }
+
+        // 在子集上创建时沿用整个数据集的范围，淘汰的计数也是共用的
+        Objective* createForDataset(const Data::Dataset& dataset) const override {
+            Objective* objective = this->objective->createForDataset(dataset);
+            if (nullptr == objective) {
+                return nullptr;
+            }
+            return new ScreenedObjective(std::shared_ptr<const Objective>(objective), this->analysis, this->penalty, this->screened);
+        }
+
+        /**
+         * 用到的区间分析，也可以用来做利用范围的化简
+         *
+         * @return const Expression::IntervalAnalysis&
+         */
+        const Expression::IntervalAnalysis& getAnalysis() const {
+            return this->analysis;
+        }
+
+        /**
+         * 到目前为止不经计算就淘汰的程序个数
+         *
+         * @return unsigned long
+         */
+        unsigned long getScreenedNumber() const {
+            return this->screened->load();
+        }
+
+    private:
+        // 被包装的适应度函数，自己创建的时候负责释放
+        std::shared_ptr<const Objective> objective;
+        // 数据集每一列的范围上的区间分析
+        Expression::IntervalAnalysis analysis;
+        // 退化的程序得到的适应度
+        long double penalty;
+        // 淘汰的程序个数，多个线程同时计算
+        std::shared_ptr<std::atomic<unsigned long>> screened;
+
+        // 私有，createForDataset() 使用
+        ScreenedObjective(const std::shared_ptr<const Objective>& objective, const Expression::IntervalAnalysis& analysis, long double penalty, const std::shared_ptr<std::atomic<unsigned long>>& screened)
+            : Objective(objective->getDataset()), objective(objective), analysis(analysis), penalty(penalty), screened(screened) {
+        }
+
+        // 私有，可以证明程序退化时返回 true
+        bool screen(const Expression::Program& program) const {
+            if (0 == program.size() || !this->analysis.analyze(program).isDegenerate()) {
+                return false;
+            }
+            (*this->screened)++;
+            return true;
+        }
+
+    };
+
+}
+
+#endif
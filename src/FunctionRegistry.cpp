@@ -0,0 +1,14 @@
+#include "FunctionRegistry.h"
+
+std::vector<FunctionRegistry::Function> FunctionRegistry::functions = FunctionRegistry::builtin();
+
+unsigned long FunctionRegistry::version = 0;
+
+// 常用的数值类型，库的使用者不必再实例化
+template float FunctionRegistry::apply<float>(int id, const float* arguments);
+template double FunctionRegistry::apply<double>(int id, const double* arguments);
+template long double FunctionRegistry::apply<long double>(int id, const long double* arguments);
+
+template void FunctionRegistry::applyBlock<float>(int id, float* result, const float* const* arguments, unsigned long count);
+template void FunctionRegistry::applyBlock<double>(int id, double* result, const double* const* arguments, unsigned long count);
+template void FunctionRegistry::applyBlock<long double>(int id, long double* result, const long double* const* arguments, unsigned long count);
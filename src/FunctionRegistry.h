@@ -0,0 +1,425 @@
+#ifndef FUNCTIONREGISTRY_H
+#define FUNCTIONREGISTRY_H
+
+#include <string>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+/* 函数集合
+ *
+ * 记录每个运算符（函数）的名称、参数个数、受保护的计算规则和批量计算的实现，以及
+ * 进化时可以随机选用的函数。内置函数的编号和 Op::ADD 等常量一致：
+ *
+ *   1 加  2 减  3 乘  4 除（除数小于 1E-18 时为 0）  5 Op::END ，不是函数
+ *   6 sqrt(|a|)  7 exp（参数超过 700 时按 700 计算）  8 log(|a|)（|a| 小于 1E-18 时为 0）
+ *   9 sin  10 abs  11 min  12 max  13 if（a > 0 时为 b ，否则为 c）
+ *
+ * 默认只启用加减乘除，和以前的行为一致。这是全局的配置，应该在开始进化之前设置好。
+ */
+class FunctionRegistry {
+
+public:
+
+    // 标量的计算规则，参数个数等于 arity
+    typedef long double (*ScalarFunction)(const long double* arguments);
+
+    // 批量的计算规则：arguments[k] 是第 k 个参数的 count 个值，结果写到 result
+    typedef void (*BlockFunction)(double* result, const double* const* arguments, unsigned long count);
+
+    /* 一个函数
+     */
+    struct Function {
+        // 编号，也就是 Op::getTypeValue() 的值
+        int id;
+        // 名称，中缀运算符是运算符本身
+        std::string name;
+        // 参数个数
+        int arity;
+        // 是否打印成中缀形式 (a+b)
+        bool infix;
+        // 生成 C 代码时的表达式，$0 $1 $2 表示参数
+        std::string cExpression;
+        // 标量计算，内置函数为 nullptr
+        ScalarFunction scalar;
+        // double 的批量计算，可以为 nullptr
+        BlockFunction block;
+        // 是否参与随机生成
+        bool enabled;
+    };
+
+    /**
+     * 注册自定义函数，返回编号。注册后默认启用
+     *
+     * 编号从 14 开始分配。
+     *
+     * @param const std::string& name 名称，打印时输出 name(a,b)
+     * @param int arity 参数个数，1 到 3
+     * @param ScalarFunction scalar 标量计算规则
+     * @param BlockFunction block double 的批量计算规则，nullptr 时逐个调用 scalar
+     * @param const std::string& cExpression 生成 C 代码时的表达式，例如 "my_f($0, $1)"
+     * @return int
+     */
+    static int registerFunction(const std::string& name, int arity, ScalarFunction scalar, BlockFunction block = nullptr, const std::string& cExpression = "") {
+        if (arity < 1 || arity > 3) {
+            throw "Error, arity must be 1, 2 or 3, in FunctionRegistry::registerFunction().";
+        }
+        if (nullptr == scalar) {
+            throw "Error, scalar function is nullptr, in FunctionRegistry::registerFunction().";
+        }
+        Function function = make((int)functions.size(), name, arity, false, cExpression);
+        function.scalar = scalar;
+        function.block = block;
+        function.enabled = true;
+        functions.push_back(function);
+        version++;
+        return function.id;
+    }
+
+    /**
+     * 启用或者停用一个函数
+     *
+     * @param int id
+     * @param bool enable
+     * @return void
+     */
+    static void enable(int id, bool enable = true) {
+        if (!exists(id)) {
+            throw "Error, unknown function, in FunctionRegistry::enable().";
+        }
+        functions[id].enabled = enable;
+        version++;
+    }
+
+    // 启用全部函数
+    static void enableAll() {
+        for (auto& function : functions) {
+            if (function.arity > 0) {
+                function.enabled = true;
+            }
+        }
+        version++;
+    }
+
+    // 只启用加减乘除
+    static void reset() {
+        for (auto& function : functions) {
+            function.enabled = function.id >= 1 && function.id <= 4;
+        }
+        version++;
+    }
+
+    /**
+     * 函数或者启用状态每次改变都会加一，用来判断根据启用的函数做的缓存是否还有效
+     *
+     * @return unsigned long
+     */
+    static unsigned long getVersion() {
+        return version;
+    }
+
+    /**
+     * 是否存在编号为 id 的函数
+     *
+     * @param int id
+     * @return bool
+     */
+    static bool exists(int id) {
+        return id > 0 && id < (int)functions.size() && functions[id].arity > 0;
+    }
+
+    /**
+     * 按名字查找函数
+     *
+     * @param const std::string& name
+     * @return int 函数的编号，找不到时为 0
+     */
+    static int find(const std::string& name) {
+        for (auto& function : functions) {
+            if (function.arity > 0 && function.name == name) {
+                return function.id;
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * 获取函数的信息
+     *
+     * @param int id
+     * @return const Function&
+     */
+    static const Function& get(int id) {
+        if (!exists(id)) {
+            throw "Error, unknown function, in FunctionRegistry::get().";
+        }
+        return functions[id];
+    }
+
+    /**
+     * 参数个数
+     *
+     * @param int id
+     * @return int
+     */
+    static int getArity(int id) {
+        return functions[id].arity;
+    }
+
+    /**
+     * 启用的函数的编号，按编号从小到大
+     *
+     * @return std::vector<int>
+     */
+    static std::vector<int> getEnabled() {
+        std::vector<int> result;
+        for (auto& function : functions) {
+            if (function.enabled) {
+                result.push_back(function.id);
+            }
+        }
+        return result;
+    }
+
+    /**
+     * 启用的函数中最大的参数个数
+     *
+     * @return int
+     */
+    static int getMaxArity() {
+        int maxArity = 1;
+        for (auto& function : functions) {
+            if (function.enabled && function.arity > maxArity) {
+                maxArity = function.arity;
+            }
+        }
+        return maxArity;
+    }
+
+    /**
+     * 给定染色体长度时尾部开始的位置，也就是头部的长度 h
+     *
+     * 尾部长度 t 至少要是 h*(n-1)+1 ，n 是最大的参数个数，所以 h = (length-1)/n
+     *
+     * @param unsigned long length
+     * @return unsigned long
+     */
+    static unsigned long getBeginOfTail(unsigned long length) {
+        unsigned long head = (length - 1) / getMaxArity();
+        if (head < 2) {
+            throw "Error, chromosome is too short for the enabled functions, in FunctionRegistry::getBeginOfTail().";
+        }
+        return head;
+    }
+
+    /**
+     * 标量计算
+     *
+     * @param int id
+     * @param const T* arguments
+     * @return T
+     */
+    template<class T>
+    static T apply(int id, const T* arguments) {
+        switch (id) {
+            case 1:
+                return arguments[0] + arguments[1];
+            case 2:
+                return arguments[0] - arguments[1];
+            case 3:
+                return arguments[0] * arguments[1];
+            case 4:
+                return arguments[1] < 1E-18 ? (T)0 : arguments[0] / arguments[1];
+            case 6:
+                return std::sqrt(std::fabs(arguments[0]));
+            case 7:
+                return std::exp(arguments[0] > (T)700 ? (T)700 : arguments[0]);
+            case 8:
+                return std::fabs(arguments[0]) < 1E-18 ? (T)0 : std::log(std::fabs(arguments[0]));
+            case 9:
+                return std::sin(arguments[0]);
+            case 10:
+                return std::fabs(arguments[0]);
+            case 11:
+                return arguments[0] < arguments[1] ? arguments[0] : arguments[1];
+            case 12:
+                return arguments[0] > arguments[1] ? arguments[0] : arguments[1];
+            case 13:
+                return arguments[0] > (T)0 ? arguments[1] : arguments[2];
+            default:
+                break;
+        }
+        long double values[3];
+        int arity = functions[id].arity;
+        for (int k = 0; k < arity; k++) {
+            values[k] = arguments[k];
+        }
+        return (T)functions[id].scalar(values);
+    }
+
+    /**
+     * 批量计算，结果写到 arguments[0] 所在的数组
+     *
+     * 内置函数每个都是一个简单的循环，编译器可以向量化。
+     *
+     * @param int id
+     * @param T* result 一般就是 arguments[0]
+     * @param const T* const* arguments
+     * @param unsigned long count
+     * @return void
+     */
+    template<class T>
+    static void applyBlock(int id, T* result, const T* const* arguments, unsigned long count) {
+        const T* a = arguments[0];
+        const T* b = functions[id].arity > 1 ? arguments[1] : nullptr;
+        const T* c = functions[id].arity > 2 ? arguments[2] : nullptr;
+        switch (id) {
+            case 1:
+                for (unsigned long i = 0; i < count; i++) {
+                    result[i] = a[i] + b[i];
+                }
+                return;
+            case 2:
+                for (unsigned long i = 0; i < count; i++) {
+                    result[i] = a[i] - b[i];
+                }
+                return;
+            case 3:
+                for (unsigned long i = 0; i < count; i++) {
+                    result[i] = a[i] * b[i];
+                }
+                return;
+            case 4:
+                for (unsigned long i = 0; i < count; i++) {
+                    result[i] = b[i] < 1E-18 ? (T)0 : a[i] / b[i];
+                }
+                return;
+            case 6:
+                for (unsigned long i = 0; i < count; i++) {
+                    result[i] = std::sqrt(std::fabs(a[i]));
+                }
+                return;
+            case 7:
+                for (unsigned long i = 0; i < count; i++) {
+                    result[i] = std::exp(a[i] > (T)700 ? (T)700 : a[i]);
+                }
+                return;
+            case 8:
+                for (unsigned long i = 0; i < count; i++) {
+                    result[i] = std::fabs(a[i]) < 1E-18 ? (T)0 : std::log(std::fabs(a[i]));
+                }
+                return;
+            case 9:
+                for (unsigned long i = 0; i < count; i++) {
+                    result[i] = std::sin(a[i]);
+                }
+                return;
+            case 10:
+                for (unsigned long i = 0; i < count; i++) {
+                    result[i] = std::fabs(a[i]);
+                }
+                return;
+            case 11:
+                for (unsigned long i = 0; i < count; i++) {
+                    result[i] = a[i] < b[i] ? a[i] : b[i];
+                }
+                return;
+            case 12:
+                for (unsigned long i = 0; i < count; i++) {
+                    result[i] = a[i] > b[i] ? a[i] : b[i];
+                }
+                return;
+            case 13:
+                for (unsigned long i = 0; i < count; i++) {
+                    result[i] = a[i] > (T)0 ? b[i] : c[i];
+                }
+                return;
+            default:
+                break;
+        }
+        applyCustomBlock(id, result, arguments, count);
+    }
+
+private:
+
+    /** @var std::vector<Function> 按编号存放的全部函数，编号 0 和 5 是占位 */
+    static std::vector<Function> functions;
+
+    static unsigned long version;
+
+    // 私有，内置函数
+    static std::vector<Function> builtin() {
+        std::vector<Function> functions;
+        functions.push_back(make(0, "", 0, false, ""));
+        functions.push_back(make(1, "+", 2, true, "($0 + $1)"));
+        functions.push_back(make(2, "-", 2, true, "($0 - $1)"));
+        functions.push_back(make(3, "*", 2, true, "($0 * $1)"));
+        functions.push_back(make(4, "/", 2, true, "($1 < 1E-18 ? 0.0L : $0 / $1)"));
+        functions.push_back(make(5, "", 0, false, "")); // Op::END
+        functions.push_back(make(6, "sqrt", 1, false, "sqrtl(fabsl($0))"));
+        functions.push_back(make(7, "exp", 1, false, "expl($0 > 700.0L ? 700.0L : $0)"));
+        functions.push_back(make(8, "log", 1, false, "(fabsl($0) < 1E-18 ? 0.0L : logl(fabsl($0)))"));
+        functions.push_back(make(9, "sin", 1, false, "sinl($0)"));
+        functions.push_back(make(10, "abs", 1, false, "fabsl($0)"));
+        functions.push_back(make(11, "min", 2, false, "($0 < $1 ? $0 : $1)"));
+        functions.push_back(make(12, "max", 2, false, "($0 > $1 ? $0 : $1)"));
+        functions.push_back(make(13, "if", 3, false, "($0 > 0.0L ? $1 : $2)"));
+        for (int id = 1; id <= 4; id++) {
+            functions[id].enabled = true;
+        }
+        return functions;
+    }
+
+    // 私有，构造 Function
+    static Function make(int id, const std::string& name, int arity, bool infix, const std::string& cExpression) {
+        Function function;
+        function.id = id;
+        function.name = name;
+        function.arity = arity;
+        function.infix = infix;
+        function.cExpression = cExpression;
+        function.scalar = nullptr;
+        function.block = nullptr;
+        function.enabled = false;
+        return function;
+    }
+
+    // 私有，自定义函数的批量计算，double 且提供了 block 时直接调用
+    static void applyCustomBlock(int id, double* result, const double* const* arguments, unsigned long count) {
+        if (nullptr != functions[id].block) {
+            functions[id].block(result, arguments, count);
+            return;
+        }
+        applyCustomScalarBlock(id, result, arguments, count);
+    }
+
+    template<class T>
+    static void applyCustomBlock(int id, T* result, const T* const* arguments, unsigned long count) {
+        applyCustomScalarBlock(id, result, arguments, count);
+    }
+
+    // 私有，逐个调用标量计算规则
+    template<class T>
+    static void applyCustomScalarBlock(int id, T* result, const T* const* arguments, unsigned long count) {
+        long double values[3];
+        int arity = functions[id].arity;
+        ScalarFunction scalar = functions[id].scalar;
+        for (unsigned long i = 0; i < count; i++) {
+            for (int k = 0; k < arity; k++) {
+                values[k] = arguments[k][i];
+            }
+            result[i] = (T)scalar(values);
+        }
+    }
+
+};
+
+extern template float FunctionRegistry::apply<float>(int id, const float* arguments);
+extern template double FunctionRegistry::apply<double>(int id, const double* arguments);
+extern template long double FunctionRegistry::apply<long double>(int id, const long double* arguments);
+
+extern template void FunctionRegistry::applyBlock<float>(int id, float* result, const float* const* arguments, unsigned long count);
+extern template void FunctionRegistry::applyBlock<double>(int id, double* result, const double* const* arguments, unsigned long count);
+extern template void FunctionRegistry::applyBlock<long double>(int id, long double* result, const long double* const* arguments, unsigned long count);
+
+#endif
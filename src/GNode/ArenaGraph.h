@@ -0,0 +1,251 @@
+#ifndef GNODE_ARENAGRAPH_H
+#define GNODE_ARENAGRAPH_H
+
+#include <vector>
+
+namespace GNode {
+
+    /* 节点连续存放的图
+     *
+     * 和 Graph 不同，节点不单独分配内存，而是按创建顺序放在一个数组里，用下标表示，第一个
+     * 创建的节点是根。每个节点的子节点是边数组中一段连续的下标，顺序就是加入的顺序，也可以
+     * 按位置 setChild() ，例如二元运算的左右参数。
+     *
+     * 给一个节点连续地加入子节点（例如广度优先地构造一棵树）时这段下标直接在边数组末尾增长，
+     * 得到的就是 CSR 的布局；否则这段下标会被搬到末尾并留下空洞，compact() 可以整理。
+     * getNodes() 返回的是指向边数组的范围，遍历不复制任何东西，但是加入边之后会失效。
+     *
+     * clear() 保留已经分配的内存，反复构造和遍历时不会再分配内存。
+     */
+    template<class T>
+    class ArenaGraph {
+
+    public:
+
+        typedef unsigned int Index;
+
+        // 空的位置，没有设置过的子节点
+        static const Index NONE = 0xffffffffu;
+
+        // 一个节点的所有子节点
+        class Range {
+
+        public:
+
+            Range(const Index* first, const Index* last) : first(first), last(last) {
+            }
+
+            const Index* begin() const {
+                return this->first;
+            }
+
+            const Index* end() const {
+                return this->last;
+            }
+
+            unsigned long size() const {
+                return this->last - this->first;
+            }
+
+            bool empty() const {
+                return this->first == this->last;
+            }
+
+            Index operator[](unsigned long i) const {
+                return this->first[i];
+            }
+
+        private:
+            const Index* first;
+            const Index* last;
+        };
+
+        ArenaGraph() {
+        }
+
+        ArenaGraph(void (*deleteCallbackFunction)(T)) {
+            deleteCallback = deleteCallbackFunction;
+        }
+
+        ~ArenaGraph() {
+            clear();
+        }
+
+        ArenaGraph(const ArenaGraph&) = delete;
+
+        ArenaGraph& operator=(const ArenaGraph&) = delete;
+
+        void reserve(unsigned long nodeNumber, unsigned long edgeNumber) {
+            entries.reserve(nodeNumber);
+            edges.reserve(edgeNumber);
+        }
+
+        Index create(T val) {
+            Entry entry;
+            entry.value = val;
+            entry.begin = 0;
+            entry.count = 0;
+            entry.capacity = 0;
+            entries.push_back(entry);
+            return (Index)(entries.size() - 1);
+        }
+
+        Index getRoot() const {
+            return 0;
+        }
+
+        unsigned long size() const {
+            return entries.size();
+        }
+
+        bool empty() const {
+            return entries.empty();
+        }
+
+        T getValue(Index node) const {
+            return entries[node].value;
+        }
+
+        void setValue(Index node, T val) {
+            entries[node].value = val;
+        }
+
+        // 有向的边，加在 node 的子节点末尾
+        void add(Index node, Index child) {
+            Entry& entry = entries[node];
+            reserveChildren(entry, entry.count + 1);
+            edges[entry.begin + entry.count] = child;
+            entry.count++;
+        }
+
+        // 双向的边，和 Node 的 setDoubleLink(true) 一样，已经相连时什么都不做
+        void link(Index a, Index b) {
+            if (!contains(a, b)) {
+                add(a, b);
+            }
+            if (!contains(b, a)) {
+                add(b, a);
+            }
+        }
+
+        // 设置第 slot 个子节点，中间没有设置的位置是 NONE
+        void setChild(Index node, unsigned int slot, Index child) {
+            Entry& entry = entries[node];
+            if (slot >= entry.count) {
+                reserveChildren(entry, slot + 1);
+                for (Index i = entry.count; i < slot; i++) {
+                    edges[entry.begin + i] = NONE;
+                }
+                entry.count = slot + 1;
+            }
+            edges[entry.begin + slot] = child;
+        }
+
+        // 第 slot 个子节点，没有时返回 NONE
+        Index getChild(Index node, unsigned int slot) const {
+            const Entry& entry = entries[node];
+            return slot < entry.count ? edges[entry.begin + slot] : NONE;
+        }
+
+        unsigned int getChildNumber(Index node) const {
+            return entries[node].count;
+        }
+
+        Range getNodes(Index node) const {
+            const Entry& entry = entries[node];
+            const Index* first = edges.data() + entry.begin;
+            return Range(first, first + entry.count);
+        }
+
+        bool contains(Index node, Index child) const {
+            for (Index e : getNodes(node)) {
+                if (e == child) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // 删除 node 到 child 的第一条边，后面的子节点依次前移
+        void remove(Index node, Index child) {
+            Entry& entry = entries[node];
+            Index* first = edges.data() + entry.begin;
+            for (Index i = 0; i < entry.count; i++) {
+                if (first[i] == child) {
+                    for (Index j = i + 1; j < entry.count; j++) {
+                        first[j - 1] = first[j];
+                    }
+                    entry.count--;
+                    return;
+                }
+            }
+        }
+
+        // 删除所有节点和边，保留内存
+        void clear() {
+            if (nullptr != deleteCallback) {
+                for (auto& e : entries) {
+                    deleteCallback(e.value);
+                }
+            }
+            entries.clear();
+            edges.clear();
+        }
+
+        // 按节点顺序重新排列边数组，去掉空洞
+        void compact() {
+            std::vector<Index> packed;
+            packed.reserve(edges.size());
+            for (auto& e : entries) {
+                Index begin = (Index)packed.size();
+                packed.insert(packed.end(), edges.begin() + e.begin, edges.begin() + e.begin + e.count);
+                e.begin = begin;
+                e.capacity = e.count;
+            }
+            edges.swap(packed);
+        }
+
+    protected:
+
+        struct Entry {
+            T value;
+            Index begin; // 子节点在 edges 中的起始位置
+            Index count;
+            Index capacity;
+        };
+
+        std::vector<Entry> entries;
+
+        std::vector<Index> edges;
+
+        void (*deleteCallback)(T) = nullptr;
+
+        // 保证 entry 至少能放 count 个子节点
+        void reserveChildren(Entry& entry, Index count) {
+            if (count <= entry.capacity) {
+                return;
+            }
+            if (entry.begin + entry.capacity == edges.size()) {
+                // 这段已经在末尾，原地增长
+                edges.resize(entry.begin + count);
+                entry.capacity = count;
+                return;
+            }
+            Index capacity = count < 2 * entry.capacity ? 2 * entry.capacity : count;
+            Index begin = (Index)edges.size();
+            edges.resize(begin + capacity);
+            for (Index i = 0; i < entry.count; i++) {
+                edges[begin + i] = edges[entry.begin + i];
+            }
+            entry.begin = begin;
+            entry.capacity = capacity;
+        }
+
+    };
+
+    template<class T>
+    const typename ArenaGraph<T>::Index ArenaGraph<T>::NONE;
+
+}
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef GNODE_ARENATREE_H
+#define GNODE_ARENATREE_H
+
+#include "ArenaGraph.h"
+
+namespace GNode {
+
+    // 节点连续存放的树，只有父节点到子节点的边
+    template<class T>
+    class ArenaTree: public ArenaGraph<T> {
+
+    public:
+
+        ArenaTree(): ArenaGraph<T>() {
+        }
+
+        ArenaTree(T rootValue): ArenaGraph<T>() {
+            this->create(rootValue);
+        }
+
+        ArenaTree(T rootValue, void (*deleteCallbackFunction)(T)): ArenaGraph<T>(deleteCallbackFunction) {
+            this->create(rootValue);
+        }
+
+    private:
+
+        using ArenaGraph<T>::link;
+
+    };
+
+}
+
+#endif
@@ -3,11 +3,22 @@
 
 #include "Node.h"
 #include <set>
-#include <list>
-#include <queue>
+#include <vector>
+#include <chrono>
 
 namespace GNode {
 
+    /* 图，负责释放自己创建的节点
+     *
+     * 节点按创建顺序放在数组里，每个节点记住自己的下标。gc() 是标记-清除：从根节点出发用
+     * 显式的栈遍历，在位图中标记可达的节点，然后线性扫描数组，把可达的节点向前移动、不可达
+     * 的节点批量释放。整个过程是 O(节点数 + 边数) ，栈、位图和待释放的节点都复用成员变量的
+     * 内存，不会为每个节点分配。
+     *
+     * gc(时间片) 是增量的版本，每次最多运行一个时间片，返回 true 表示这一轮回收完成。两次
+     * 调用之间可以继续 create() ，新节点直接当作可达的；如果给节点加了连接，要对新连接的
+     * 节点调用 shade() ，否则它可能被当作不可达的节点释放。
+     */
     template<class T>
     class Graph {
 
@@ -15,21 +26,24 @@ namespace GNode {
 
         Graph() {
             root = new Node<T>();
-            nodes.insert(root);
+            adopt(root);
         }
 
         Graph(T rootValue) {
             root = new Node<T>(rootValue);
-            nodes.insert(root);
+            adopt(root);
         }
 
         Graph(T rootValue, void (*deleteCallbackFunction)(T)) {
             root = new Node<T>(rootValue);
-            nodes.insert(root);
+            adopt(root);
             deleteCallback = deleteCallbackFunction;
         }
 
         ~Graph() {
+            if (SWEEPING == phase) {
+                collect(nullptr);
+            }
             for (auto e : nodes) {
                 if (nullptr != deleteCallback) {
                     deleteCallback(e->getValue());
@@ -45,49 +59,44 @@ namespace GNode {
 
         Node<T>* create(T val) {
             auto node = new Node<T>(val);
-            nodes.insert(node);
+            adopt(node);
             return node;
         }
 
         std::set<Node<T>*> getNodes() {
-            return nodes;
+            std::set<Node<T>*> result;
+            for (unsigned long i = 0; i < nodes.size(); i++) {
+                if (isLiveSlot(i)) {
+                    result.insert(nodes[i]);
+                }
+            }
+            return result;
+        }
+
+        unsigned long size() {
+            return SWEEPING == phase ? nodes.size() - (sweepRead - sweepWrite) : nodes.size();
+        }
+
+        // 批量释放节点的值，代替逐个调用 deleteCallback
+        void setBatchDeleteCallback(void (*batchDeleteCallbackFunction)(T* values, unsigned long count)) {
+            batchDeleteCallback = batchDeleteCallbackFunction;
         }
 
+        // 释放从根节点不可达的节点，正在进行增量回收时把这一轮做完
         void gc() {
-            using namespace std;
-            set<Node<T>*> searched;
-            list<Node<T>*> removeNode;
-            queue<Node<T>*> queryQueue;
-            auto queryNode = root;
-
-            // 从根节点开始遍历整张图，查找所有节点
-            queryQueue.push(root);
-            while (!queryQueue.empty()) {
-                queryNode = queryQueue.front();
-                queryQueue.pop();
-                searched.insert(queryNode);
-                for (auto e : queryNode->getNodes()) {
-                    if (searched.count(e) == 0) {
-                        queryQueue.push(e);
-                    }
-                }
-            }
+            collect(nullptr);
+        }
 
-            // 查找不到的节点就是不可达的节点，删除不可达节点
-            for (auto e : nodes) {
-                if (searched.count(e) == 0) {
-                    // 不能直接在这里进行 nodes.erase(e) 操作！
-                    removeNode.emplace_back(e);
-                    if (nullptr != deleteCallback) {
-                        deleteCallback(e->getValue());
-                    }
-                    delete e;
-                }
-            }
+        // 增量回收，最多运行 slice 的时间，这一轮完成时返回 true
+        bool gc(std::chrono::nanoseconds slice) {
+            auto deadline = std::chrono::steady_clock::now() + slice;
+            return collect(&deadline);
+        }
 
-            // 从图的节点集合中移除删除掉的节点
-            for (auto e : removeNode) {
-                nodes.erase(e);
+        // 增量回收的写屏障：node 刚被连接到图中的某个节点上
+        void shade(Node<T>* node) {
+            if (MARKING == phase) {
+                markNode(node);
             }
         }
 
@@ -95,10 +104,133 @@ namespace GNode {
 
         Node<T>* root;
 
-        std::set<Node<T>*> nodes;
+        // 所有节点，node->graphIndex 是它的下标
+        std::vector<Node<T>*> nodes;
 
         void (*deleteCallback)(T) = nullptr;
 
+        void (*batchDeleteCallback)(T* values, unsigned long count) = nullptr;
+
+        void adopt(Node<T>* node) {
+            node->graphIndex = nodes.size();
+            nodes.push_back(node);
+            if (IDLE != phase) {
+                // 回收过程中创建的节点这一轮不释放
+                unsigned long word = node->graphIndex / 64;
+                if (word >= marks.size()) {
+                    marks.resize(word + 1, 0);
+                }
+                marks[word] |= 1UL << (node->graphIndex % 64);
+            }
+        }
+
+    private:
+
+        enum Phase {IDLE, MARKING, SWEEPING};
+
+        Phase phase = IDLE;
+
+        // 每个节点一位，按回收开始时的下标
+        std::vector<unsigned long> marks;
+
+        std::vector<Node<T>*> markStack;
+
+        std::vector<Node<T>*> victims;
+
+        std::vector<T> victimValues;
+
+        // 清除阶段的读写位置，[sweepWrite, sweepRead) 是已经处理过的旧位置
+        unsigned long sweepRead = 0;
+
+        unsigned long sweepWrite = 0;
+
+        bool isLiveSlot(unsigned long i) {
+            return SWEEPING != phase || i < sweepWrite || i >= sweepRead;
+        }
+
+        bool isMarked(unsigned long i) {
+            return 0 != (marks[i / 64] & (1UL << (i % 64)));
+        }
+
+        void markNode(Node<T>* node) {
+            unsigned long i = node->graphIndex;
+            // 不是这张图创建的节点不管
+            if (i >= nodes.size() || nodes[i] != node || isMarked(i)) {
+                return;
+            }
+            marks[i / 64] |= 1UL << (i % 64);
+            markStack.push_back(node);
+        }
+
+        bool expired(const std::chrono::steady_clock::time_point* deadline, unsigned long work) {
+            // 每 256 步看一次时间
+            return nullptr != deadline && 0 == (work & 255) && std::chrono::steady_clock::now() >= *deadline;
+        }
+
+        bool collect(const std::chrono::steady_clock::time_point* deadline) {
+            unsigned long work = 0;
+            bool finished = false;
+            if (IDLE == phase) {
+                marks.assign((nodes.size() + 63) / 64, 0);
+                markStack.clear();
+                phase = MARKING;
+                markNode(root);
+            }
+            while (MARKING == phase && !expired(deadline, ++work)) {
+                if (markStack.empty()) {
+                    phase = SWEEPING;
+                    sweepRead = 0;
+                    sweepWrite = 0;
+                    break;
+                }
+                Node<T>* node = markStack.back();
+                markStack.pop_back();
+                for (auto e : node->viewNodes()) {
+                    markNode(e);
+                }
+            }
+            while (SWEEPING == phase && !expired(deadline, ++work)) {
+                if (sweepRead == nodes.size()) {
+                    nodes.resize(sweepWrite);
+                    phase = IDLE;
+                    finished = true;
+                    break;
+                }
+                Node<T>* node = nodes[sweepRead];
+                if (isMarked(sweepRead)) {
+                    node->graphIndex = sweepWrite;
+                    nodes[sweepWrite++] = node;
+                } else {
+                    victims.push_back(node);
+                }
+                sweepRead++;
+            }
+            release();
+            return finished;
+        }
+
+        // 批量释放这一次找到的不可达节点
+        void release() {
+            if (victims.empty()) {
+                return;
+            }
+            if (nullptr != batchDeleteCallback) {
+                victimValues.clear();
+                for (auto e : victims) {
+                    victimValues.push_back(e->getValue());
+                }
+                batchDeleteCallback(victimValues.data(), victimValues.size());
+            } else if (nullptr != deleteCallback) {
+                for (auto e : victims) {
+                    deleteCallback(e->getValue());
+                }
+            }
+            for (auto e : victims) {
+                delete e;
+            }
+            victims.clear();
+        }
+
     };
 
 }
@@ -5,9 +5,14 @@
 
 namespace GNode {
 
+    template<class T>
+    class Graph;
+
     template<class T>
     class Node {
 
+        friend class Graph<T>;
+
     public:
 
         Node() {
@@ -42,6 +47,11 @@ namespace GNode {
             return nodes;
         }
 
+        // 和 getNodes() 相同，但不复制，遍历时不能修改这个节点的连接
+        const std::set<Node<T>*>& viewNodes() const {
+            return nodes;
+        }
+
         void remove(Node<T>* node) {
             if (nodes.count(node) == 0) {
                 return;
@@ -60,6 +70,9 @@ namespace GNode {
 
         bool useDoubleLink = true;
 
+        // 在所属的 Graph 中的下标
+        unsigned long graphIndex = 0;
+
     };
 
 }
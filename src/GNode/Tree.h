@@ -25,7 +25,7 @@ namespace GNode {
         Node<T>* create(T val) {
             auto node = new Node<T>(val);
             node->setDoubleLink(false);
-            this->nodes.insert(node);
+            this->adopt(node);
             return node;
         }
 
@@ -2,11 +2,18 @@
 #define GENETICALGORITHM_CHROMOSOME_H
 
 #include "../Op.h"
-#include "../GNode/Tree.h"
-#include "../GNode/Node.h"
-#include "Utils/GlobalCppRandomEngine.h"
+#include "../GNode/ArenaTree.h"
+#include "../Expression/Program.h"
+#include "../Expression/IncrementalEvaluator.h"
+#include "../Fitness/Objective.h"
+#include "EvolutionContext.h"
 #include <iostream>
-#include <queue>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <new>
+#include <vector>
 
 namespace GeneticAlgorithm {
 
@@ -19,12 +26,51 @@ namespace GeneticAlgorithm {
         /** @var unsigned long 保存了此染色体的长度 */
         unsigned long lengthOfData;
 
-        /** @var Op** 保存了此染色体中基因的信息 */
+        /** @var unsigned long 每个基因的长度，等于 lengthOfData / numberOfGene */
+        unsigned long lengthOfGene;
+
+        /** @var unsigned long 每个基因中尾部开始的位置，也就是头部的长度 */
+        unsigned long beginOfTail;
+
+        /** @var unsigned long 基因的个数，每个基因编码一棵表达式树 */
+        unsigned long numberOfGene;
+
+        /** @var int 连接各个基因的函数，必须是二元函数，例如 Op::ADD */
+        int linkingFunction;
+
+        /** @var long double* 每个基因的计算结果 */
+        long double* geneValueCached;
+
+        /** @var bool* 每个基因的计算结果是否有效，修改基因时只让对应的基因失效 */
+        bool* isGeneValueCached;
+
+        /** @var Expression::IncrementalEvaluator** 每个基因保留中间结果的求值器，没有打开时都是 nullptr */
+        Expression::IncrementalEvaluator** geneEvaluator;
+
+        /** @var EvolutionContext* 随机数引擎、适应度函数等进化的环境，不归染色体管理 */
+        EvolutionContext* context;
+
+        /** @var Op** 保存了此染色体中基因的信息，设置过的位置总是指向 geneStorage 中对应的位置 */
         Op** dataArray;
 
+        /** @var Op* 连续存放所有基因的内存，交叉和拷贝可以整段复制，不用逐个 new */
+        Op* geneStorage;
+
         /** @var bool 为true时表示计算Fitness后缓存了计算结果，可以不用重复算 */
         bool isFitnessCached = false;
 
+        /** @var bool 缓存的适应度只是估计值，例如竞赛式计算在随机子集上淘汰的个体 */
+        bool isFitnessEstimated = false;
+
+        /** @var bool 表达式的哈希值是否有效 */
+        bool isHashCached = false;
+
+        /** @var std::size_t 缓存的表达式哈希值 */
+        std::size_t hashCached = 0;
+
+        /** @var unsigned long 缓存的表达出来的节点个数，和哈希值一起计算 */
+        unsigned long expressedSizeCached = 0;
+
         /** @var long double 缓存的上一次的适应度计算结果。需要判断isFitnessCached以确定确实缓存下来了。 */
         long double fitnessCached;
 
@@ -33,38 +79,94 @@ namespace GeneticAlgorithm {
         /**
          * 创建染色体
          *
-         * 入参是染色体的长度
+         * 入参是染色体的长度，头部的长度由 FunctionRegistry 中启用的函数的最大参数个数决定
          *
          * @param unsigned long lengthOfChromosome
          */
-        Chromosome(unsigned long lengthOfChromosome) {
-            if (lengthOfChromosome < 8) {
+        Chromosome(unsigned long lengthOfChromosome): Chromosome(lengthOfChromosome, 0) {
+        }
+
+        /**
+         * 创建染色体，指定头部的长度
+         *
+         * @param unsigned long lengthOfChromosome
+         * @param unsigned long beginOfTail 尾部开始的位置，0 表示按 FunctionRegistry 计算
+         */
+        Chromosome(unsigned long lengthOfChromosome, unsigned long beginOfTail): Chromosome(lengthOfChromosome, beginOfTail, 1, Op::ADD) {
+        }
+
+        /**
+         * 创建多基因的染色体
+         *
+         * 染色体平均分成 numberOfGene 个基因，每个基因有自己的头部和尾部，解码得到的表达式
+         * 用 linkingFunction 从左到右连接起来：((g0 L g1) L g2) ...
+         *
+         * @param unsigned long lengthOfChromosome 染色体的总长度，必须是 numberOfGene 的倍数
+         * @param unsigned long beginOfTail 每个基因中尾部开始的位置，0 表示按 FunctionRegistry 计算
+         * @param unsigned long numberOfGene 基因的个数
+         * @param int linkingFunction 连接函数，必须是二元函数
+         * @param EvolutionContext* context 进化的环境，nullptr 时使用 EvolutionContext::getDefault()
+         */
+        Chromosome(unsigned long lengthOfChromosome, unsigned long beginOfTail, unsigned long numberOfGene, int linkingFunction, EvolutionContext* context = nullptr) {
+            if (numberOfGene < 1 || 0 != lengthOfChromosome % numberOfGene) {
+                throw "Error, lengthOfChromosome must be a multiple of numberOfGene";
+            }
+            unsigned long lengthOfGene = lengthOfChromosome / numberOfGene;
+            if (lengthOfGene < 8) {
                 throw "Error, lengthOfChromosome must >= 8";
             }
+            if (numberOfGene > 1 && (!FunctionRegistry::exists(linkingFunction) || 2 != FunctionRegistry::getArity(linkingFunction))) {
+                throw "Error, linkingFunction must be a binary function";
+            }
+            if (0 == beginOfTail) {
+                beginOfTail = FunctionRegistry::getBeginOfTail(lengthOfGene);
+            }
+            if (beginOfTail < 2 || beginOfTail >= lengthOfGene) {
+                throw "Error, beginOfTail out of range";
+            }
+            this->beginOfTail = beginOfTail;
+            this->context = nullptr == context ? &EvolutionContext::getDefault() : context;
             this->dataArray = new Op*[lengthOfChromosome];
             for (unsigned long i = 0; i < lengthOfChromosome; i++) {
                 this->dataArray[i] = nullptr;
             }
+            // Op 可以平凡复制和析构，只分配内存，放入基因时再构造
+            this->geneStorage = static_cast<Op*>(::operator new(sizeof(Op) * lengthOfChromosome));
             this->lengthOfData = lengthOfChromosome;
+            this->lengthOfGene = lengthOfGene;
+            this->numberOfGene = numberOfGene;
+            this->linkingFunction = linkingFunction;
+            this->geneValueCached = new long double[numberOfGene];
+            this->isGeneValueCached = new bool[numberOfGene];
+            this->geneEvaluator = new Expression::IncrementalEvaluator*[numberOfGene];
+            for (unsigned long i = 0; i < numberOfGene; i++) {
+                this->isGeneValueCached[i] = false;
+                this->geneEvaluator[i] = nullptr;
+            }
         }
 
         /**
          * 删除染色体，释放内存
          */
         ~Chromosome() {
-            for (unsigned long i = 0; i < this->lengthOfData; i++) {
-                if (nullptr != this->dataArray) {
-                    delete this->dataArray[i];
-                }
-            }
             delete[] this->dataArray;
+            ::operator delete(this->geneStorage);
+            delete[] this->geneValueCached;
+            delete[] this->isGeneValueCached;
+            for (unsigned long i = 0; i < this->numberOfGene; i++) {
+                delete this->geneEvaluator[i];
+            }
+            delete[] this->geneEvaluator;
         }
 
         /**
-         * 设置给定位置的 Op 对象指针
+         * 设置给定位置的 Op 对象
+         *
+         * 染色体接管 value ：内容复制到染色体自己的连续存储中，然后 delete value ，调用之后
+         * 不能再使用 value 。
          *
          * @param unsigned long offset 位置，大于等于0小于染色体的长度
-         * @param Op* value Op 对象的指针
+         * @param Op* value 用 new 创建的 Op 对象的指针
          * @return bool 成功返回 true
          */
         bool setGene(unsigned long offset, Op* value) {
@@ -72,8 +174,11 @@ namespace GeneticAlgorithm {
                 return false;
             }
             if (this->dataArray[offset] != value) {
-                this->dataArray[offset] = value;
+                this->placeGene(offset, *value);
+                delete value;
                 this->isFitnessCached = false;
+                this->isHashCached = false;
+                this->geneChanged(offset);
             }
             return true;
         }
@@ -81,6 +186,8 @@ namespace GeneticAlgorithm {
         /**
          * 获取给定位置的 Op 对象的指针
          *
+         * 指向染色体自己的存储，不能 delete ，染色体释放后失效
+         *
          * @param unsigned long offset 位置，大于等于0小于染色体的长度
          * @return Op* Op对象指针
          */
@@ -98,12 +205,169 @@ namespace GeneticAlgorithm {
          */
         void dump() {
             using namespace std;
-            auto tree = this->buildTree();
-            auto root = tree->getRoot();
-            auto rootOp = root->getValue();
-            rootOp->print(root);
-            cout << "=" << rootOp->calculate(root) << endl;
-            delete tree;
+            long double value = this->printLinked(this->numberOfGene - 1);
+            cout << "=" << value << endl;
+        }
+
+        /**
+         * 以文本形式保存染色体，可以用 ChromosomeFactory::buildFromStream() 读取
+         *
+         * 第一行是 "GEP-CHROMOSOME 3 <长度> <每个基因的头部长度> <基因个数> <连接函数>"，
+         * 之后每行一个位置：
+         * "op <运算符>"、"num <值> <最小值> <最大值>" 或者 "var <变量序号>"
+         *
+         * @param std::ostream& output
+         * @return void
+         */
+        void save(std::ostream& output) {
+            using namespace std;
+            auto precision = output.precision(numeric_limits<long double>::max_digits10);
+            output << "GEP-CHROMOSOME 3 " << this->lengthOfData << " " << this->beginOfTail << " " << this->numberOfGene << " " << this->linkingFunction << endl;
+            for (unsigned long i = 0; i < this->lengthOfData; i++) {
+                Op* gene = this->dataArray[i];
+                if (nullptr == gene) {
+                    throw "Error, null gene, in Chromosome::save().";
+                }
+                if (Op::OP_OPERATION == gene->getOpType()) {
+                    output << "op " << gene->getTypeValue() << endl;
+                } else if (Op::OP_VARIABLE == gene->getOpType()) {
+                    output << "var " << gene->getTypeValue() << endl;
+                } else {
+                    output << "num " << gene->getValue() << " " << gene->getMin() << " " << gene->getMax() << endl;
+                }
+            }
+            output.precision(precision);
+        }
+
+        /**
+         * 解码成后缀表达式形式的程序，用于化简、导出代码等
+         *
+         * @return Expression::Program
+         */
+        Expression::Program compile() {
+            Expression::Program program = this->compileGene(0);
+            for (unsigned long i = 1; i < this->numberOfGene; i++) {
+                program.append(this->compileGene(i));
+                program.pushOperation(this->linkingFunction);
+            }
+            return program;
+        }
+
+        /**
+         * 解码一个基因
+         *
+         * @param unsigned long gene 基因的序号
+         * @return Expression::Program
+         */
+        Expression::Program compileGene(unsigned long gene) {
+            return Expression::Program::decode(this->dataArray + gene * this->lengthOfGene, this->lengthOfGene, this->beginOfTail);
+        }
+
+        /**
+         * 计算染色体表达式的值
+         *
+         * 每个基因单独计算并缓存，修改了哪个基因就只重新计算那个基因，再重新连接。
+         *
+         * @return long double
+         */
+        long double getValue() {
+            long double arguments[3] = {};
+            for (unsigned long i = 0; i < this->numberOfGene; i++) {
+                if (this->isGeneValueCached[i]) {
+                    continue;
+                }
+                if (this->context->isIncrementalEvaluation()) {
+                    if (nullptr == this->geneEvaluator[i]) {
+                        this->geneEvaluator[i] = new Expression::IncrementalEvaluator(this->dataArray + i * this->lengthOfGene, this->lengthOfGene, this->beginOfTail);
+                    }
+                    this->geneValueCached[i] = this->geneEvaluator[i]->evaluate();
+                } else {
+                    this->geneValueCached[i] = this->compileGene(i).evaluate<long double>();
+                }
+                this->isGeneValueCached[i] = true;
+            }
+            arguments[0] = this->geneValueCached[0];
+            for (unsigned long i = 1; i < this->numberOfGene; i++) {
+                arguments[1] = this->geneValueCached[i];
+                arguments[0] = FunctionRegistry::apply<long double>(this->linkingFunction, arguments);
+            }
+            return arguments[0];
+        }
+
+        /**
+         * 获取进化的环境
+         *
+         * @return EvolutionContext*
+         */
+        EvolutionContext* getContext() {
+            return this->context;
+        }
+
+        /**
+         * 换到另一个进化的环境，例如迁移到另一个岛上
+         *
+         * 之后的变异和交叉使用新环境的随机数引擎。适应度函数不同时缓存的适应度和每个基因
+         * 在数据集上保留的中间结果都失效。
+         *
+         * @param EvolutionContext* context
+         * @return void
+         */
+        void setContext(EvolutionContext* context) {
+            if (context->getObjective() != this->context->getObjective()) {
+                this->isFitnessCached = false;
+                for (unsigned long i = 0; i < this->numberOfGene; i++) {
+                    delete this->geneEvaluator[i];
+                    this->geneEvaluator[i] = nullptr;
+                }
+            }
+            this->context = context;
+        }
+
+        /**
+         * 获取基因的个数
+         *
+         * @return unsigned long
+         */
+        unsigned long getNumberOfGene() {
+            return this->numberOfGene;
+        }
+
+        /**
+         * 获取每个基因的长度
+         *
+         * @return unsigned long
+         */
+        unsigned long getLengthOfGene() {
+            return this->lengthOfGene;
+        }
+
+        /**
+         * 获取连接函数
+         *
+         * @return int
+         */
+        int getLinkingFunction() {
+            return this->linkingFunction;
+        }
+
+        /**
+         * 从另一个同样结构的染色体拷贝一个基因，连同这个基因缓存的计算结果
+         *
+         * @param Chromosome* source
+         * @param unsigned long gene 基因的序号
+         * @return void
+         */
+        void copyGene(Chromosome* source, unsigned long gene) {
+            this->copyGene(source, gene, gene);
+        }
+
+        /**
+         * 获取每个基因中尾部开始的位置，也就是头部的长度
+         *
+         * @return unsigned long
+         */
+        unsigned long getBeginOfTail() {
+            return this->beginOfTail;
         }
 
         /**
@@ -118,49 +382,193 @@ namespace GeneticAlgorithm {
         /**
          * 获取适应度
          *
+         * 环境设置了适应度函数时，打开了 EvolutionContext::setIncrementalEvaluation() 并且适应度
+         * 函数支持 evaluatePredicted() 就用每个基因保留的中间结果计算，否则解码成程序后整个计算。
+         * MainProcess 的竞赛式、分块和共用子表达式的计算会先用 setFitness() 设置好适应度，
+         * 这里直接返回。
+         *
          * @return long double
          */
         long double getFitness() {
             if (this->isFitnessCached) {
                 return this->fitnessCached;
             }
-            auto tree = this->buildTree();
-            auto root = tree->getRoot();
-            auto rootOp = root->getValue();
-            auto different = 100.0L - rootOp->calculate(root);
+            const Fitness::Objective* objective = this->context->getObjective();
+            if (nullptr != objective) {
+                if (this->context->isIncrementalEvaluation() && objective->canEvaluatePredicted()) {
+                    this->fitnessCached = objective->evaluatePredicted(this->predict());
+                } else {
+                    this->fitnessCached = objective->evaluate(this->compile());
+                }
+                this->isFitnessCached = true;
+                this->isFitnessEstimated = false;
+                return this->fitnessCached;
+            }
+            this->setValue(this->getValue());
+            return this->fitnessCached;
+        }
+
+        /**
+         * 表达出来的表达式的哈希值
+         *
+         * 只看解码以后的表达式，没有表达出来的位置不影响结果，两个染色体表达式相同时哈希值
+         * 一定相同。用来在 O(n) 时间里统计种群中不同个体的数量。
+         *
+         * @return std::size_t
+         */
+        std::size_t getExpressionHash() {
+            if (this->isHashCached) {
+                return this->hashCached;
+            }
+            // 按解码的顺序走一遍表达出来的节点，广度优先的节点序列唯一确定表达式树，不需要解码
+            std::size_t seed = std::hash<int>()(this->linkingFunction);
+            unsigned long offset, pending, size = this->numberOfGene - 1;
+            Op* op;
+            for (unsigned long gene = 0; gene < this->numberOfGene; gene++) {
+                Op** dataArray = this->dataArray + gene * this->lengthOfGene;
+                seed ^= gene + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+                if (Op::OP_OPERATION == dataArray[0]->getOpType() && Op::END == dataArray[0]->getTypeValue()) {
+                    size++;
+                    continue;
+                }
+                offset = 0;
+                pending = 1;
+                while (pending > 0 && offset < this->lengthOfGene) {
+                    op = dataArray[offset];
+                    if (offset > 0 && Op::OP_OPERATION == op->getOpType() && Op::END == op->getTypeValue()) {
+                        offset = this->beginOfTail;
+                        op = dataArray[offset];
+                    }
+                    seed ^= std::hash<int>()(op->getOpType()) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+                    if (Op::OP_NUMBER == op->getOpType()) {
+                        seed ^= std::hash<long double>()(op->getValue()) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+                    } else {
+                        seed ^= std::hash<int>()(op->getTypeValue()) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+                    }
+                    pending--;
+                    size++;
+                    if (Op::OP_OPERATION == op->getOpType()) {
+                        pending += FunctionRegistry::getArity(op->getTypeValue());
+                    }
+                    offset++;
+                }
+            }
+            this->hashCached = seed;
+            this->expressedSizeCached = size;
+            this->isHashCached = true;
+            return seed;
+        }
+
+        /**
+         * 表达出来的节点个数，包括连接各个基因的函数，和计算的代价成正比
+         *
+         * @return unsigned long
+         */
+        unsigned long getExpressedSize() {
+            this->getExpressionHash();
+            return this->expressedSizeCached;
+        }
+
+        /**
+         * 适应度是否已经算好
+         *
+         * @return bool
+         */
+        bool hasFitness() {
+            return this->isFitnessCached;
+        }
+
+        /**
+         * 用在别处算好的表达式的值设置适应度，例如 Expression::ExpressionStore 共用计算的结果
+         *
+         * @param long double value 整个染色体表达式的值
+         * @return void
+         */
+        void setValue(long double value) {
+            auto different = 100.0L - value;
             this->fitnessCached = 1.0L / (different * different + 1.0L);
-            delete tree;
             this->isFitnessCached = true;
-            return this->fitnessCached;
+            this->isFitnessEstimated = false;
+        }
+
+        /**
+         * 设置在别处算好的适应度，例如 Fitness::RacingEvaluator 的结果
+         *
+         * @param long double fitness
+         * @param bool estimated 只是估计值，没有在整个数据集上算完
+         * @return void
+         */
+        void setFitness(long double fitness, bool estimated = false) {
+            this->fitnessCached = fitness;
+            this->isFitnessCached = true;
+            this->isFitnessEstimated = estimated;
+        }
+
+        /**
+         * 适应度是否只是估计值，锦标赛选择时不和完整算出的适应度比较
+         *
+         * @return bool
+         */
+        bool hasEstimatedFitness() {
+            return this->isFitnessCached && this->isFitnessEstimated;
         }
 
         /**
          * 与另一个染色体交叉，返回新的染色体
          *
+         * 多基因时先随机选一个基因，它前面的基因来自这一方，后面的来自另一方，这两部分连同
+         * 缓存的计算结果直接拷贝；选中的基因头部单点交叉、尾部取平均。
+         *
          * @param Chromosome* another 另一个染色体对象
          * @return Chromosome* 新的染色体对象，需要手动释放内存
          */
         Chromosome* crossover(Chromosome* another) {
-            using GeneticAlgorithm::Utils::GlobalCppRandomEngine;
-            unsigned long beginOfTail = this->lengthOfData / 2 - 1;
-            if (another->getLength() != this->lengthOfData) {
-                throw "Length not equals!";
+            std::default_random_engine& engine = this->context->getEngine();
+            this->checkSameStructure(another);
+            unsigned long crossoverGene = 0;
+            if (this->numberOfGene > 1) {
+                std::uniform_int_distribution<unsigned long> geneDistribution(0, this->numberOfGene - 1);
+                crossoverGene = geneDistribution(engine);
             }
+            unsigned long beginOfTail = this->beginOfTail;
+            unsigned long base = crossoverGene * this->lengthOfGene;
             std::uniform_int_distribution<unsigned long> crossoverSplitDistribution(1, beginOfTail - 1);
-            auto offset = crossoverSplitDistribution(GlobalCppRandomEngine::engine);
-            auto newChromosome = new Chromosome(this->lengthOfData);
-            for (unsigned long i = 0; i < offset; i++) {
-                newChromosome->setGene(i, Op::createLike(this->dataArray[i]));
+            auto offset = crossoverSplitDistribution(engine);
+            auto newChromosome = new Chromosome(this->lengthOfData, beginOfTail, this->numberOfGene, this->linkingFunction, this->context);
+            for (unsigned long gene = 0; gene < this->numberOfGene; gene++) {
+                if (gene < crossoverGene) {
+                    newChromosome->copyGene(this, gene);
+                } else if (gene > crossoverGene) {
+                    newChromosome->copyGene(another, gene);
+                }
             }
-            for (unsigned long i = offset; i < beginOfTail; i++) {
-                newChromosome->setGene(i, Op::createLike(another->getGene(i)));
+            newChromosome->copyRange(this, base, base + offset);
+            newChromosome->copyRange(another, base + offset, base + beginOfTail);
+            newChromosome->copyRange(this, base + beginOfTail, base + this->lengthOfGene);
+            Op* gene;
+            for (unsigned long i = base + beginOfTail; i < base + this->lengthOfGene; i++) {
+                gene = newChromosome->geneStorage + i;
+                // 输入变量不能取平均，直接保留这一方的基因
+                if (Op::OP_NUMBER == gene->getOpType() && Op::OP_NUMBER == another->geneStorage[i].getOpType()) {
+                    newChromosome->placeGene(i, Op(Op::OP_NUMBER, (gene->getValue() + another->geneStorage[i].getValue()) / 2.0, gene->getMin(), gene->getMax()));
+                }
             }
-            long double mixValue = 0.0, min = 0.0, max = 0.0;
-            for (unsigned long i = beginOfTail; i < this->lengthOfData; i++) {
-                min = this->getGene(i)->getMin();
-                max = this->getGene(i)->getMax();
-                mixValue = (this->getGene(i)->getValue() + another->getGene(i)->getValue()) / 2.0;
-                newChromosome->setGene(i, new Op(Op::OP_NUMBER, mixValue, min, max));
+            return newChromosome;
+        }
+
+        /**
+         * 基因重组：新染色体的每个基因随机地整个来自其中一方，连同缓存的计算结果
+         *
+         * @param Chromosome* another 另一个染色体对象
+         * @return Chromosome* 新的染色体对象，需要手动释放内存
+         */
+        Chromosome* geneRecombination(Chromosome* another) {
+            std::default_random_engine& engine = this->context->getEngine();
+            this->checkSameStructure(another);
+            std::bernoulli_distribution fromThis(0.5);
+            auto newChromosome = new Chromosome(this->lengthOfData, this->beginOfTail, this->numberOfGene, this->linkingFunction, this->context);
+            for (unsigned long gene = 0; gene < this->numberOfGene; gene++) {
+                newChromosome->copyGene(fromThis(engine) ? this : another, gene);
             }
             return newChromosome;
         }
@@ -172,84 +580,295 @@ namespace GeneticAlgorithm {
          * @return void
          */
         void mutation(long double r) {
-            using GeneticAlgorithm::Utils::GlobalCppRandomEngine;
-            unsigned long beginOfTail = this->lengthOfData / 2 - 1;
+            std::default_random_engine& engine = this->context->getEngine();
+            unsigned long beginOfTail = this->beginOfTail;
             if (r <= 0.0) {
                 return;
             }
-            Op* oldGene;
-            std::uniform_real_distribution<long double> p(0.0, 1.0);
-            for (unsigned long i = 0; i < this->lengthOfData; i++) {
-                if (p(GlobalCppRandomEngine::engine) <= r) {
-                    this->isFitnessCached = false;
-                    oldGene = this->dataArray[i];
-                    if (i < beginOfTail) {
-                        this->dataArray[i] = Op::getRandomOptionOp();
-                    } else if (nullptr != oldGene) {
-                        this->dataArray[i] = Op::getRandomNumberOp(oldGene->getMin(), oldGene->getMax());
-                    } else {
-                        this->dataArray[i] = Op::getRandomNumberOp();
-                    }
-                    if (nullptr != oldGene) {
-                        delete oldGene;
-                    }
+            // 每个位置独立地以概率 r 变异，等价于两次变异之间跳过的位置数服从几何分布，
+            // 直接跳到下一个变异的位置，随机数的个数和变异的次数成正比，而不是和长度成正比
+            std::geometric_distribution<unsigned long> skip(r < 1.0 ? (double)r : 1.0);
+            for (unsigned long i = skip(engine); i < this->lengthOfData; i += 1 + skip(engine)) {
+                this->isFitnessCached = false;
+                this->isHashCached = false;
+                if (i % this->lengthOfGene < beginOfTail) {
+                    this->placeGene(i, this->context->makeRandomOptionOp());
+                } else if (nullptr != this->dataArray[i]) {
+                    this->placeGene(i, this->context->makeRandomTerminalOp(this->dataArray[i]->getMin(), this->dataArray[i]->getMax()));
+                } else {
+                    this->placeGene(i, this->context->makeRandomTerminalOp());
                 }
+                this->geneChanged(i);
+            }
+        }
+
+        /**
+         * IS 插串：从染色体任意位置取一段长度为 1 到 maxLength 的序列，插入到随机一个基因
+         * 头部中除了根节点以外的随机位置，头部原来的内容后移，超出头部的部分丢弃
+         *
+         * @param unsigned long maxLength
+         * @return void
+         */
+        void transposeInsertionSequence(unsigned long maxLength = 3) {
+            std::default_random_engine& engine = this->context->getEngine();
+            std::uniform_int_distribution<unsigned long> sourceDistribution(0, this->lengthOfData - 1);
+            std::uniform_int_distribution<unsigned long> lengthDistribution(1, maxLength < 1 ? 1 : maxLength);
+            std::uniform_int_distribution<unsigned long> geneDistribution(0, this->numberOfGene - 1);
+            std::uniform_int_distribution<unsigned long> targetDistribution(1, this->beginOfTail - 1);
+            unsigned long source = sourceDistribution(engine);
+            unsigned long length = lengthDistribution(engine);
+            unsigned long gene = geneDistribution(engine);
+            unsigned long target = targetDistribution(engine);
+            if (source + length > this->lengthOfData) {
+                length = this->lengthOfData - source;
+            }
+            this->insertIntoHead(gene, target, source, length);
+        }
+
+        /**
+         * RIS 插串：在随机一个基因的头部随机选一个位置，向后找到第一个函数，从那里取一段
+         * 长度为 1 到 maxLength 的序列插入到这个基因的根部
+         *
+         * @param unsigned long maxLength
+         * @return void
+         */
+        void transposeRootInsertionSequence(unsigned long maxLength = 3) {
+            std::default_random_engine& engine = this->context->getEngine();
+            std::uniform_int_distribution<unsigned long> geneDistribution(0, this->numberOfGene - 1);
+            std::uniform_int_distribution<unsigned long> startDistribution(0, this->beginOfTail - 1);
+            std::uniform_int_distribution<unsigned long> lengthDistribution(1, maxLength < 1 ? 1 : maxLength);
+            unsigned long gene = geneDistribution(engine);
+            unsigned long base = gene * this->lengthOfGene;
+            unsigned long source = base + startDistribution(engine);
+            unsigned long length = lengthDistribution(engine);
+            while (source < base + this->beginOfTail && !this->isFunction(this->dataArray[source])) {
+                source++;
+            }
+            if (source >= base + this->beginOfTail || source == base) {
+                return;
+            }
+            if (source + length > base + this->beginOfTail) {
+                length = base + this->beginOfTail - source;
+            }
+            this->insertIntoHead(gene, 0, source, length);
+        }
+
+        /**
+         * 基因转座：把随机一个基因（不是第一个）移动到染色体的最前面
+         *
+         * @return void
+         */
+        void transposeGene() {
+            std::default_random_engine& engine = this->context->getEngine();
+            if (this->numberOfGene < 2) {
+                return;
             }
+            std::uniform_int_distribution<unsigned long> geneDistribution(1, this->numberOfGene - 1);
+            unsigned long gene = geneDistribution(engine);
+            unsigned long base = gene * this->lengthOfGene;
+            std::rotate(this->geneStorage, this->geneStorage + base, this->geneStorage + base + this->lengthOfGene);
+            std::rotate(this->geneValueCached, this->geneValueCached + gene, this->geneValueCached + gene + 1);
+            std::rotate(this->isGeneValueCached, this->isGeneValueCached + gene, this->isGeneValueCached + gene + 1);
+            std::rotate(this->geneEvaluator, this->geneEvaluator + gene, this->geneEvaluator + gene + 1);
+            this->isFitnessCached = false;
+            this->isHashCached = false;
         }
 
     private:
 
         /**
-         * 根据染色体的信息，构造其对应的语法树
+         * 根据一个基因的信息，构造其对应的语法树
          *
-         * @return Tree<Op*>*
+         * 节点按广度优先的顺序放进 tree ，每个运算符的参数按位置排列，构造时不单独分配节点。
+         *
+         * @param unsigned long gene 基因的序号
+         * @param GNode::ArenaTree<Op*>& tree 先被清空，根是 tree.getRoot()
+         * @return void
          */
-        GNode::Tree<Op*>* buildTree() {
+        void buildTree(unsigned long gene, GNode::ArenaTree<Op*>& tree) {
             using namespace GNode;
-            using namespace std;
-            if (nullptr == this->dataArray[0]) {
+            typedef ArenaTree<Op*>::Index Index;
+            static thread_local Op zero(Op::OP_NUMBER, 0.0L);
+            Op** dataArray = this->dataArray + gene * this->lengthOfGene;
+            if (nullptr == dataArray[0]) {
                 throw "Error, nullptr == this->dataArray[0], in Chromosome::buildTree().";
             }
-            if (Op::END == this->dataArray[0]->getTypeValue()) {
-                return new Tree<Op*>(new Op(Op::OP_NUMBER, 0.0L), [](Op* o) {delete o;});
+            tree.clear();
+            if (Op::OP_OPERATION == dataArray[0]->getOpType() && Op::END == dataArray[0]->getTypeValue()) {
+                tree.create(&zero);
+                return;
             }
-            queue<Node<Op*>*> hungryQueue;
-            Node<Op*>* workingNode;
-            Node<Op*>* childNode;
             Op* childNodeOp;
-            int emptyChildNumber = 0;
+            int arity = 0;
             unsigned long offset = 1;
-            unsigned long beginOfTail = this->lengthOfData / 2 - 1;
-            auto tree = new Tree<Op*>(this->dataArray[0]);
-            hungryQueue.push(tree->getRoot());
-            while (!hungryQueue.empty()) {
-                workingNode = hungryQueue.front();
-                hungryQueue.pop();
-                emptyChildNumber = Op::OP_OPERATION == workingNode->getValue()->getOpType() ? 2 : 0;
-                while (emptyChildNumber > 0) {
-                    childNodeOp = this->dataArray[offset];
-                    if (Op::OP_OPERATION == childNodeOp->getOpType()) {
-                        if (Op::END != childNodeOp->getTypeValue()) {
-                            childNode = tree->create(childNodeOp);
-                            hungryQueue.push(childNode);
-                        } else {
-                            offset = beginOfTail;
-                            childNodeOp = this->dataArray[beginOfTail];
-                            childNode = tree->create(childNodeOp);
-                        }
-                    } else {
-                        childNode = tree->create(childNodeOp);
-                    }
-                    childNodeOp->setOpAttribute(2 == emptyChildNumber ? Op::OP_ATTR_LEFT : Op::OP_ATTR_RIGHT);
-                    workingNode->add(childNode);
-                    offset++;
-                    emptyChildNumber--;
-                    if (offset >= this->lengthOfData) {
+            unsigned long beginOfTail = this->beginOfTail;
+            tree.create(dataArray[0]);
+            // 节点按广度优先的顺序创建，下标本身就是待填充参数的队列
+            for (Index workingNode = 0; workingNode < tree.size(); workingNode++) {
+                Op* workingOp = tree.getValue(workingNode);
+                arity = Op::OP_OPERATION == workingOp->getOpType() ? FunctionRegistry::getArity(workingOp->getTypeValue()) : 0;
+                for (int slot = 0; slot < arity; slot++) {
+                    if (offset >= this->lengthOfGene) {
+                        tree.clear();
                         throw "Error, out of size, in Chromosome::buildTree().";
                     }
+                    childNodeOp = dataArray[offset];
+                    if (Op::OP_OPERATION == childNodeOp->getOpType() && Op::END == childNodeOp->getTypeValue()) {
+                        offset = beginOfTail;
+                        childNodeOp = dataArray[beginOfTail];
+                    }
+                    tree.add(workingNode, tree.create(childNodeOp));
+                    offset++;
+                }
+            }
+        }
+
+        // 私有，打印前 last+1 个基因连接起来的表达式，返回它的值
+        long double printLinked(unsigned long last) {
+            using namespace std;
+            if (0 == last) {
+                return this->printGene(0);
+            }
+            const FunctionRegistry::Function& function = FunctionRegistry::get(this->linkingFunction);
+            long double arguments[3] = {};
+            if (function.infix) {
+                cout << "(";
+                arguments[0] = this->printLinked(last - 1);
+                cout << function.name;
+            } else {
+                cout << function.name << "(";
+                arguments[0] = this->printLinked(last - 1);
+                cout << ",";
+            }
+            arguments[1] = this->printGene(last);
+            cout << ")";
+            return FunctionRegistry::apply<long double>(this->linkingFunction, arguments);
+        }
+
+        // 私有，打印一个基因的表达式，返回它的值
+        long double printGene(unsigned long gene) {
+            static thread_local GNode::ArenaTree<Op*> tree;
+            this->buildTree(gene, tree);
+            auto root = tree.getRoot();
+            auto rootOp = tree.getValue(root);
+            rootOp->print(tree, root);
+            return rootOp->calculate(tree, root);
+        }
+
+        // 私有，拷贝 source 的第 sourceGene 个基因到这里的第 gene 个基因
+        void copyGene(Chromosome* source, unsigned long sourceGene, unsigned long gene) {
+            unsigned long base = gene * this->lengthOfGene;
+            unsigned long sourceBase = sourceGene * this->lengthOfGene;
+            std::uninitialized_copy(source->geneStorage + sourceBase, source->geneStorage + sourceBase + this->lengthOfGene, this->geneStorage + base);
+            for (unsigned long i = base; i < base + this->lengthOfGene; i++) {
+                this->dataArray[i] = this->geneStorage + i;
+            }
+            this->isFitnessCached = false;
+            this->isHashCached = false;
+            this->isGeneValueCached[gene] = source->isGeneValueCached[sourceGene];
+            this->geneValueCached[gene] = source->geneValueCached[sourceGene];
+            delete this->geneEvaluator[gene];
+            this->geneEvaluator[gene] = nullptr;
+            // 中间结果是在适应度函数的数据集上算的，环境的适应度函数不同时不能共用
+            if (nullptr != source->geneEvaluator[sourceGene] && source->context->getObjective() == this->context->getObjective()) {
+                this->geneEvaluator[gene] = new Expression::IncrementalEvaluator(*source->geneEvaluator[sourceGene]);
+            }
+        }
+
+        // 私有，把 op 放到 offset 位置
+        void placeGene(unsigned long offset, const Op& op) {
+            new (this->geneStorage + offset) Op(op);
+            this->dataArray[offset] = this->geneStorage + offset;
+        }
+
+        // 私有，新建的染色体从 source 整段复制 [begin, end) 的位置，不更新缓存
+        void copyRange(Chromosome* source, unsigned long begin, unsigned long end) {
+            std::uninitialized_copy(source->geneStorage + begin, source->geneStorage + end, this->geneStorage + begin);
+            for (unsigned long i = begin; i < end; i++) {
+                this->dataArray[i] = this->geneStorage + i;
+            }
+        }
+
+        // 私有，基因数组 offset 位置被修改后，更新对应基因的缓存
+        void geneChanged(unsigned long offset) {
+            using Expression::IncrementalEvaluator;
+            unsigned long gene = offset / this->lengthOfGene;
+            IncrementalEvaluator* evaluator = this->geneEvaluator[gene];
+            if (nullptr == evaluator) {
+                this->isGeneValueCached[gene] = false;
+                return;
+            }
+            IncrementalEvaluator::Change change = evaluator->update(offset % this->lengthOfGene, this->dataArray[offset]);
+            if (IncrementalEvaluator::UNCHANGED == change) {
+                return;
+            }
+            this->isGeneValueCached[gene] = false;
+            if (IncrementalEvaluator::REBUILD == change) {
+                delete evaluator;
+                this->geneEvaluator[gene] = nullptr;
+            }
+        }
+
+        // 私有，用每个基因保留的中间结果算出适应度函数的数据集每一行的预测值，下一次调用之前有效
+        const long double* predict() {
+            static thread_local std::vector<long double> linked;
+            const Data::Dataset& dataset = this->context->getObjective()->getDataset();
+            unsigned long rows = dataset.getRowNumber();
+            const long double* predicted = nullptr;
+            const long double* arguments[3] = {};
+            for (unsigned long i = 0; i < this->numberOfGene; i++) {
+                if (nullptr == this->geneEvaluator[i]) {
+                    this->geneEvaluator[i] = new Expression::IncrementalEvaluator(this->dataArray + i * this->lengthOfGene, this->lengthOfGene, this->beginOfTail);
+                }
+                if ((unsigned long)this->geneEvaluator[i]->getVariableNumber() > dataset.getVariableNumber()) {
+                    throw "Error, program uses more variables than the dataset has, in Chromosome::getFitness().";
+                }
+                // 每个基因的结果只在下一次调用它的求值器之前有效，多基因时先复制出来再连接
+                predicted = this->geneEvaluator[i]->evaluateRows(dataset.getColumns(), rows);
+                if (1 == this->numberOfGene) {
+                    break;
                 }
+                if (0 == i) {
+                    linked.assign(predicted, predicted + rows);
+                    continue;
+                }
+                arguments[0] = linked.data();
+                arguments[1] = predicted;
+                FunctionRegistry::applyBlock<long double>(this->linkingFunction, linked.data(), arguments, rows);
+            }
+            return 1 == this->numberOfGene ? predicted : linked.data();
+        }
+
+        // 私有，检查两个染色体结构相同，可以交叉
+        void checkSameStructure(Chromosome* another) {
+            if (another->lengthOfData != this->lengthOfData || another->beginOfTail != this->beginOfTail || another->numberOfGene != this->numberOfGene || another->linkingFunction != this->linkingFunction) {
+                throw "Length not equals!";
+            }
+        }
+
+        // 私有，是否为有参数的函数（END 不是函数）
+        bool isFunction(Op* op) {
+            return Op::OP_OPERATION == op->getOpType() && Op::END != op->getTypeValue();
+        }
+
+        // 私有，把 source 开始的 length 个位置插入到第 gene 个基因头部的 target 位置
+        void insertIntoHead(unsigned long gene, unsigned long target, unsigned long source, unsigned long length) {
+            unsigned long base = gene * this->lengthOfGene;
+            if (target + length > this->beginOfTail) {
+                length = this->beginOfTail - target;
+            }
+            if (0 == length) {
+                return;
             }
-            return tree;
+            // 先复制插入的序列，它可能和被移动的部分重叠；头部末尾的 length 个位置被挤出去
+            std::vector<Op> sequence(this->geneStorage + source, this->geneStorage + source + length);
+            std::copy_backward(this->geneStorage + base + target, this->geneStorage + base + this->beginOfTail - length, this->geneStorage + base + this->beginOfTail);
+            std::copy(sequence.begin(), sequence.end(), this->geneStorage + base + target);
+            this->isFitnessCached = false;
+            this->isHashCached = false;
+            this->isGeneValueCached[gene] = false;
+            delete this->geneEvaluator[gene];
+            this->geneEvaluator[gene] = nullptr;
         }
 
     };
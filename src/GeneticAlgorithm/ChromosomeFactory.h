@@ -3,9 +3,14 @@
 
 #include "../Op.h"
 #include "Chromosome.h"
-#include "Utils/GlobalCppRandomEngine.h"
+#include "EvolutionContext.h"
+#include "../Expression/Program.h"
+#include "../Expression/Parser.h"
 #include <random>
 #include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
 
 namespace GeneticAlgorithm {
 
@@ -15,6 +20,14 @@ namespace GeneticAlgorithm {
 
     public:
 
+        /**
+         * 创建的染色体都属于 context ，随机的基因也用它的随机数引擎和输入变量生成
+         *
+         * @param EvolutionContext& context
+         */
+        ChromosomeFactory(EvolutionContext& context = EvolutionContext::getDefault()) : context(&context) {
+        }
+
         /**
          * 从一个 Op对象指针的数组中创建染色体
          *
@@ -43,20 +56,24 @@ namespace GeneticAlgorithm {
          * @param unsigned long lengthOfData 染色体长度
          * @param long double numberOpMin 数字 Op 的最小值
          * @param long double numberOpMax 数字 Op 的最大值
+         * @param unsigned long numberOfGene 基因的个数
+         * @param int linkingFunction 连接各个基因的二元函数
          * @return Chromosome*
          */
-        Chromosome* buildRandomChromosome(unsigned long lengthOfData, long double numberOpMin, long double numberOpMax) {
-            // 尾部的数字 OP 数量至少等于头部的操作 OP 的数量 + 2
+        Chromosome* buildRandomChromosome(unsigned long lengthOfData, long double numberOpMin, long double numberOpMax, unsigned long numberOfGene = 1, int linkingFunction = Op::ADD) {
+            // 尾部的数字 OP 数量至少等于 头部长度*(最大参数个数-1)+1
             if (lengthOfData < 8) {
                 throw "lengthOfData must >= 8";
             }
-            unsigned long beginOfTail = lengthOfData / 2 - 1;
-            auto buildChromosome = this->buildEmpty(lengthOfData);
-            for (unsigned long i = 0; i < beginOfTail; i++) {
-                buildChromosome->setGene(i, Op::getRandomOptionOp());
-            }
-            for (unsigned long i = beginOfTail; i < lengthOfData; i++) {
-                buildChromosome->setGene(i, Op::getRandomNumberOp(numberOpMin, numberOpMax));
+            auto buildChromosome = this->buildEmpty(lengthOfData, 0, numberOfGene, linkingFunction);
+            unsigned long beginOfTail = buildChromosome->getBeginOfTail();
+            unsigned long lengthOfGene = buildChromosome->getLengthOfGene();
+            for (unsigned long i = 0; i < lengthOfData; i++) {
+                if (i % lengthOfGene < beginOfTail) {
+                    buildChromosome->setGene(i, new Op(this->context->makeRandomOptionOp()));
+                } else {
+                    buildChromosome->setGene(i, new Op(this->context->makeRandomTerminalOp(numberOpMin, numberOpMax)));
+                }
             }
             return buildChromosome;
         }
@@ -65,26 +82,237 @@ namespace GeneticAlgorithm {
          * 创建空的染色体，其中实数都初始化为 0
          *
          * @param unsigned long lengthOfData 染色体中存储随机实数的个数
+         * @param unsigned long beginOfTail 每个基因中尾部开始的位置，0 表示按 FunctionRegistry 计算
+         * @param unsigned long numberOfGene 基因的个数
+         * @param int linkingFunction 连接各个基因的二元函数
          * @return Chromosome*
          */
-        Chromosome* buildEmpty(unsigned long lengthOfData) {
-            return new Chromosome(lengthOfData);
+        Chromosome* buildEmpty(unsigned long lengthOfData, unsigned long beginOfTail = 0, unsigned long numberOfGene = 1, int linkingFunction = Op::ADD) {
+            return new Chromosome(lengthOfData, beginOfTail, numberOfGene, linkingFunction, this->context);
         }
 
         /**
-         * 深度拷贝创建
+         * 把程序编码成指定结构的染色体
+         *
+         * 表达式树的广度优先序列就是 Karva 编码：所有运算符必须落在头部，最后一个运算符之后
+         * 的终结符如果没有正好从尾部开始，就在头部放一个 Op::END 跳到尾部。最后一个运算符
+         * 之前的终结符留在头部。没有用到的位置随机填充，不会表达出来。
+         *
+         * 多基因时，如果程序是用连接函数从左到右连起来的 numberOfGene 项（Chromosome::dump()
+         * 打印的就是这种形式），每一项放进一个基因；否则整个程序放进第一个基因，其它基因
+         * 是连接函数的单位元（加减为 0 ，乘除为 1 ）。
+         *
+         * @param const Expression::Program& program
+         * @param unsigned long lengthOfData 染色体长度
+         * @param long double numberOpMin 数字的范围，变异时使用
+         * @param long double numberOpMax 数字的范围，变异时使用
+         * @param unsigned long numberOfGene 基因个数
+         * @param int linkingFunction 连接函数
+         * @return Chromosome*
+         */
+        Chromosome* buildFromProgram(const Expression::Program& program, unsigned long lengthOfData, long double numberOpMin, long double numberOpMax, unsigned long numberOfGene = 1, int linkingFunction = Op::ADD) {
+            // 后缀形式转成树
+            auto& instructions = program.getInstructions();
+            std::vector<ProgramNode> nodes(instructions.size());
+            std::vector<unsigned long> stack;
+            for (unsigned long i = 0; i < instructions.size(); i++) {
+                nodes[i].instruction = i;
+                nodes[i].arity = 0;
+                if (Op::OP_NUMBER != instructions[i].code && Op::OP_VARIABLE != instructions[i].code) {
+                    nodes[i].arity = FunctionRegistry::getArity(instructions[i].code);
+                }
+                if (stack.size() < (unsigned long)nodes[i].arity) {
+                    throw "Error, bad program, in ChromosomeFactory::buildFromProgram().";
+                }
+                for (int k = nodes[i].arity - 1; k >= 0; k--) {
+                    nodes[i].children[k] = stack.back();
+                    stack.pop_back();
+                }
+                stack.push_back(i);
+            }
+            if (1 != stack.size()) {
+                throw "Error, bad program, in ChromosomeFactory::buildFromProgram().";
+            }
+            // 拆成各个基因的根节点，-1 表示单位元
+            std::vector<long> roots(numberOfGene, -1);
+            unsigned long current = stack[0];
+            unsigned long gene = numberOfGene - 1;
+            for (; gene > 0; gene--) {
+                if (instructions[nodes[current].instruction].code != linkingFunction || 2 != nodes[current].arity) {
+                    break;
+                }
+                roots[gene] = nodes[current].children[1];
+                current = nodes[current].children[0];
+            }
+            if (0 == gene) {
+                roots[0] = current;
+            } else {
+                if (Op::ADD != linkingFunction && Op::SUB != linkingFunction && Op::PRO != linkingFunction && Op::DES != linkingFunction) {
+                    throw "Error, can not split the program into genes, in ChromosomeFactory::buildFromProgram().";
+                }
+                std::fill(roots.begin(), roots.end(), -1);
+                roots[0] = stack[0];
+            }
+            Chromosome* chromosome = this->buildEmpty(lengthOfData, 0, numberOfGene, linkingFunction);
+            try {
+                for (gene = 0; gene < numberOfGene; gene++) {
+                    this->encodeGene(chromosome, gene, program, nodes, roots[gene], numberOpMin, numberOpMax);
+                }
+            } catch (const char*) {
+                delete chromosome;
+                throw;
+            }
+            return chromosome;
+        }
+
+        /**
+         * 从中缀表达式创建染色体，格式见 Expression::Parser ，编码方式见 buildFromProgram()
+         *
+         * @param const std::string& expression 例如 "((x0*x1)+x0)"
+         * @param unsigned long lengthOfData 染色体长度
+         * @param long double numberOpMin 数字的范围
+         * @param long double numberOpMax 数字的范围
+         * @param unsigned long numberOfGene 基因个数
+         * @param int linkingFunction 连接函数
+         * @return Chromosome*
+         */
+        Chromosome* buildFromExpression(const std::string& expression, unsigned long lengthOfData, long double numberOpMin, long double numberOpMax, unsigned long numberOfGene = 1, int linkingFunction = Op::ADD) {
+            return this->buildFromProgram(Expression::Parser::parse(expression), lengthOfData, numberOpMin, numberOpMax, numberOfGene, linkingFunction);
+        }
+
+        /**
+         * 读取 Chromosome::save() 保存的染色体
+         *
+         * @param std::istream& input
+         * @return Chromosome*
+         */
+        Chromosome* buildFromStream(std::istream& input) {
+            using namespace std;
+            string magic, kind, value, min, max;
+            int version = 0, linkingFunction = Op::ADD;
+            unsigned long lengthOfData = 0, beginOfTail = 0, numberOfGene = 1;
+            input >> magic >> version >> lengthOfData;
+            if (3 == version) {
+                input >> beginOfTail >> numberOfGene >> linkingFunction;
+            } else if (2 == version) {
+                input >> beginOfTail;
+            } else if (1 == version) { // 版本 1 只有二元运算符
+                beginOfTail = lengthOfData / 2 - 1;
+            }
+            if (!input || "GEP-CHROMOSOME" != magic || 0 == beginOfTail) {
+                throw "Error, bad chromosome header, in ChromosomeFactory::buildFromStream().";
+            }
+            Chromosome* buildChromosome = this->buildEmpty(lengthOfData, beginOfTail, numberOfGene, linkingFunction);
+            for (unsigned long i = 0; i < lengthOfData; i++) {
+                input >> kind;
+                if ("op" == kind) {
+                    input >> value;
+                    int typeValue = (int)strtol(value.c_str(), nullptr, 10);
+                    if (Op::END != typeValue && !FunctionRegistry::exists(typeValue)) {
+                        input.setstate(ios::failbit);
+                    }
+                    buildChromosome->setGene(i, new Op(Op::OP_OPERATION, typeValue));
+                } else if ("var" == kind) {
+                    input >> value;
+                    int index = (int)strtol(value.c_str(), nullptr, 10);
+                    if (index < 0) {
+                        input.setstate(ios::failbit);
+                    }
+                    buildChromosome->setGene(i, Op::getVariableOp(index));
+                } else if ("num" == kind) {
+                    input >> value >> min >> max;
+                    buildChromosome->setGene(i, new Op(Op::OP_NUMBER, strtold(value.c_str(), nullptr), strtold(min.c_str(), nullptr), strtold(max.c_str(), nullptr)));
+                } else {
+                    input.setstate(ios::failbit);
+                }
+                if (!input) {
+                    delete buildChromosome;
+                    throw "Error, bad gene, in ChromosomeFactory::buildFromStream().";
+                }
+            }
+            return buildChromosome;
+        }
+
+        /**
+         * 深度拷贝创建，连同每个基因缓存的计算结果
          *
          * @param Chromosome* existsChromosome
          * @return Chromosome*
          */
         Chromosome* buildFromChromosome(Chromosome* existsChromosome) {
-            Chromosome* result = this->buildEmpty(existsChromosome->getLength());
-            for (unsigned long i = 0; i < result->getLength(); i++) {
-                result->setGene(i, Op::createLike(existsChromosome->getGene(i)));
+            Chromosome* result = this->buildEmpty(existsChromosome->getLength(), existsChromosome->getBeginOfTail(), existsChromosome->getNumberOfGene(), existsChromosome->getLinkingFunction());
+            for (unsigned long i = 0; i < result->getNumberOfGene(); i++) {
+                result->copyGene(existsChromosome, i);
             }
             return result;
         }
 
+    private:
+
+        /** @var EvolutionContext* 创建的染色体所属的环境 */
+        EvolutionContext* context;
+
+        // 表达式树的节点
+        struct ProgramNode {
+            unsigned long instruction;
+            int arity;
+            unsigned long children[3];
+        };
+
+        // 私有，把以 root 为根的子树编码到第 gene 个基因，root 为 -1 时是连接函数的单位元
+        void encodeGene(Chromosome* chromosome, unsigned long gene, const Expression::Program& program, const std::vector<ProgramNode>& nodes, long root, long double numberOpMin, long double numberOpMax) {
+            unsigned long lengthOfGene = chromosome->getLengthOfGene();
+            unsigned long beginOfTail = chromosome->getBeginOfTail();
+            unsigned long base = gene * lengthOfGene;
+            std::vector<Op*> genes(lengthOfGene, nullptr);
+            if (root < 0) {
+                long double identity = Op::PRO == chromosome->getLinkingFunction() || Op::DES == chromosome->getLinkingFunction() ? 1.0L : 0.0L;
+                genes[0] = new Op(Op::OP_NUMBER, identity, numberOpMin, numberOpMax);
+            } else {
+                // 广度优先的序列
+                std::vector<unsigned long> order(1, (unsigned long)root);
+                unsigned long lastFunction = 0;
+                for (unsigned long k = 0; k < order.size(); k++) {
+                    const ProgramNode& node = nodes[order[k]];
+                    if (node.arity > 0) {
+                        lastFunction = k;
+                    }
+                    for (int child = 0; child < node.arity; child++) {
+                        order.push_back(node.children[child]);
+                    }
+                }
+                // 尾部从序列的 tail 开始，在这之前的放在头部，中间用 END 跳过
+                unsigned long tail = 1 == order.size() ? 1 : lastFunction + 1;
+                if (nodes[order[0]].arity > 0 && tail > beginOfTail) {
+                    throw "Error, expression is too long for the chromosome, in ChromosomeFactory::buildFromProgram().";
+                }
+                unsigned long shift = order.size() > 1 ? beginOfTail - tail : 0;
+                if (order.size() + shift > lengthOfGene) {
+                    throw "Error, expression is too long for the chromosome, in ChromosomeFactory::buildFromProgram().";
+                }
+                if (shift > 0) {
+                    genes[tail] = new Op(Op::OP_OPERATION, Op::END);
+                }
+                for (unsigned long k = 0; k < order.size(); k++) {
+                    const Expression::Instruction& instruction = program.getInstructions()[nodes[order[k]].instruction];
+                    unsigned long position = k < tail ? k : k + shift;
+                    if (Op::OP_NUMBER == instruction.code) {
+                        genes[position] = new Op(Op::OP_NUMBER, instruction.value, numberOpMin, numberOpMax);
+                    } else if (Op::OP_VARIABLE == instruction.code) {
+                        genes[position] = new Op(Op::makeVariableOp(instruction.variable, numberOpMin, numberOpMax));
+                    } else {
+                        genes[position] = new Op(Op::OP_OPERATION, instruction.code);
+                    }
+                }
+            }
+            for (unsigned long i = 0; i < lengthOfGene; i++) {
+                if (nullptr == genes[i]) {
+                    genes[i] = new Op(i < beginOfTail ? this->context->makeRandomOptionOp() : this->context->makeRandomTerminalOp(numberOpMin, numberOpMax));
+                }
+                chromosome->setGene(base + i, genes[i]);
+            }
+        }
+
     };
 
 }
@@ -0,0 +1,13 @@
+#include "EvolutionContext.h"
+
+namespace GeneticAlgorithm {
+
+    std::mutex EvolutionContext::seedMutex;
+
+    // 第一次使用时才创建，这时全局引擎一定已经初始化
+    EvolutionContext& EvolutionContext::getDefault() {
+        static EvolutionContext context;
+        return context;
+    }
+
+}
@@ -0,0 +1,187 @@
+#ifndef GENETICALGORITHM_EVOLUTIONCONTEXT_H
+#define GENETICALGORITHM_EVOLUTIONCONTEXT_H
+
+#include "../Op.h"
+#include "../Fitness/Objective.h"
+#include "Utils/GlobalCppRandomEngine.h"
+#include <random>
+#include <mutex>
+
+namespace GeneticAlgorithm {
+
+    /* 一次进化的环境：随机数引擎、适应度函数、尾部可以生成的输入变量和是否保留中间结果
+     *
+     * 每个 MainProcess （以及 SteadyState 、FixedMainProcess ）有自己的一份，染色体记住创建
+     * 它的环境，变异、交叉、插串和计算适应度都使用它。不同的进化可以在不同的线程里同时运行，
+     * 使用不同的适应度函数和数据集，也不会争用同一个随机数引擎。没有指定环境的染色体使用
+     * getDefault() 。
+     *
+     * 环境的地址被染色体引用，不能拷贝。同一个环境的随机数引擎不能被多个线程同时使用。
+     */
+    class EvolutionContext {
+
+    public:
+
+        /**
+         * 创建环境，种子从 GlobalCppRandomEngine::engine 取，设置了全局种子时结果可以重复
+         */
+        EvolutionContext() : engine(nextSeed()) {
+        }
+
+        /**
+         * 创建环境，指定随机数种子
+         *
+         * @param unsigned long seed
+         */
+        explicit EvolutionContext(unsigned long seed) : engine((std::default_random_engine::result_type)seed) {
+        }
+
+        EvolutionContext(const EvolutionContext&) = delete;
+
+        EvolutionContext& operator=(const EvolutionContext&) = delete;
+
+        /**
+         * 获取随机数引擎
+         *
+         * @return std::default_random_engine&
+         */
+        std::default_random_engine& getEngine() {
+            return this->engine;
+        }
+
+        /**
+         * 重新设置随机数种子
+         *
+         * @param unsigned long seed
+         * @return void
+         */
+        void seed(unsigned long seed) {
+            this->engine.seed((std::default_random_engine::result_type)seed);
+        }
+
+        /**
+         * 设置适应度函数，尾部同时会随机生成数据集中的输入变量
+         *
+         * 设置后适应度是整个表达式在数据集上的得分，见 Fitness::Objective 。对象不归环境管理，
+         * 使用期间不能释放。nullptr 时恢复为原来的 1/((100-值)^2+1) ，尾部只有数字。
+         *
+         * @param const Fitness::Objective* objective
+         * @return void
+         */
+        void setObjective(const Fitness::Objective* objective) {
+            this->objective = objective;
+            this->setTerminalVariables(nullptr == objective ? 0 : (int)objective->getDataset().getVariableNumber(), this->terminalVariableRate);
+        }
+
+        /**
+         * 获取适应度函数
+         *
+         * @return const Fitness::Objective*
+         */
+        const Fitness::Objective* getObjective() const {
+            return this->objective;
+        }
+
+        /**
+         * 设置尾部可以生成的输入变量 x0 到 x(number-1) 和生成变量的概率，number 为 0 时尾部只有数字
+         *
+         * @param int number
+         * @param long double rate
+         * @return void
+         */
+        void setTerminalVariables(int number, long double rate = 0.5) {
+            this->terminalVariableNumber = number < 0 ? 0 : number;
+            this->terminalVariableRate = rate;
+        }
+
+        /**
+         * 获取尾部可以生成的输入变量的个数
+         *
+         * @return int
+         */
+        int getTerminalVariableNumber() const {
+            return this->terminalVariableNumber;
+        }
+
+        /**
+         * 设置是否保留每个节点的中间结果，对之后计算的基因生效
+         *
+         * 打开后点变异只重新计算被修改的节点到根节点的路径，修改没有表达出来的位置不需要
+         * 重新计算，代价是每个个体每个基因多保存一份解码后的树。设置了适应度函数时每个节点
+         * 保存数据集每一行的值（ IncrementalEvaluator::evaluateRows() ），受
+         * IncrementalEvaluator::setMemoryBudget() 的预算限制。
+         *
+         * @param bool enable
+         * @return void
+         */
+        void setIncrementalEvaluation(bool enable) {
+            this->incrementalEvaluation = enable;
+        }
+
+        /**
+         * 是否保留中间结果
+         *
+         * @return bool
+         */
+        bool isIncrementalEvaluation() const {
+            return this->incrementalEvaluation;
+        }
+
+        /**
+         * 头部的随机运算符，见 Op::makeRandomOptionOp()
+         *
+         * @return Op
+         */
+        Op makeRandomOptionOp() {
+            return Op::makeRandomOptionOp(this->engine);
+        }
+
+        /**
+         * 尾部的随机终结符，按设置的输入变量生成，见 Op::makeRandomTerminalOp()
+         *
+         * @param long double min
+         * @param long double max
+         * @return Op
+         */
+        Op makeRandomTerminalOp(long double min = 0.0, long double max = 1.0) {
+            return Op::makeRandomTerminalOp(this->engine, this->terminalVariableNumber, this->terminalVariableRate, min, max);
+        }
+
+        /**
+         * 默认的环境，没有适应度函数，给没有指定环境的染色体使用
+         *
+         * @return EvolutionContext&
+         */
+        static EvolutionContext& getDefault();
+
+    private:
+
+        /** @var std::default_random_engine 随机数引擎 */
+        std::default_random_engine engine;
+
+        /** @var const Fitness::Objective* 适应度函数，nullptr 时适应度是 1/((100-值)^2+1) */
+        const Fitness::Objective* objective = nullptr;
+
+        /** @var int 尾部随机生成时可以选的输入变量个数 */
+        int terminalVariableNumber = 0;
+
+        /** @var long double 尾部随机生成输入变量的概率 */
+        long double terminalVariableRate = 0.5;
+
+        /** @var bool 是否保留中间结果 */
+        bool incrementalEvaluation = false;
+
+        /** @var std::mutex 保护从全局引擎取种子，多个线程可以同时创建环境 */
+        static std::mutex seedMutex;
+
+        // 私有，从全局引擎取一个种子
+        static std::default_random_engine::result_type nextSeed() {
+            std::lock_guard<std::mutex> lock(seedMutex);
+            return Utils::GlobalCppRandomEngine::engine();
+        }
+
+    };
+
+}
+
+#endif
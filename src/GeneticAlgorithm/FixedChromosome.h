@@ -0,0 +1,291 @@
+#ifndef GENETICALGORITHM_FIXEDCHROMOSOME_H
+#define GENETICALGORITHM_FIXEDCHROMOSOME_H
+
+#include "../Op.h"
+#include "../FunctionRegistry.h"
+#include "../Expression/Program.h"
+#include "Chromosome.h"
+#include "EvolutionContext.h"
+#include <random>
+
+namespace GeneticAlgorithm {
+
+    /* 编译期确定长度的单基因染色体
+     *
+     * 长度 N 和头部长度 H 是模板参数，基因直接存放在对象里，没有另外的堆内存，可以按值
+     * 连续地放在数组里（见 FixedPopulation ）。解码、交叉、变异的循环次数都是编译期常数，
+     * 编译器可以展开，计算适应度时只用栈上的定长数组。
+     *
+     * 交叉、变异、随机初始化的规则和随机数的使用顺序与单基因的 Chromosome 完全相同，同样的
+     * 种子得到同样的结果。多基因、插串等功能仍然使用运行时长度的 Chromosome 。
+     *
+     * H 默认按二元函数计算，启用了更多参数的函数时要指定更小的 H ，否则构造时抛出异常。
+     */
+    template<unsigned long N, unsigned long H = (N - 1) / 2>
+    class FixedChromosome {
+
+        static_assert(N >= 8, "FixedChromosome: N must >= 8");
+        static_assert(H >= 2 && H < N, "FixedChromosome: H out of range");
+
+    private:
+
+        /** @var Op[N] 基因 */
+        Op genes[N];
+
+        /** @var bool 适应度是否已经算好 */
+        bool isFitnessCached = false;
+
+        /** @var long double 缓存的适应度 */
+        long double fitnessCached = 0.0L;
+
+        /** @var EvolutionContext* 进化的环境，nullptr 时使用 EvolutionContext::getDefault() */
+        EvolutionContext* context = nullptr;
+
+    public:
+
+        /**
+         * 创建染色体，所有位置是数字 0 ，检查尾部对启用的函数是否足够长
+         */
+        FixedChromosome() {
+            if (H * (FunctionRegistry::getMaxArity() - 1) + 1 > N - H) {
+                throw "Error, tail is too short for the enabled functions, in FixedChromosome.";
+            }
+        }
+
+        /**
+         * 随机初始化，和 ChromosomeFactory::buildRandomChromosome() 相同，之后属于 context
+         *
+         * @param EvolutionContext& context 进化的环境
+         * @param long double min 尾部数字的最小值
+         * @param long double max 尾部数字的最大值
+         * @return void
+         */
+        void randomize(EvolutionContext& context, long double min, long double max) {
+            this->context = &context;
+            for (unsigned long i = 0; i < H; i++) {
+                this->genes[i] = context.makeRandomOptionOp();
+            }
+            for (unsigned long i = H; i < N; i++) {
+                this->genes[i] = context.makeRandomTerminalOp(min, max);
+            }
+            this->isFitnessCached = false;
+        }
+
+        /**
+         * 设置给定位置的基因
+         *
+         * @param unsigned long offset
+         * @param const Op& value
+         * @return void
+         */
+        void setGene(unsigned long offset, const Op& value) {
+            if (offset >= N) {
+                throw "Error, out of range, in FixedChromosome::setGene().";
+            }
+            this->genes[offset] = value;
+            this->isFitnessCached = false;
+        }
+
+        /**
+         * 获取给定位置的基因
+         *
+         * @param unsigned long offset
+         * @return Op
+         */
+        Op getGene(unsigned long offset) const {
+            if (offset >= N) {
+                throw "Error, out of range, in FixedChromosome::getGene().";
+            }
+            return this->genes[offset];
+        }
+
+        /**
+         * 获取染色体长度
+         *
+         * @return unsigned long
+         */
+        static unsigned long getLength() {
+            return N;
+        }
+
+        /**
+         * 获取尾部开始的位置，也就是头部的长度
+         *
+         * @return unsigned long
+         */
+        static unsigned long getBeginOfTail() {
+            return H;
+        }
+
+        /**
+         * 与另一个染色体交叉，结果写到 child 中，不分配内存
+         *
+         * 和 Chromosome::crossover() 一样：头部单点交叉，尾部来自这一方，两边都是数字的位置取平均。
+         *
+         * @param const FixedChromosome& another
+         * @param FixedChromosome& child 不能是 this 或者 another
+         * @return void
+         */
+        void crossover(const FixedChromosome& another, FixedChromosome& child) const {
+            EvolutionContext& context = this->getContext();
+            std::uniform_int_distribution<unsigned long> crossoverSplitDistribution(1, H - 1);
+            unsigned long offset = crossoverSplitDistribution(context.getEngine());
+            for (unsigned long i = 0; i < offset; i++) {
+                child.genes[i] = this->genes[i];
+            }
+            for (unsigned long i = offset; i < H; i++) {
+                child.genes[i] = another.genes[i];
+            }
+            for (unsigned long i = H; i < N; i++) {
+                Op gene = this->genes[i];
+                Op other = another.genes[i];
+                // 输入变量不能取平均，直接保留这一方的基因
+                if (Op::OP_NUMBER == gene.getOpType() && Op::OP_NUMBER == other.getOpType()) {
+                    child.genes[i] = Op(Op::OP_NUMBER, (gene.getValue() + other.getValue()) / 2.0, gene.getMin(), gene.getMax());
+                } else {
+                    child.genes[i] = gene;
+                }
+            }
+            child.isFitnessCached = false;
+            child.context = this->context;
+        }
+
+        /**
+         * 以一定的概率r变异，和 Chromosome::mutation() 一样按几何分布跳到下一个变异的位置
+         *
+         * @param long double r
+         * @return void
+         */
+        void mutation(long double r) {
+            EvolutionContext& context = this->getContext();
+            if (r <= 0.0) {
+                return;
+            }
+            std::geometric_distribution<unsigned long> skip(r < 1.0 ? (double)r : 1.0);
+            for (unsigned long i = skip(context.getEngine()); i < N; i += 1 + skip(context.getEngine())) {
+                this->isFitnessCached = false;
+                if (i < H) {
+                    this->genes[i] = context.makeRandomOptionOp();
+                } else {
+                    this->genes[i] = context.makeRandomTerminalOp(this->genes[i].getMin(), this->genes[i].getMax());
+                }
+            }
+        }
+
+        /**
+         * 计算表达式的值，不构造树也不分配内存
+         *
+         * 广度优先地解码，每个节点的子节点在顺序中是连续的，再从后往前计算，子节点总在父节点
+         * 后面。结果和 Chromosome::getValue() 相同。
+         *
+         * @return long double
+         */
+        long double getValue() {
+            // 表达出来的节点对应的位置，和每个节点第一个子节点在 node 中的序号
+            unsigned long node[N];
+            unsigned long firstChild[N];
+            long double value[N];
+            Op* genes = this->genes;
+            if (Op::OP_OPERATION == genes[0].getOpType() && Op::END == genes[0].getTypeValue()) {
+                return 0.0L;
+            }
+            unsigned long size = 1, offset = 1;
+            node[0] = 0;
+            for (unsigned long k = 0; k < size; k++) {
+                firstChild[k] = size;
+                if (Op::OP_OPERATION != genes[node[k]].getOpType()) {
+                    continue;
+                }
+                int arity = FunctionRegistry::getArity(genes[node[k]].getTypeValue());
+                for (int child = 0; child < arity; child++) {
+                    if (offset >= N) {
+                        throw "Error, out of size, in FixedChromosome::getValue().";
+                    }
+                    if (Op::OP_OPERATION == genes[offset].getOpType() && Op::END == genes[offset].getTypeValue()) {
+                        offset = H;
+                    }
+                    node[size++] = offset++;
+                }
+            }
+            for (unsigned long k = size; k-- > 0;) {
+                Op& op = genes[node[k]];
+                if (Op::OP_NUMBER == op.getOpType()) {
+                    value[k] = op.getValue();
+                } else if (Op::OP_VARIABLE == op.getOpType()) {
+                    value[k] = 0.0L;
+                } else {
+                    value[k] = FunctionRegistry::apply<long double>(op.getTypeValue(), value + firstChild[k]);
+                }
+            }
+            return value[0];
+        }
+
+        /**
+         * 解码成后缀表达式形式的程序
+         *
+         * @return Expression::Program
+         */
+        Expression::Program compile() {
+            Op* pointers[N];
+            for (unsigned long i = 0; i < N; i++) {
+                pointers[i] = this->genes + i;
+            }
+            return Expression::Program::decode(pointers, N, H);
+        }
+
+        /**
+         * 获取适应度，环境设置了适应度函数时使用它
+         *
+         * @return long double
+         */
+        long double getFitness() {
+            if (this->isFitnessCached) {
+                return this->fitnessCached;
+            }
+            const Fitness::Objective* objective = this->getContext().getObjective();
+            if (nullptr != objective) {
+                this->fitnessCached = objective->evaluate(this->compile());
+            } else {
+                long double different = 100.0L - this->getValue();
+                this->fitnessCached = 1.0L / (different * different + 1.0L);
+            }
+            this->isFitnessCached = true;
+            return this->fitnessCached;
+        }
+
+        /**
+         * 转换成运行时长度的染色体，用于保存、导出等
+         *
+         * @return Chromosome* 需要手动释放内存
+         */
+        Chromosome* toChromosome() const {
+            Chromosome* chromosome = new Chromosome(N, H, 1, Op::ADD, this->context);
+            for (unsigned long i = 0; i < N; i++) {
+                chromosome->setGene(i, new Op(this->genes[i]));
+            }
+            return chromosome;
+        }
+
+        /**
+         * 打印调试信息，格式和 Chromosome::dump() 相同
+         *
+         * @return void
+         */
+        void dump() const {
+            Chromosome* chromosome = this->toChromosome();
+            chromosome->dump();
+            delete chromosome;
+        }
+
+    private:
+
+        // 私有，进化的环境
+        EvolutionContext& getContext() const {
+            return nullptr == this->context ? EvolutionContext::getDefault() : *this->context;
+        }
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,223 @@
+#ifndef GENETICALGORITHM_FIXEDMAINPROCESS_H
+#define GENETICALGORITHM_FIXEDMAINPROCESS_H
+
+#include "FixedPopulation.h"
+#include "EvolutionContext.h"
+#include <random>
+#include <iostream>
+#include <vector>
+
+namespace GeneticAlgorithm {
+
+    /**
+     * 定长染色体的算法主流程
+     *
+     * 和 MainProcess 的选择、交叉、变异、替换相同，保留多个个体（keep > 1）时同样的种子
+     * 得到同样的结果。新个体写在预先分配的连续数组里，替换时按值覆盖，每一代没有内存分配。
+     * 长度不是编译期常数，或者需要多基因、插串、停滞检测、多目标等功能时使用 MainProcess 。
+     */
+    template<unsigned long N, unsigned long H = (N - 1) / 2>
+    class FixedMainProcess {
+
+    public:
+
+        typedef FixedChromosome<N, H> Individual;
+
+        // 构造方法
+        FixedMainProcess() {
+        }
+
+        // 销毁对象时用于释放内存
+        ~FixedMainProcess() {
+            delete this->population;
+        }
+
+        FixedMainProcess(const FixedMainProcess&) = delete;
+
+        FixedMainProcess& operator=(const FixedMainProcess&) = delete;
+
+        // 主流程运行，染色体长度是模板参数 N
+        void run(
+            unsigned long numberOfChromosome,
+            long double min,
+            long double max,
+            unsigned long maxLoop,
+            long double stopFitness,
+            unsigned long keep,
+            long double r
+        ) {
+            using namespace std;
+            delete this->population;
+            this->numberOfChromosome = numberOfChromosome;
+            this->keep = keep;
+            this->kill = numberOfChromosome - keep;
+            this->r = r;
+            this->population = new FixedPopulation<N, H>(numberOfChromosome);
+            this->population->randomize(this->context, min, max);
+            this->selectedChromosome.resize(2 * this->kill);
+            this->newChromosome.resize(this->kill);
+            this->loopNow = 0;
+            this->sort();
+            this->maxFitness = this->getMaxFitnessChromosome().getFitness();
+            if (this->debug) {
+                cout << "代数=0, 最大适应度=" << this->maxFitness << ", 个体信息：";
+                this->getMaxFitnessChromosome().dump();
+            }
+            while (this->loopNow < maxLoop && this->maxFitness < stopFitness) {
+                this->generation();
+            }
+            if (this->debug) {
+                cout << "结束。" << endl;
+            }
+        }
+
+        // 继续运行
+        void runContinue(
+            unsigned long maxLoop, // 这一次的最大迭代次数
+            long double stopFitness, // 达到多大的适应度就立刻停止迭代
+            unsigned long keep, // 每次迭代保留多少个上一代的个体
+            long double r // 基因突变的概率
+        ) {
+            using namespace std;
+            if (nullptr == this->population) {
+                return;
+            }
+            if (1 == this->keep && keep > 1) { // 之前是keep=1的话，会因为优化而不会排序
+                this->keep = keep;
+                this->sort();
+            }
+            this->keep = keep;
+            this->kill = this->numberOfChromosome - keep;
+            this->selectedChromosome.resize(2 * this->kill);
+            this->newChromosome.resize(this->kill);
+            this->r = r;
+            unsigned long i = 0;
+            this->maxFitness = this->getMaxFitnessChromosome().getFitness();
+            while (i < maxLoop && this->maxFitness < stopFitness) {
+                this->generation();
+                i++;
+            }
+            if (this->debug) {
+                cout << "结束。" << endl;
+            }
+        }
+
+        // 设置debug模式，为true的时候打印调试信息
+        void setDebug(bool enableDebug) {
+            this->debug = enableDebug;
+        }
+
+        // 设置适应度函数，见 MainProcess::setObjective() ，对象使用期间不能释放
+        void setObjective(const Fitness::Objective* objective) {
+            this->context.setObjective(objective);
+        }
+
+        // 设置随机数种子，默认的种子在创建时从 GlobalCppRandomEngine 取
+        void seed(unsigned long seed) {
+            this->context.seed(seed);
+        }
+
+        // 获取迭代次数。如果在一开始初始化的那代种群就达到停止的条件，那么返回0
+        unsigned long getLoopNumber() {
+            return this->loopNow;
+        }
+
+        // 获取最大的适应度
+        long double getMaxFitness() {
+            return this->maxFitness;
+        }
+
+        // 获取Fitness最大值的个体，属于种群，下一次进化后内容会改变
+        Individual& getMaxFitnessChromosome() {
+            if (nullptr == this->population) {
+                throw "Error, run() first, in FixedMainProcess::getMaxFitnessChromosome().";
+            }
+            return this->population->getChromosome(1 == this->keep ? this->population->getMaxFitnessOffset() : 0);
+        }
+
+    private:
+        // 染色体or个体的数量
+        unsigned long numberOfChromosome = 0;
+        // 每次迭代从上一代保留多少个个体
+        unsigned long keep = 0;
+        // 每次迭代替换多少个个体
+        unsigned long kill = 0;
+        // 运行过程中保留当前迭代属于第几次迭代
+        unsigned long loopNow = 0;
+        // 保留每次迭代算出来的最大适应度
+        long double maxFitness = 0.0;
+        // 变异概率
+        long double r = 0.0;
+        // 是否开启调试
+        bool debug = false;
+        // 种群
+        FixedPopulation<N, H>* population = nullptr;
+        // 迭代时选中的个体，指向种群中的个体
+        std::vector<Individual*> selectedChromosome;
+        // 迭代时新生成的个体，按值连续存放
+        std::vector<Individual> newChromosome;
+        // 自己的随机数引擎和适应度函数，种群中的个体都属于它
+        EvolutionContext context;
+
+        // 私有，对种群中个体按照适应度大小排序
+        void sort() {
+            if (1 != this->keep) { // 为了优化流程，只保留一个的时候不必排序
+                this->population->sort();
+            }
+        }
+
+        // 私有，进化一代
+        void generation() {
+            using namespace std;
+            this->select();
+            for (unsigned long i = 0; i < this->kill; i++) {
+                this->selectedChromosome[2 * i]->crossover(*this->selectedChromosome[1 + 2 * i], this->newChromosome[i]);
+            }
+            if (0 < this->r) {
+                for (unsigned long i = 0; i < this->kill; i++) {
+                    this->newChromosome[i].mutation(this->r);
+                }
+            }
+            this->generated();
+            this->sort();
+            this->maxFitness = this->getMaxFitnessChromosome().getFitness();
+            this->loopNow++;
+            if (this->debug) {
+                cout << "代数=" << this->loopNow << ", 最大适应度=" << this->maxFitness << ", 个体信息：";
+                this->getMaxFitnessChromosome().dump();
+            }
+        }
+
+        // 私有，两两比较的锦标赛选择
+        void select() {
+            std::default_random_engine& engine = this->context.getEngine();
+            std::uniform_int_distribution<unsigned long> range(0, this->numberOfChromosome - 1);
+            for (unsigned long i = 0; i < 2 * this->kill; i++) {
+                Individual* selectChromosome1 = &this->population->getChromosome(range(engine));
+                Individual* selectChromosome2 = &this->population->getChromosome(range(engine));
+                this->selectedChromosome[i] = selectChromosome1->getFitness() > selectChromosome2->getFitness() ? selectChromosome1 : selectChromosome2;
+            }
+        }
+
+        // 私有，新个体覆盖上一代中不需要保留的个体
+        void generated() {
+            if (1 != this->keep) {
+                for (unsigned long i = this->keep; i < this->numberOfChromosome; i++) {
+                    this->population->replaceChromosome(i, this->newChromosome[i - this->keep]);
+                }
+                return;
+            }
+            unsigned long best = this->population->getMaxFitnessOffset();
+            unsigned long next = 0;
+            for (unsigned long i = 0; i < this->numberOfChromosome; i++) {
+                if (i != best) {
+                    this->population->replaceChromosome(i, this->newChromosome[next++]);
+                }
+            }
+        }
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef GENETICALGORITHM_FIXEDPOPULATION_H
+#define GENETICALGORITHM_FIXEDPOPULATION_H
+
+#include "FixedChromosome.h"
+#include <vector>
+#include <algorithm>
+
+namespace GeneticAlgorithm {
+
+    /* 定长染色体的种群
+     *
+     * 所有个体按值放在一块连续的内存里。排序只排一个下标数组，getChromosome(i) 是排名第 i
+     * 的个体，替换个体时直接覆盖它所在的位置，进化过程中不再分配内存。
+     */
+    template<unsigned long N, unsigned long H = (N - 1) / 2>
+    class FixedPopulation {
+
+    public:
+
+        typedef FixedChromosome<N, H> Individual;
+
+        // 创建种群，所有个体是空的染色体
+        FixedPopulation(unsigned long numberOfChromosome) : chromosomes(numberOfChromosome), order(numberOfChromosome) {
+            for (unsigned long i = 0; i < numberOfChromosome; i++) {
+                this->order[i] = i;
+            }
+        }
+
+        // 随机初始化所有个体，和 PopulationFactory::buildRandomPopulation() 的顺序相同，个体属于 context
+        void randomize(EvolutionContext& context, long double min, long double max) {
+            for (auto& chromosome : this->chromosomes) {
+                chromosome.randomize(context, min, max);
+            }
+        }
+
+        // 获取排名第 offset 的个体
+        Individual& getChromosome(unsigned long offset) {
+            if (offset >= this->order.size()) {
+                throw "Error, offset out of range, in \"FixedPopulation::getChromosome\".";
+            }
+            return this->chromosomes[this->order[offset]];
+        }
+
+        // 用 chromosome 覆盖排名第 offset 的个体
+        void replaceChromosome(unsigned long offset, const Individual& chromosome) {
+            this->getChromosome(offset) = chromosome;
+        }
+
+        // 获取种群的个体数量
+        unsigned long getSize() {
+            return this->order.size();
+        }
+
+        // 获取适应度最大的个体的排名，相同时取排名靠前的
+        unsigned long getMaxFitnessOffset() {
+            unsigned long offset = 0;
+            long double maxFitness = this->getChromosome(0).getFitness();
+            for (unsigned long i = 1; i < this->order.size(); i++) {
+                if (this->getChromosome(i).getFitness() > maxFitness) {
+                    offset = i;
+                    maxFitness = this->getChromosome(i).getFitness();
+                }
+            }
+            return offset;
+        }
+
+        // 按照适应度从大到小排序
+        void sort() {
+            std::vector<Individual>& chromosomes = this->chromosomes;
+            std::sort(this->order.begin(), this->order.end(), [&chromosomes](unsigned long a, unsigned long b) -> bool {
+                return chromosomes[a].getFitness() > chromosomes[b].getFitness();
+            });
+        }
+
+    private:
+        // 所有个体
+        std::vector<Individual> chromosomes;
+        // 排名对应的个体在 chromosomes 中的位置
+        std::vector<unsigned long> order;
+    };
+
+}
+
+#endif
@@ -3,10 +3,18 @@
 
 #include "Population.h"
 #include "PopulationFactory.h"
-#include "Utils/GlobalCppRandomEngine.h"
+#include "Utils/Trace.h"
 #include "Chromosome.h"
+#include "EvolutionContext.h"
+#include "ParameterControl.h"
+#include "../Expression/ExpressionStore.h"
+#include "../Expression/IncrementalEvaluator.h"
+#include "../Fitness/Racing.h"
 #include <random>
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#include <thread>
 
 namespace GeneticAlgorithm {
 
@@ -42,6 +50,64 @@ namespace GeneticAlgorithm {
         Population* population = nullptr;
         // 是否开启调试
         bool debug = false;
+        // 每个染色体的基因个数
+        unsigned long numberOfGene = 1;
+        // 连接各个基因的二元函数
+        int linkingFunction = Op::ADD;
+        // IS 插串的概率
+        long double insertionSequenceRate = 0.0;
+        // RIS 插串的概率
+        long double rootInsertionSequenceRate = 0.0;
+        // 基因转座的概率
+        long double geneTranspositionRate = 0.0;
+        // 用基因重组代替交叉的概率
+        long double geneRecombinationRate = 0.0;
+        // 是否用共用子表达式的方式计算新个体
+        bool sharedEvaluation = false;
+        // 共用子表达式的存储，每一代重新建立
+        Expression::ExpressionStore store;
+        // 是否用竞赛式计算新个体的适应度
+        bool racing = false;
+        // 竞赛式计算，保留随机子集和统计
+        Fitness::RacingEvaluator racingEvaluator;
+        // 有数据集时整代一起分块计算的线程数，0 表示每个个体自己计算
+        unsigned long blockedThreads = 0;
+        // 最大适应度连续多少代没有提高就认为停滞，0 表示不按代数检测
+        unsigned long stagnationGenerations = 0;
+        // 不同个体占种群的比例低于这个值也认为停滞，0 表示不按多样性检测
+        long double minDistinctRatio = 0.0;
+        // 停滞时重新随机初始化的个体比例
+        long double reinitializeRatio = 0.0;
+        // 停滞时超变异的概率
+        long double hypermutationRate = 0.0;
+        // 超变异持续的代数
+        unsigned long hypermutationGenerations = 0;
+        // 最大适应度已经连续多少代没有提高
+        unsigned long stagnantGenerations = 0;
+        // 上一次提高时的最大适应度
+        long double lastMaxFitness = 0.0;
+        // 超变异还剩多少代
+        unsigned long hypermutationLeft = 0;
+        // 停滞后重启的次数
+        unsigned long restartNumber = 0;
+        // 最近一代不同个体的数量
+        unsigned long distinctNumber = 0;
+        // 最近一代适应度的熵
+        long double fitnessEntropy = 0.0;
+        // 是否按误差和表达式大小两个目标进化
+        bool multiObjective = false;
+        // 初始种群的种子
+        std::vector<Expression::Program> seeds;
+        // 初始种群中种子的变异副本的比例
+        long double seedMutatedRatio = 0.5;
+        // 变异概率和 keep 的自适应控制
+        ParameterControl parameterControl;
+        // 打开 1/5 成功法则时，每个新个体的两个父代中较好的适应度
+        std::vector<long double> parentFitness;
+        // 最近一代比父代好的新个体数量
+        unsigned long successNumber = 0;
+        // 自己的随机数引擎和适应度函数，种群中的个体都属于它
+        EvolutionContext context;
 
     public:
         // 构造方法
@@ -74,8 +140,15 @@ namespace GeneticAlgorithm {
             this->kill = numberOfChromosome - keep;
             this->r = r;
             this->init();
+            this->evaluate(this->population);
             this->sort();
             this->maxFitness = this->population->getMaxFitnessChromosome()->getFitness();
+            this->lastMaxFitness = this->maxFitness;
+            this->stagnantGenerations = 0;
+            this->hypermutationLeft = 0;
+            this->restartNumber = 0;
+            ParameterSetting setting = {keep, r};
+            this->applySetting(this->parameterControl.begin(setting, this->maxFitness));
 
             if (this->debug) {
                 cout << "代数=0, 最大适应度=" << this->maxFitness << ", 个体信息：";
@@ -83,17 +156,7 @@ namespace GeneticAlgorithm {
             }
 
             while (this->loopNow < maxLoop && this->maxFitness < stopFitness) {
-                this->select();
-                this->crossover();
-                this->mutation();
-                this->generated();
-                this->sort();
-                this->maxFitness = this->population->getMaxFitnessChromosome()->getFitness();
-                this->loopNow++;
-                if (this->debug) {
-                    cout << "代数=" << this->loopNow << ", 最大适应度=" << this->maxFitness << ", 个体信息：";
-                    this->population->getMaxFitnessChromosome()->dump();
-                }
+                this->generation();
             }
             if (this->debug) {
                 cout << "结束。" << endl;
@@ -111,36 +174,17 @@ namespace GeneticAlgorithm {
             if (nullptr == this->population || nullptr == this->selectedChromosome || nullptr == this->newChromosome) {
                 return;
             }
-            if (this->keep != keep) { // 之前是keep=1的话，会因为优化而不会排序
-                if (1 == this->keep && keep > 1) { // 之前是keep=1的话，会因为优化而不会排序
-                    this->keep = keep;
-                    this->kill = this->numberOfChromosome - keep;
-                    this->sort(); // 先排序避免后满淘汰掉较优解
-                } else {
-                    this->keep = keep;
-                    this->kill = this->numberOfChromosome - keep;
+            // 自适应控制时 keep 和 r 由 ParameterControl 决定，1/5 成功法则时沿用调整后的 r
+            if (!this->parameterControl.hasArms()) {
+                this->setKeep(keep);
+                if (!this->parameterControl.isOneFifthRule()) {
+                    this->r = r;
                 }
-                // 尺寸发生变化，删除旧的再申请新空间
-                delete[] this->selectedChromosome;
-                delete[] this->newChromosome;
-                this->selectedChromosome = new Chromosome*[2 * this->kill];
-                this->newChromosome = new Chromosome*[this->kill];
             }
-            this->r = r;
             unsigned long i = 0;
             this->maxFitness = this->population->getMaxFitnessChromosome()->getFitness();
             while (i < maxLoop && this->maxFitness < stopFitness) {
-                this->select();
-                this->crossover();
-                this->mutation();
-                this->generated();
-                this->sort();
-                this->maxFitness = this->population->getMaxFitnessChromosome()->getFitness();
-                this->loopNow++;
-                if (this->debug) {
-                    cout << "代数=" << this->loopNow << ", 最大适应度=" << this->maxFitness << ", 个体信息：";
-                    this->population->getMaxFitnessChromosome()->dump();
-                }
+                this->generation();
                 i++;
             }
             if (this->debug) {
@@ -153,6 +197,159 @@ namespace GeneticAlgorithm {
             this->debug = enableDebug;
         }
 
+        // 设置多基因染色体，染色体长度必须是基因个数的倍数，下一次 run() 生效
+        void setGeneNumber(unsigned long numberOfGene, int linkingFunction = Op::ADD) {
+            this->numberOfGene = numberOfGene;
+            this->linkingFunction = linkingFunction;
+        }
+
+        // 设置每个新个体做 IS 插串、RIS 插串、基因转座的概率，默认都是 0
+        void setTranspositionRate(long double insertionSequenceRate, long double rootInsertionSequenceRate, long double geneTranspositionRate) {
+            this->insertionSequenceRate = insertionSequenceRate;
+            this->rootInsertionSequenceRate = rootInsertionSequenceRate;
+            this->geneTranspositionRate = geneTranspositionRate;
+        }
+
+        // 设置用基因重组代替交叉的概率，默认是 0
+        void setGeneRecombinationRate(long double geneRecombinationRate) {
+            this->geneRecombinationRate = geneRecombinationRate;
+        }
+
+        // 设置是否让每一代的新个体共用相同的子表达式，每个不同的子表达式只计算一次。有数据集时
+        // 按块在数据集上计算，见 Fitness::scoreStore() 。同时打开竞赛式或者分块计算时以它们为准
+        void setSharedEvaluation(bool enable) {
+            this->sharedEvaluation = enable;
+        }
+
+        // 设置竞赛式计算：有数据集时新个体先在 sampleRows 行的随机子集上计算，比第 keep 个精英差的
+        // 不再完整计算，完整计算中确定比它差时提前结束，见 Fitness::RacingEvaluator 。多目标时不使用
+        void setRacing(bool enable, unsigned long sampleRows = 256) {
+            this->racing = enable;
+            this->racingEvaluator.setSampleRows(sampleRows);
+        }
+
+        // 设置有数据集时一代的新个体一起分块计算，数据集每块只从内存读一次，见 Fitness::BlockedEvaluation 。
+        // threadNumber 为 0 时使用硬件线程数。同时打开竞赛式计算时以竞赛式为准
+        void setBlockedEvaluation(bool enable, unsigned long threadNumber = 1) {
+            this->blockedThreads = enable ? (0 == threadNumber ? std::thread::hardware_concurrency() : threadNumber) : 0;
+        }
+
+        // 设置每个基因保留每个节点的中间结果，见 EvolutionContext::setIncrementalEvaluation() 。有数据集时
+        // 每个节点保存数据集每一行的值，进程中所有的节点共用 memoryBudget 字节的预算。
+        // 同时打开竞赛式、分块或者共用子表达式的计算时以它们为准
+        void setIncrementalEvaluation(bool enable, unsigned long memoryBudget = 256UL << 20) {
+            this->context.setIncrementalEvaluation(enable);
+            Expression::IncrementalEvaluator::setMemoryBudget(memoryBudget);
+        }
+
+        // 获取竞赛式计算的统计，包括节省的行数
+        Fitness::RacingStatistics getRacingStatistics() {
+            return this->racingEvaluator.getStatistics();
+        }
+
+        // 设置适应度函数，尾部同时会随机生成数据集中的输入变量，nullptr 时恢复默认。只影响这个
+        // 对象，见 EvolutionContext::setObjective() ，对象使用期间不能释放
+        void setObjective(const Fitness::Objective* objective) {
+            this->context.setObjective(objective);
+        }
+
+        // 设置随机数种子，默认的种子在创建时从 GlobalCppRandomEngine 取
+        void seed(unsigned long seed) {
+            this->context.seed(seed);
+        }
+
+        // 获取进化的环境
+        EvolutionContext& getContext() {
+            return this->context;
+        }
+
+        // 设置初始种群的种子，例如之前保存的最优个体或者 Expression::Parser 解析的表达式，
+        // 见 PopulationFactory::buildSeededPopulation()，对之后的 run() 生效，空的时候随机初始化
+        void setSeeds(const std::vector<Expression::Program>& seeds, long double mutatedRatio = 0.5) {
+            this->seeds = seeds;
+            this->seedMutatedRatio = mutatedRatio;
+        }
+
+        // 设置多目标模式：误差和表达出来的节点个数两个目标，用非支配排序和拥挤距离代替保留
+        // 适应度最高的 keep 个个体。每代产生 numberOfChromosome - keep 个新个体，和种群合并后
+        // 保留 numberOfChromosome 个，锦标赛选择也按拥挤比较
+        void setMultiObjective(bool enable) {
+            this->multiObjective = enable;
+        }
+
+        // 设置用 1/5 成功法则调整变异概率，run() 的 r 是初始值，之后 runContinue() 的 r 不再使用
+        void setAdaptiveMutation(bool enable, long double minRate = 0.001L, long double maxRate = 0.5L) {
+            this->parameterControl.setOneFifthRule(enable, minRate, maxRate);
+        }
+
+        // 设置几组候选的 (keep, r) ，每 epoch 代按最大适应度的进展选一组，见 ParameterControl 。
+        // 设置后 run() 和 runContinue() 的 keep 、r 不再使用，每组的 keep 必须小于种群大小
+        void setParameterArms(const std::vector<ParameterSetting>& settings, unsigned long epoch = 10) {
+            this->parameterControl.setArms(settings, epoch);
+        }
+
+        // 获取每组参数的使用次数和进展，没有候选参数时只有 run() 使用的一组
+        std::vector<ParameterStatistics> getParameterStatistics() {
+            return this->parameterControl.getStatistics(this->maxFitness);
+        }
+
+        // 获取当前的变异概率
+        long double getMutationRate() {
+            return this->r;
+        }
+
+        // 获取当前每次迭代保留的个体数量
+        unsigned long getKeep() {
+            return this->keep;
+        }
+
+        // 获取当前的帕累托前沿，按误差从小到大排列，个体属于种群，不要释放
+        std::vector<Chromosome*> getParetoFront() {
+            std::vector<Chromosome*> front;
+            if (nullptr == this->population || !this->multiObjective) {
+                return front;
+            }
+            for (unsigned long i = 0; i < this->population->getFrontSize(); i++) {
+                front.push_back(this->population->getChromosome(i));
+            }
+            std::sort(front.begin(), front.end(), [](Chromosome* a, Chromosome* b) -> bool {
+                return a->getExpressedSize() > b->getExpressedSize();
+            });
+            return front;
+        }
+
+        // 设置停滞检测：最大适应度连续 generations 代没有提高，或者不同个体的比例低于
+        // minDistinctRatio 时，把 reinitializeRatio 比例的个体重新随机初始化，并且在之后的
+        // hypermutationGenerations 代用 hypermutationRate 代替变异概率。都是 0 时不检测
+        void setStagnation(
+            unsigned long generations,
+            long double minDistinctRatio,
+            long double reinitializeRatio,
+            long double hypermutationRate = 0.0,
+            unsigned long hypermutationGenerations = 0
+        ) {
+            this->stagnationGenerations = generations;
+            this->minDistinctRatio = minDistinctRatio;
+            this->reinitializeRatio = reinitializeRatio;
+            this->hypermutationRate = hypermutationRate;
+            this->hypermutationGenerations = hypermutationGenerations;
+        }
+
+        // 获取最近一代表达式不同的个体数量，只有打开停滞检测时才会统计
+        unsigned long getDistinctNumber() {
+            return this->distinctNumber;
+        }
+
+        // 获取最近一代适应度的熵，只有打开停滞检测时才会统计
+        long double getFitnessEntropy() {
+            return this->fitnessEntropy;
+        }
+
+        // 获取停滞后重启的次数
+        unsigned long getRestartNumber() {
+            return this->restartNumber;
+        }
+
         // 获取迭代次数。如果在一开始初始化的那代种群就达到停止的条件，那么返回0
         unsigned long getLoopNumber() {
             return this->loopNow;
@@ -168,8 +365,9 @@ namespace GeneticAlgorithm {
             return this->population->getMaxFitnessChromosome();
         }
 
-        // 替换一个不是最好的个体为指定的个体
+        // 替换一个不是最好的个体为指定的个体，个体换到这个对象的环境
         void replaceChromosome(Chromosome* chromosome) {
+            chromosome->setContext(&this->context);
             Chromosome* maxChromosome = this->population->getMaxFitnessChromosome();
             for (unsigned long offset = this->numberOfChromosome - 1; offset + 2 > 1; offset--) {
                 if ((void*)this->population->getChromosome(offset) != (void*)maxChromosome) {
@@ -183,7 +381,11 @@ namespace GeneticAlgorithm {
 
         // 私有，初始化
         void init() {
-            this->population = PopulationFactory().buildRandomPopulation(this->numberOfChromosome, this->lengthOfChromosome, this->min, this->max);
+            if (this->seeds.empty()) {
+                this->population = PopulationFactory(this->context).buildRandomPopulation(this->numberOfChromosome, this->lengthOfChromosome, this->min, this->max, this->numberOfGene, this->linkingFunction);
+            } else {
+                this->population = PopulationFactory(this->context).buildSeededPopulation(this->seeds, this->numberOfChromosome, this->lengthOfChromosome, this->min, this->max, this->numberOfGene, this->linkingFunction, this->seedMutatedRatio, this->r);
+            }
             this->loopNow = 0;
             this->maxFitness = 0.0;
             this->selectedChromosome = new Chromosome*[2 * this->kill];
@@ -192,24 +394,35 @@ namespace GeneticAlgorithm {
 
         // 私有，对种群中个体按照适应度大小排序
         void sort() {
-            if (1 != this->keep) { // 为了优化流程，只保留一个的时候不必排序
+            if (this->multiObjective) {
+                this->population->selectPareto(nullptr, 0);
+            } else if (1 != this->keep) { // 为了优化流程，只保留一个的时候不必排序
                 this->population->sort();
             }
         }
 
         // 私有，选择个体
         void select() {
-            using namespace GeneticAlgorithm::Utils;
             using namespace std;
+            default_random_engine& engine = this->context.getEngine();
             Chromosome* selectChromosome1;
             Chromosome* selectChromosome2;
             unsigned long generate = 2 * this->kill;
             uniform_int_distribution<unsigned long> range(0, this->numberOfChromosome - 1);
             // 运行 generate 次选择
+            if (this->multiObjective) {
+                // 种群已经按拥挤比较排好，位置靠前的好
+                for (unsigned long i = 0; i < generate; i++) {
+                    unsigned long offset1 = range(engine);
+                    unsigned long offset2 = range(engine);
+                    this->selectedChromosome[i] = this->population->getChromosome(offset1 < offset2 ? offset1 : offset2);
+                }
+                return;
+            }
             for (unsigned long i = 0; i < generate; i++) {
-                selectChromosome1 = this->population->getChromosome(range(GlobalCppRandomEngine::engine));
-                selectChromosome2 = this->population->getChromosome(range(GlobalCppRandomEngine::engine));
-                if (selectChromosome1->getFitness() > selectChromosome2->getFitness()) {
+                selectChromosome1 = this->population->getChromosome(range(engine));
+                selectChromosome2 = this->population->getChromosome(range(engine));
+                if (this->isBetter(selectChromosome1, selectChromosome2)) {
                     this->selectedChromosome[i] = selectChromosome1;
                 } else {
                     this->selectedChromosome[i] = selectChromosome2;
@@ -217,25 +430,311 @@ namespace GeneticAlgorithm {
             }
         }
 
+        // 私有，锦标赛比较。竞赛式计算只有估计值的个体已经确定比精英差，总是输给完整算出适应度的个体，
+        // 两个都是估计值时才比较大小
+        bool isBetter(Chromosome* chromosome1, Chromosome* chromosome2) {
+            bool estimated1 = chromosome1->hasEstimatedFitness();
+            bool estimated2 = chromosome2->hasEstimatedFitness();
+            if (estimated1 != estimated2) {
+                return estimated2;
+            }
+            return chromosome1->getFitness() > chromosome2->getFitness();
+        }
+
         // 私有，交叉运算
         void crossover() {
+            std::default_random_engine& engine = this->context.getEngine();
+            std::uniform_real_distribution<long double> p(0.0, 1.0);
+            if (this->parameterControl.isOneFifthRule()) {
+                this->parentFitness.resize(this->kill);
+                for (unsigned long i = 0; i < this->kill; i++) {
+                    this->parentFitness[i] = std::max(this->selectedChromosome[2 * i]->getFitness(), this->selectedChromosome[1 + 2 * i]->getFitness());
+                }
+            }
             for (unsigned long i = 0; i < this->kill; i++) {
-                this->newChromosome[i] = this->selectedChromosome[2 * i]->crossover(this->selectedChromosome[1 + 2 * i]);
+                // 概率为 0 时不消耗随机数，单基因的结果和以前一样
+                if (this->geneRecombinationRate > 0 && p(engine) < this->geneRecombinationRate) {
+                    this->newChromosome[i] = this->selectedChromosome[2 * i]->geneRecombination(this->selectedChromosome[1 + 2 * i]);
+                } else {
+                    this->newChromosome[i] = this->selectedChromosome[2 * i]->crossover(this->selectedChromosome[1 + 2 * i]);
+                }
             }
         }
 
         // 私有，变异
         void mutation() {
-            if (0 >= this->r) {
+            long double r = this->hypermutationLeft > 0 ? this->hypermutationRate : this->r;
+            if (0 < r) {
+                for (unsigned long i = 0; i < this->kill; i++) {
+                    this->newChromosome[i]->mutation(r);
+                }
+            }
+            this->transposition();
+        }
+
+        // 私有，插串和基因转座，概率为 0 的不消耗随机数
+        void transposition() {
+            std::default_random_engine& engine = this->context.getEngine();
+            std::uniform_real_distribution<long double> p(0.0, 1.0);
+            for (unsigned long i = 0; i < this->kill; i++) {
+                if (this->insertionSequenceRate > 0 && p(engine) < this->insertionSequenceRate) {
+                    this->newChromosome[i]->transposeInsertionSequence();
+                }
+                if (this->rootInsertionSequenceRate > 0 && p(engine) < this->rootInsertionSequenceRate) {
+                    this->newChromosome[i]->transposeRootInsertionSequence();
+                }
+                if (this->geneTranspositionRate > 0 && p(engine) < this->geneTranspositionRate) {
+                    this->newChromosome[i]->transposeGene();
+                }
+            }
+        }
+
+        // 私有，进化一代，开启 Utils::Trace 时记录每个阶段
+        void generation() {
+            using namespace std;
+            using Utils::Trace;
+            Trace::Scope generation("generation", "generation", (long)this->loopNow);
+            {
+                Trace::Scope phase("select", "phase");
+                this->select();
+            }
+            {
+                Trace::Scope phase("crossover", "phase");
+                this->crossover();
+            }
+            {
+                Trace::Scope phase("mutation", "phase");
+                this->mutation();
+            }
+            {
+                Trace::Scope phase("evaluate", "phase");
+                this->evaluate();
+                this->countSuccess();
+            }
+            {
+                Trace::Scope phase("generated", "phase");
+                this->generated();
+                if (!this->multiObjective) { // 多目标时 generated() 已经排好
+                    this->sort();
+                }
+            }
+            this->maxFitness = this->population->getMaxFitnessChromosome()->getFitness();
+            {
+                Trace::Scope phase("stagnation", "phase");
+                this->checkStagnation();
+            }
+            this->adapt();
+            this->loopNow++;
+            if (this->debug) {
+                cout << "代数=" << this->loopNow << ", 最大适应度=" << this->maxFitness << ", 个体信息：";
+                this->population->getMaxFitnessChromosome()->dump();
+            }
+        }
+
+        // 私有，统计比两个父代都好的新个体，新个体在替换进种群之前计算适应度
+        void countSuccess() {
+            if (!this->parameterControl.isOneFifthRule()) {
+                return;
+            }
+            this->successNumber = 0;
+            // 只有估计值的新个体不和父代完整算出的适应度比较，不算成功
+            for (unsigned long i = 0; i < this->kill; i++) {
+                if (!this->newChromosome[i]->hasEstimatedFitness() && this->newChromosome[i]->getFitness() > this->parentFitness[i]) {
+                    this->successNumber++;
+                }
+            }
+        }
+
+        // 私有，一代结束后调整变异概率，周期结束时换一组参数
+        void adapt() {
+            this->r = this->parameterControl.adaptRate(this->r, this->successNumber, this->kill);
+            if (this->parameterControl.next(this->maxFitness)) {
+                this->applySetting(this->parameterControl.getSetting());
+                if (this->debug) {
+                    std::cout << "参数切换，keep=" << this->keep << ", r=" << this->r << std::endl;
+                }
+            }
+        }
+
+        // 私有，使用一组参数
+        void applySetting(const ParameterSetting& setting) {
+            if (this->parameterControl.hasArms() && (setting.keep < 1 || setting.keep >= this->numberOfChromosome)) {
+                throw "Error, keep must be in [1, numberOfChromosome), in MainProcess::applySetting().";
+            }
+            this->setKeep(setting.keep);
+            this->r = setting.r;
+        }
+
+        // 私有，改变每次迭代保留的个体数量
+        void setKeep(unsigned long keep) {
+            if (this->keep == keep) {
+                return;
+            }
+            if (1 == this->keep && keep > 1) { // 之前是keep=1的话，会因为优化而不会排序
+                this->keep = keep;
+                this->kill = this->numberOfChromosome - keep;
+                this->sort(); // 先排序避免后满淘汰掉较优解
+            } else {
+                this->keep = keep;
+                this->kill = this->numberOfChromosome - keep;
+            }
+            // 尺寸发生变化，删除旧的再申请新空间
+            delete[] this->selectedChromosome;
+            delete[] this->newChromosome;
+            this->selectedChromosome = new Chromosome*[2 * this->kill];
+            this->newChromosome = new Chromosome*[this->kill];
+        }
+
+        // 私有，统计多样性，停滞时部分重新初始化或者开始超变异
+        void checkStagnation() {
+            using namespace std;
+            if (0 == this->stagnationGenerations && this->minDistinctRatio <= 0) {
+                return;
+            }
+            this->distinctNumber = this->population->getDistinctNumber();
+            this->fitnessEntropy = this->population->getFitnessEntropy();
+            if (this->maxFitness > this->lastMaxFitness) {
+                this->lastMaxFitness = this->maxFitness;
+                this->stagnantGenerations = 0;
+            } else {
+                this->stagnantGenerations++;
+            }
+            if (this->hypermutationLeft > 0) {
+                this->hypermutationLeft--;
+                return;
+            }
+            bool stagnant = this->stagnationGenerations > 0 && this->stagnantGenerations >= this->stagnationGenerations;
+            bool converged = this->distinctNumber < this->minDistinctRatio * this->numberOfChromosome;
+            if (!stagnant && !converged) {
                 return;
             }
+            this->restartNumber++;
+            this->stagnantGenerations = 0;
+            Utils::Trace::instant("restart", "stagnation", (long)this->loopNow);
+            unsigned long reinitialized = 0;
+            if (this->reinitializeRatio > 0) {
+                reinitialized = PopulationFactory(this->context).reinitialize(
+                    this->population,
+                    (unsigned long)(this->reinitializeRatio * this->numberOfChromosome),
+                    this->lengthOfChromosome,
+                    this->min,
+                    this->max,
+                    this->numberOfGene,
+                    this->linkingFunction
+                );
+                this->evaluate(this->population);
+                this->sort();
+                this->maxFitness = this->population->getMaxFitnessChromosome()->getFitness();
+            }
+            if (this->hypermutationRate > 0) {
+                this->hypermutationLeft = this->hypermutationGenerations;
+            }
+            if (this->debug) {
+                cout << "停滞，不同个体=" << this->distinctNumber << ", 适应度熵=" << this->fitnessEntropy
+                    << ", 重新初始化" << reinitialized << "个, 超变异" << this->hypermutationLeft << "代" << endl;
+            }
+        }
+
+        // 私有，新个体加入共用的存储一起计算适应度，必须在替换进种群之前，替换时会比较适应度
+        void evaluate() {
+            if (this->racing && nullptr != this->context.getObjective() && !this->multiObjective && this->keep > 0) {
+                this->race();
+                return;
+            }
+            if (this->blockedThreads > 0 && nullptr != this->context.getObjective()) {
+                this->evaluateBlocked(std::vector<Chromosome*>(this->newChromosome, this->newChromosome + this->kill));
+                return;
+            }
+            if (!this->sharedEvaluation) {
+                return;
+            }
+            this->evaluateShared(std::vector<Chromosome*>(this->newChromosome, this->newChromosome + this->kill));
+        }
+
+        // 私有，竞赛式计算新个体，阈值是上一代排好序的种群中第 keep 个个体的适应度
+        void race() {
+            const Fitness::Objective* objective = this->context.getObjective();
+            this->racingEvaluator.resample(*objective, this->context.getEngine());
+            Chromosome* elite = 1 == this->keep ? this->population->getMaxFitnessChromosome() : this->population->getChromosome(this->keep - 1);
+            long double threshold = elite->getFitness();
+            bool exact = true;
             for (unsigned long i = 0; i < this->kill; i++) {
-                this->newChromosome[i]->mutation(this->r);
+                if (!this->newChromosome[i]->hasFitness()) {
+                    long double fitness = this->racingEvaluator.evaluate(*objective, this->newChromosome[i]->compile(), threshold, exact);
+                    this->newChromosome[i]->setFitness(fitness, !exact);
+                }
+            }
+        }
+
+        // 私有，整批个体一起在数据集上分块计算，已经有适应度的跳过
+        void evaluateBlocked(const std::vector<Chromosome*>& chromosomes) {
+            std::vector<Chromosome*> pending;
+            std::vector<Expression::Program> programs;
+            for (auto chromosome : chromosomes) {
+                if (!chromosome->hasFitness()) {
+                    pending.push_back(chromosome);
+                    programs.push_back(chromosome->compile());
+                }
+            }
+            std::vector<long double> fitness(programs.size());
+            this->context.getObjective()->evaluateAll(programs, fitness.data(), this->blockedThreads);
+            for (unsigned long i = 0; i < pending.size(); i++) {
+                pending[i]->setFitness(fitness[i]);
+            }
+        }
+
+        // 私有，计算种群中还没有适应度的个体
+        void evaluate(Population* population) {
+            if (this->blockedThreads > 0 && nullptr != this->context.getObjective()) {
+                std::vector<Chromosome*> chromosomes;
+                for (unsigned long i = 0; i < population->getSize(); i++) {
+                    chromosomes.push_back(population->getChromosome(i));
+                }
+                this->evaluateBlocked(chromosomes);
+                return;
+            }
+            if (!this->sharedEvaluation) {
+                return;
+            }
+            std::vector<Chromosome*> pending;
+            for (unsigned long i = 0; i < population->getSize(); i++) {
+                if (!population->getChromosome(i)->hasFitness()) {
+                    pending.push_back(population->getChromosome(i));
+                }
+            }
+            this->evaluateShared(pending);
+        }
+
+        // 私有，一批个体加入共用的存储一起计算。有数据集时按块在数据集上计算，适应度函数不支持时
+        // 不设置适应度，由每个个体自己计算
+        void evaluateShared(const std::vector<Chromosome*>& chromosomes) {
+            std::vector<unsigned long> roots(chromosomes.size());
+            this->store.clear();
+            for (unsigned long i = 0; i < chromosomes.size(); i++) {
+                roots[i] = this->store.add(chromosomes[i]->compile());
+            }
+            const Fitness::Objective* objective = this->context.getObjective();
+            if (nullptr != objective) {
+                std::vector<long double> fitness(chromosomes.size());
+                if (objective->evaluateStore(this->store, roots.data(), roots.size(), fitness.data())) {
+                    for (unsigned long i = 0; i < chromosomes.size(); i++) {
+                        chromosomes[i]->setFitness(fitness[i]);
+                    }
+                }
+                return;
+            }
+            this->store.evaluate();
+            for (unsigned long i = 0; i < chromosomes.size(); i++) {
+                chromosomes[i]->setValue(this->store.getValue(roots[i]));
             }
         }
 
         // 私有，新个体替换上一代中不需要保留的个体
         void generated() {
+            if (this->multiObjective) {
+                this->population->selectPareto(this->newChromosome, this->kill);
+                return;
+            }
             if (1 != this->keep) {
                 for (unsigned long i = this->keep; i < this->numberOfChromosome; i++) {
                     this->population->replaceChromosome(i, this->newChromosome[i - this->keep]);
@@ -0,0 +1,296 @@
+#ifndef GENETICALGORITHM_MULTITARGETPROCESS_H
+#define GENETICALGORITHM_MULTITARGETPROCESS_H
+
+#include "ChromosomeFactory.h"
+#include "Chromosome.h"
+#include "EvolutionContext.h"
+#include "../Fitness/MultiTarget.h"
+#include <random>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+namespace GeneticAlgorithm {
+
+    /**
+     * 多目标值的算法主流程
+     *
+     * 一个种群同时拟合多个目标值。每个新个体只解码、计算一次，Fitness::MultiTargetObjective
+     * 用同一份结果给出对所有目标值的适应度，保存在 numberOfChromosome × targetNumber 的矩阵里。
+     *   选择：每对父代先随机选一个目标值，再按这个目标值的适应度两两比较
+     *   保留：每个目标值适应度最大的 keep 个个体都保留到下一代，相当于每个目标值在种群里
+     *   有一个精英档案，同一个个体可以同时是几个目标值的精英
+     *   替换：其余位置由新个体填充
+     * 所有目标值的最大适应度都达到 stopFitness 时停止。
+     */
+    class MultiTargetProcess {
+
+    public:
+        // 构造方法
+        MultiTargetProcess() {
+        }
+
+        // 销毁对象时用于释放内存
+        ~MultiTargetProcess() {
+            this->freeMemory();
+        }
+
+        MultiTargetProcess(const MultiTargetProcess&) = delete;
+
+        MultiTargetProcess& operator=(const MultiTargetProcess&) = delete;
+
+        // 设置适应度函数，尾部同时会随机生成数据集中的输入变量，对象使用期间不能释放
+        void setObjective(const Fitness::MultiTargetObjective* objective) {
+            this->objective = objective;
+            this->context.setTerminalVariables(nullptr == objective ? 0 : (int)objective->getVariableNumber());
+        }
+
+        // 设置随机数种子，默认的种子在创建时从 GlobalCppRandomEngine 取
+        void seed(unsigned long seed) {
+            this->context.seed(seed);
+        }
+
+        // 主流程运行，keep 是每个目标值保留的精英个数
+        void run(
+            unsigned long numberOfChromosome,
+            unsigned long lengthOfChromosome,
+            long double min,
+            long double max,
+            unsigned long maxLoop,
+            long double stopFitness,
+            unsigned long keep,
+            long double r
+        ) {
+            using namespace std;
+            if (nullptr == this->objective) {
+                throw "Error, setObjective() first, in MultiTargetProcess::run().";
+            }
+            if (keep < 1 || keep * this->objective->getTargetNumber() >= numberOfChromosome) {
+                throw "Error, keep * targetNumber must < numberOfChromosome, in MultiTargetProcess::run().";
+            }
+            this->freeMemory();
+            this->numberOfChromosome = numberOfChromosome;
+            this->targetNumber = this->objective->getTargetNumber();
+            this->keep = keep;
+            this->r = r;
+            this->loopNow = 0;
+            this->evaluationNumber = 0;
+            this->fitness.resize(numberOfChromosome * this->targetNumber);
+            this->bestOffset.assign(this->targetNumber, 0);
+            this->survived.resize(numberOfChromosome);
+            this->order.resize(numberOfChromosome);
+            ChromosomeFactory chromosomeFactory(this->context);
+            for (unsigned long i = 0; i < numberOfChromosome; i++) {
+                this->chromosomes.push_back(chromosomeFactory.buildRandomChromosome(lengthOfChromosome, min, max));
+                this->evaluate(i);
+            }
+            this->findBest();
+            if (this->debug) {
+                cout << "代数=0, 最小的最大适应度=" << this->getMinMaxFitness() << endl;
+            }
+            while (this->loopNow < maxLoop && this->getMinMaxFitness() < stopFitness) {
+                this->generation();
+            }
+            if (this->debug) {
+                cout << "结束。" << endl;
+            }
+        }
+
+        // 继续运行
+        void runContinue(
+            unsigned long maxLoop, // 这一次的最大迭代次数
+            long double stopFitness // 所有目标值都达到多大的适应度就立刻停止迭代
+        ) {
+            using namespace std;
+            unsigned long i = 0;
+            while (!this->chromosomes.empty() && i < maxLoop && this->getMinMaxFitness() < stopFitness) {
+                this->generation();
+                i++;
+            }
+            if (this->debug) {
+                cout << "结束。" << endl;
+            }
+        }
+
+        // 设置debug模式，为true的时候打印调试信息
+        void setDebug(bool enableDebug) {
+            this->debug = enableDebug;
+        }
+
+        // 获取迭代次数。如果在一开始初始化的那代种群就达到停止的条件，那么返回0
+        unsigned long getLoopNumber() {
+            return this->loopNow;
+        }
+
+        // 获取计算过适应度的个体数量，每个个体对所有目标值只计算一次
+        unsigned long getEvaluationNumber() {
+            return this->evaluationNumber;
+        }
+
+        // 获取目标值的个数
+        unsigned long getTargetNumber() {
+            return this->targetNumber;
+        }
+
+        // 获取第 target 个目标值的最大适应度
+        long double getMaxFitness(unsigned long target) {
+            this->checkTarget(target);
+            return this->fitness[this->bestOffset[target] * this->targetNumber + target];
+        }
+
+        // 获取第 target 个目标值适应度最大的个体，属于种群，下一次进化后内容会改变
+        Chromosome* getMaxFitnessChromosome(unsigned long target) {
+            this->checkTarget(target);
+            return this->chromosomes[this->bestOffset[target]];
+        }
+
+    private:
+        // 适应度函数
+        const Fitness::MultiTargetObjective* objective = nullptr;
+        // 染色体or个体的数量
+        unsigned long numberOfChromosome = 0;
+        // 目标值的个数
+        unsigned long targetNumber = 0;
+        // 每个目标值保留的精英个数
+        unsigned long keep = 0;
+        // 变异概率
+        long double r = 0.0;
+        // 运行过程中保留当前迭代属于第几次迭代
+        unsigned long loopNow = 0;
+        // 计算过适应度的个体数量
+        unsigned long evaluationNumber = 0;
+        // 是否开启调试
+        bool debug = false;
+        // 种群
+        std::vector<Chromosome*> chromosomes;
+        // 第 i 个个体对第 k 个目标值的适应度是 fitness[i * targetNumber + k]
+        std::vector<long double> fitness;
+        // 每个目标值适应度最大的个体的位置
+        std::vector<unsigned long> bestOffset;
+        // 这一代保留的个体
+        std::vector<bool> survived;
+        // 按某个目标值排序用的下标
+        std::vector<unsigned long> order;
+        // 迭代时选中的父代
+        std::vector<Chromosome*> selectedChromosome;
+        // 迭代时新生成的个体
+        std::vector<Chromosome*> newChromosome;
+        // 自己的随机数引擎和尾部的输入变量，适应度由 objective 计算，不放在环境里
+        EvolutionContext context;
+
+        // 私有，检查目标值的序号
+        void checkTarget(unsigned long target) {
+            if (this->chromosomes.empty()) {
+                throw "Error, run() first, in MultiTargetProcess.";
+            }
+            if (target >= this->targetNumber) {
+                throw "Error, target out of range, in MultiTargetProcess.";
+            }
+        }
+
+        // 私有，计算第 offset 个个体对所有目标值的适应度
+        void evaluate(unsigned long offset) {
+            this->objective->evaluate(this->chromosomes[offset]->compile(), this->fitness.data() + offset * this->targetNumber);
+            this->evaluationNumber++;
+        }
+
+        // 私有，所有目标值中最差的那个最大适应度
+        long double getMinMaxFitness() {
+            long double result = this->getMaxFitness(0);
+            for (unsigned long k = 1; k < this->targetNumber; k++) {
+                result = std::min(result, this->getMaxFitness(k));
+            }
+            return result;
+        }
+
+        // 私有，找出每个目标值适应度最大的个体，相同时取位置靠前的
+        void findBest() {
+            for (unsigned long k = 0; k < this->targetNumber; k++) {
+                unsigned long best = 0;
+                for (unsigned long i = 1; i < this->numberOfChromosome; i++) {
+                    if (this->fitness[i * this->targetNumber + k] > this->fitness[best * this->targetNumber + k]) {
+                        best = i;
+                    }
+                }
+                this->bestOffset[k] = best;
+            }
+        }
+
+        // 私有，标记每个目标值的 keep 个精英，返回需要替换的个体数量
+        unsigned long markSurvivors() {
+            std::fill(this->survived.begin(), this->survived.end(), false);
+            unsigned long survivors = 0;
+            const std::vector<long double>& fitness = this->fitness;
+            for (unsigned long k = 0; k < this->targetNumber; k++) {
+                unsigned long targetNumber = this->targetNumber;
+                for (unsigned long i = 0; i < this->numberOfChromosome; i++) {
+                    this->order[i] = i;
+                }
+                std::partial_sort(this->order.begin(), this->order.begin() + this->keep, this->order.end(), [&fitness, targetNumber, k](unsigned long a, unsigned long b) -> bool {
+                    return fitness[a * targetNumber + k] > fitness[b * targetNumber + k];
+                });
+                for (unsigned long i = 0; i < this->keep; i++) {
+                    if (!this->survived[this->order[i]]) {
+                        this->survived[this->order[i]] = true;
+                        survivors++;
+                    }
+                }
+            }
+            return this->numberOfChromosome - survivors;
+        }
+
+        // 私有，进化一代
+        void generation() {
+            using namespace std;
+            unsigned long kill = this->markSurvivors();
+            this->select(kill);
+            this->newChromosome.resize(kill);
+            for (unsigned long i = 0; i < kill; i++) {
+                this->newChromosome[i] = this->selectedChromosome[2 * i]->crossover(this->selectedChromosome[1 + 2 * i]);
+                if (0 < this->r) {
+                    this->newChromosome[i]->mutation(this->r);
+                }
+            }
+            unsigned long next = 0;
+            for (unsigned long i = 0; i < this->numberOfChromosome; i++) {
+                if (!this->survived[i]) {
+                    delete this->chromosomes[i];
+                    this->chromosomes[i] = this->newChromosome[next++];
+                    this->evaluate(i);
+                }
+            }
+            this->findBest();
+            this->loopNow++;
+            if (this->debug) {
+                cout << "代数=" << this->loopNow << ", 最小的最大适应度=" << this->getMinMaxFitness() << endl;
+            }
+        }
+
+        // 私有，先随机选目标值，再按这个目标值两两比较的锦标赛选择
+        void select(unsigned long kill) {
+            std::default_random_engine& engine = this->context.getEngine();
+            std::uniform_int_distribution<unsigned long> range(0, this->numberOfChromosome - 1);
+            std::uniform_int_distribution<unsigned long> targetRange(0, this->targetNumber - 1);
+            this->selectedChromosome.resize(2 * kill);
+            for (unsigned long i = 0; i < 2 * kill; i++) {
+                unsigned long target = targetRange(engine);
+                unsigned long a = range(engine);
+                unsigned long b = range(engine);
+                bool first = this->fitness[a * this->targetNumber + target] > this->fitness[b * this->targetNumber + target];
+                this->selectedChromosome[i] = this->chromosomes[first ? a : b];
+            }
+        }
+
+        // 私有，释放种群
+        void freeMemory() {
+            for (auto chromosome : this->chromosomes) {
+                delete chromosome;
+            }
+            this->chromosomes.clear();
+        }
+
+    };
+
+}
+
+#endif
@@ -4,9 +4,13 @@
 #include "MainProcess.h"
 #include "Chromosome.h"
 #include "ChromosomeFactory.h"
-#include "Utils/GlobalCppRandomEngine.h"
+#include "ParameterControl.h"
+#include "Utils/Trace.h"
+#include <string>
 #include <thread>
 #include <random>
+#include <vector>
+#include <algorithm>
 
 namespace GeneticAlgorithm {
 
@@ -51,6 +55,7 @@ namespace GeneticAlgorithm {
             thread** threads = new thread*[this->threadNumber];
             for (unsigned long i = 0; i < this->threadNumber; i++) {
                 threads[i] = new thread([](
+                    unsigned long island,
                     MainProcess* process,
                     unsigned long numberOfChromosome,
                     unsigned long lengthOfChromosome,
@@ -61,12 +66,17 @@ namespace GeneticAlgorithm {
                     unsigned long keep,
                     long double r
                 ) {
+                    traceIsland(island);
+                    Utils::Trace::Scope trace("run", "island");
                     process->run(numberOfChromosome, lengthOfChromosome, min, max, maxLoop, stopFitness, keep, r);
-                }, this->process[i], numberOfChromosome, lengthOfChromosome, min, max, maxLoop, stopFitness, keep, r);
+                }, i, this->process[i], numberOfChromosome, lengthOfChromosome, min, max, maxLoop, stopFitness, this->getIslandKeep(i, keep), this->getIslandRate(i, r));
             }
-            for (unsigned long i = 0; i < this->threadNumber; i++) {
-                threads[i]->join();
-                delete threads[i];
+            {
+                Utils::Trace::Scope trace("join", "barrier"); // 等待最慢的岛
+                for (unsigned long i = 0; i < this->threadNumber; i++) {
+                    threads[i]->join();
+                    delete threads[i];
+                }
             }
             delete[] threads;
         }
@@ -82,27 +92,34 @@ namespace GeneticAlgorithm {
             thread** threads = new thread*[this->threadNumber];
             for (unsigned long i = 0; i < this->threadNumber; i++) {
                 threads[i] = new thread([](
+                    unsigned long island,
                     MainProcess* process,
                     unsigned long maxLoop,
                     long double stopFitness,
                     unsigned long keep,
                     long double r
                 ) {
+                    traceIsland(island);
+                    Utils::Trace::Scope trace("runContinue", "island");
                     process->runContinue(maxLoop, stopFitness, keep, r);
-                }, this->process[i], maxLoop, stopFitness, keep, r);
+                }, i, this->process[i], maxLoop, stopFitness, this->getIslandKeep(i, keep), this->getIslandRate(i, r));
             }
-            for (unsigned long i = 0; i < this->threadNumber; i++) {
-                threads[i]->join();
-                delete threads[i];
+            {
+                Utils::Trace::Scope trace("join", "barrier"); // 等待最慢的岛
+                for (unsigned long i = 0; i < this->threadNumber; i++) {
+                    threads[i]->join();
+                    delete threads[i];
+                }
             }
             delete[] threads;
         }
 
-        // 种群间最好个体随机复制性交换
+        // 种群间最好个体随机复制性交换，在调用的线程上使用第一个岛的随机数引擎
         void exchange() {
             if (1 == this->threadNumber) {
                 return;
             }
+            Utils::Trace::Scope trace("exchange", "migration");
             ChromosomeFactory factory = ChromosomeFactory();
             Chromosome** chromosomeData = new Chromosome*[this->threadNumber];
             for (unsigned long i = 0; i < this->threadNumber; i++) {
@@ -112,7 +129,7 @@ namespace GeneticAlgorithm {
             Chromosome* tmp;
             for (unsigned long i = 0; i < this->threadNumber - 1; i++) {
                 std::uniform_int_distribution<unsigned long> ran(i, this->threadNumber - 1);
-                select = ran(Utils::GlobalCppRandomEngine::engine);
+                select = ran(this->process[0]->getContext().getEngine());
                 tmp = chromosomeData[select];
                 chromosomeData[select] = chromosomeData[i];
                 chromosomeData[i] = tmp;
@@ -130,6 +147,130 @@ namespace GeneticAlgorithm {
             }
         }
 
+        // 设置多基因染色体，见 MainProcess::setGeneNumber()
+        void setGeneNumber(unsigned long numberOfGene, int linkingFunction = Op::ADD) {
+            for (unsigned long i = 0; i < this->threadNumber; i++) {
+                this->process[i]->setGeneNumber(numberOfGene, linkingFunction);
+            }
+        }
+
+        // 设置插串和基因转座的概率，见 MainProcess::setTranspositionRate()
+        void setTranspositionRate(long double insertionSequenceRate, long double rootInsertionSequenceRate, long double geneTranspositionRate) {
+            for (unsigned long i = 0; i < this->threadNumber; i++) {
+                this->process[i]->setTranspositionRate(insertionSequenceRate, rootInsertionSequenceRate, geneTranspositionRate);
+            }
+        }
+
+        // 设置基因重组的概率，见 MainProcess::setGeneRecombinationRate()
+        void setGeneRecombinationRate(long double geneRecombinationRate) {
+            for (unsigned long i = 0; i < this->threadNumber; i++) {
+                this->process[i]->setGeneRecombinationRate(geneRecombinationRate);
+            }
+        }
+
+        // 设置是否共用子表达式计算，见 MainProcess::setSharedEvaluation()
+        void setSharedEvaluation(bool enable) {
+            for (unsigned long i = 0; i < this->threadNumber; i++) {
+                this->process[i]->setSharedEvaluation(enable);
+            }
+        }
+
+        // 设置所有岛的适应度函数，见 MainProcess::setObjective()
+        void setObjective(const Fitness::Objective* objective) {
+            for (unsigned long i = 0; i < this->threadNumber; i++) {
+                this->process[i]->setObjective(objective);
+            }
+        }
+
+        // 设置随机数种子，第 i 个岛使用 seed + i ，每个岛有自己的随机数引擎
+        void seed(unsigned long seed) {
+            for (unsigned long i = 0; i < this->threadNumber; i++) {
+                this->process[i]->seed(seed + i);
+            }
+        }
+
+        // 设置初始种群的种子，见 MainProcess::setSeeds()
+        void setSeeds(const std::vector<Expression::Program>& seeds, long double mutatedRatio = 0.5) {
+            for (unsigned long i = 0; i < this->threadNumber; i++) {
+                this->process[i]->setSeeds(seeds, mutatedRatio);
+            }
+        }
+
+        // 设置每个岛各自的 keep 和 r ，第 i 个岛使用 settings[i % settings.size()] ，
+        // 代替 run() 和 runContinue() 的参数，空的时候所有岛使用相同的参数
+        void setIslandSettings(const std::vector<ParameterSetting>& settings) {
+            this->islandSettings = settings;
+        }
+
+        // 设置用 1/5 成功法则调整变异概率，见 MainProcess::setAdaptiveMutation()
+        void setAdaptiveMutation(bool enable, long double minRate = 0.001L, long double maxRate = 0.5L) {
+            for (unsigned long i = 0; i < this->threadNumber; i++) {
+                this->process[i]->setAdaptiveMutation(enable, minRate, maxRate);
+            }
+        }
+
+        // 设置候选的 (keep, r) ，每个岛各自选择，见 MainProcess::setParameterArms()
+        void setParameterArms(const std::vector<ParameterSetting>& settings, unsigned long epoch = 10) {
+            for (unsigned long i = 0; i < this->threadNumber; i++) {
+                this->process[i]->setParameterArms(settings, epoch);
+            }
+        }
+
+        // 获取所有岛上每组参数的使用次数和进展，相同的参数合并，按平均进展从大到小排列
+        std::vector<ParameterStatistics> getParameterStatistics() {
+            std::vector<ParameterStatistics> result;
+            for (unsigned long i = 0; i < this->threadNumber; i++) {
+                for (auto& e : this->process[i]->getParameterStatistics()) {
+                    unsigned long j = 0;
+                    while (j < result.size() && (result[j].setting.keep != e.setting.keep || result[j].setting.r != e.setting.r)) {
+                        j++;
+                    }
+                    if (j == result.size()) {
+                        result.push_back(e);
+                        continue;
+                    }
+                    result[j].pulls += e.pulls;
+                    result[j].generations += e.generations;
+                    result[j].reward += e.reward;
+                    result[j].squareReward += e.squareReward;
+                }
+            }
+            std::stable_sort(result.begin(), result.end(), [](const ParameterStatistics& a, const ParameterStatistics& b) -> bool {
+                return a.getMeanReward() > b.getMeanReward();
+            });
+            return result;
+        }
+
+        // 获取一个岛当前的变异概率
+        long double getMutationRate(unsigned long island) {
+            return this->process[island]->getMutationRate();
+        }
+
+        // 获取一个岛当前每次迭代保留的个体数量
+        unsigned long getKeep(unsigned long island) {
+            return this->process[island]->getKeep();
+        }
+
+        // 设置停滞检测和重启，见 MainProcess::setStagnation()
+        void setStagnation(unsigned long generations, long double minDistinctRatio, long double reinitializeRatio, long double hypermutationRate = 0.0, unsigned long hypermutationGenerations = 0) {
+            for (unsigned long i = 0; i < this->threadNumber; i++) {
+                this->process[i]->setStagnation(generations, minDistinctRatio, reinitializeRatio, hypermutationRate, hypermutationGenerations);
+            }
+        }
+
+        // 获取岛的个数
+        unsigned long getThreadNumber() {
+            return this->threadNumber;
+        }
+
+        // 获取一个岛，用于在自己管理的线程上运行，例如 Service::Server 的工作线程
+        MainProcess* getIsland(unsigned long island) {
+            if (island >= this->threadNumber) {
+                throw "Error, island out of range, in Multithreading::getIsland().";
+            }
+            return this->process[island];
+        }
+
         // 获取迭代次数。如果在一开始初始化的那代种群就达到停止的条件，那么返回0
         unsigned long getLoopNumber() {
             return this->process[0]->getLoopNumber();
@@ -164,10 +305,30 @@ namespace GeneticAlgorithm {
         }
 
     private:
+
+        // 私有，岛的线程使用自己的追踪泳道，0 留给调用 run() 的线程
+        static void traceIsland(unsigned long island) {
+            if (Utils::Trace::isEnabled()) {
+                Utils::Trace::setLane(island + 1, "island " + std::to_string(island));
+            }
+        }
+
+        // 私有，第 island 个岛使用的 keep
+        unsigned long getIslandKeep(unsigned long island, unsigned long keep) {
+            return this->islandSettings.empty() ? keep : this->islandSettings[island % this->islandSettings.size()].keep;
+        }
+
+        // 私有，第 island 个岛使用的变异概率
+        long double getIslandRate(unsigned long island, long double r) {
+            return this->islandSettings.empty() ? r : this->islandSettings[island % this->islandSettings.size()].r;
+        }
+
         // 线程数
         unsigned long threadNumber;
         // MainProcess对象
         MainProcess** process = nullptr;
+        // 每个岛的 keep 和 r
+        std::vector<ParameterSetting> islandSettings;
     };
 
 }
@@ -0,0 +1,218 @@
+#ifndef GENETICALGORITHM_PARAMETERCONTROL_H
+#define GENETICALGORITHM_PARAMETERCONTROL_H
+
+#include <vector>
+#include <cmath>
+
+namespace GeneticAlgorithm {
+
+    // 一组进化参数
+    struct ParameterSetting {
+        // 每次迭代保留多少个上一代的个体
+        unsigned long keep;
+        // 变异概率
+        long double r;
+    };
+
+    // 一组参数的使用记录
+    struct ParameterStatistics {
+        ParameterSetting setting;
+        // 被选中的次数，每次运行一个周期
+        unsigned long pulls;
+        // 一共运行的代数
+        unsigned long generations;
+        // 每个周期的进展之和，进展是最大适应度向 1 前进的比例
+        long double reward;
+        // 进展的平方和
+        long double squareReward;
+
+        // 平均每个周期的进展
+        long double getMeanReward() const {
+            return 0 == this->pulls ? 0.0L : this->reward / this->pulls;
+        }
+    };
+
+    /**
+     * 进化参数的自适应控制
+     *
+     * 两种方式，可以同时使用：
+     *   1/5 成功法则：每代统计新个体比两个父代中较好的那个更好的比例，高于 1/5 时增大变异
+     *   概率，低于时减小，平衡点是 1/5 的成功率
+     *   多臂老虎机：在几组 (keep, r) 中选择，每组运行 epoch 代为一个周期，按周期内最大
+     *   适应度的进展用 UCB1-Tuned 选下一组，进展越快的参数被选中得越多
+     *
+     * 每代只有几次浮点运算。getStatistics() 报告每组参数的使用次数和平均进展。
+     */
+    class ParameterControl {
+
+    public:
+
+        // 设置多臂老虎机的候选参数，每组运行 epoch 代，空的时候不使用
+        void setArms(const std::vector<ParameterSetting>& settings, unsigned long epoch = 10) {
+            this->arms.clear();
+            for (auto& setting : settings) {
+                this->arms.push_back(makeStatistics(setting));
+            }
+            this->epoch = epoch < 1 ? 1 : epoch;
+        }
+
+        // 设置 1/5 成功法则，变异概率限制在 [minRate, maxRate] 之间
+        void setOneFifthRule(bool enable, long double minRate = 0.001L, long double maxRate = 0.5L) {
+            this->oneFifthRule = enable;
+            this->minRate = minRate;
+            this->maxRate = maxRate;
+        }
+
+        // 是否在多组参数中选择
+        bool hasArms() {
+            return !this->arms.empty();
+        }
+
+        // 是否使用 1/5 成功法则
+        bool isOneFifthRule() {
+            return this->oneFifthRule;
+        }
+
+        // 开始一次运行，返回这次使用的参数：setting 是候选参数之一时从它开始，没有候选参数时就是 setting
+        ParameterSetting begin(const ParameterSetting& setting, long double fitness) {
+            if (this->arms.empty()) {
+                // 没有候选参数时只记录这一组参数的进展
+                this->fixed = makeStatistics(setting);
+                this->current = 0;
+            } else {
+                this->current = this->arms.size();
+                for (unsigned long i = 0; i < this->arms.size(); i++) {
+                    this->arms[i] = makeStatistics(this->arms[i].setting);
+                    // 不同的岛可以从不同的候选参数开始
+                    if (this->arms[i].setting.keep == setting.keep && this->arms[i].setting.r == setting.r && this->current == this->arms.size()) {
+                        this->current = i;
+                    }
+                }
+                if (this->current == this->arms.size()) {
+                    this->current = this->choose();
+                }
+            }
+            this->totalPulls = 0;
+            this->epochGenerations = 0;
+            this->epochFitness = fitness;
+            return this->getSetting();
+        }
+
+        // 当前使用的参数
+        ParameterSetting getSetting() {
+            return this->currentArm().setting;
+        }
+
+        // 一代结束，周期结束时选择下一组参数，参数改变时返回 true
+        bool next(long double fitness) {
+            this->currentArm().generations++;
+            this->epochGenerations++;
+            if (this->arms.empty() || this->epochGenerations < this->epoch) {
+                return false;
+            }
+            this->finishEpoch(this->currentArm(), fitness);
+            this->totalPulls++;
+            this->epochGenerations = 0;
+            this->epochFitness = fitness;
+            unsigned long previous = this->current;
+            this->current = this->choose();
+            return previous != this->current;
+        }
+
+        // 按 1/5 成功法则调整变异概率，total 个新个体中有 successes 个比父代好
+        long double adaptRate(long double r, unsigned long successes, unsigned long total) {
+            if (!this->oneFifthRule || 0 == total) {
+                return r;
+            }
+            // 每个成功乘以 F ，每个失败乘以 F^(-1/4) ，成功率为 1/5 时不变
+            const long double factor = 1.5L;
+            long double exponent = ((long double)successes - (long double)(total - successes) / 4.0L) / total;
+            r *= std::pow(factor, exponent);
+            return r < this->minRate ? this->minRate : (r > this->maxRate ? this->maxRate : r);
+        }
+
+        // 每组参数的使用记录，fitness 是当前的最大适应度，用来计入还没有结束的周期
+        std::vector<ParameterStatistics> getStatistics(long double fitness) {
+            std::vector<ParameterStatistics> result = this->arms.empty() ? std::vector<ParameterStatistics>(1, this->fixed) : this->arms;
+            if (this->epochGenerations > 0) {
+                this->finishEpoch(result[this->current], fitness);
+            }
+            return result;
+        }
+
+    private:
+        // 候选参数
+        std::vector<ParameterStatistics> arms;
+        // 没有候选参数时的记录
+        ParameterStatistics fixed = makeStatistics(ParameterSetting());
+        // 每个周期的代数
+        unsigned long epoch = 10;
+        // 当前的候选参数
+        unsigned long current = 0;
+        // 已经结束的周期数
+        unsigned long totalPulls = 0;
+        // 当前周期已经运行的代数
+        unsigned long epochGenerations = 0;
+        // 当前周期开始时的最大适应度
+        long double epochFitness = 0.0;
+        // 是否使用 1/5 成功法则
+        bool oneFifthRule = false;
+        // 变异概率的下限
+        long double minRate = 0.001L;
+        // 变异概率的上限
+        long double maxRate = 0.5L;
+
+        // 私有，空的记录
+        static ParameterStatistics makeStatistics(const ParameterSetting& setting) {
+            ParameterStatistics statistics;
+            statistics.setting = setting;
+            statistics.pulls = 0;
+            statistics.generations = 0;
+            statistics.reward = 0.0L;
+            statistics.squareReward = 0.0L;
+            return statistics;
+        }
+
+        // 私有，当前参数的记录
+        ParameterStatistics& currentArm() {
+            return this->arms.empty() ? this->fixed : this->arms[this->current];
+        }
+
+        // 私有，记录一个周期的进展：最大适应度向 1 前进的比例，和适应度的尺度无关
+        void finishEpoch(ParameterStatistics& arm, long double fitness) {
+            long double reward = 0.0L;
+            if (this->epochFitness < 1.0L && fitness > this->epochFitness) {
+                reward = (fitness - this->epochFitness) / (1.0L - this->epochFitness);
+                reward = reward > 1.0L ? 1.0L : reward;
+            }
+            arm.pulls++;
+            arm.reward += reward;
+            arm.squareReward += reward * reward;
+        }
+
+        // 私有，UCB1-Tuned ，先把每组参数都试一次
+        unsigned long choose() {
+            unsigned long best = 0;
+            long double bestScore = -1.0L;
+            long double logPulls = std::log((long double)(this->totalPulls > 0 ? this->totalPulls : 1));
+            for (unsigned long i = 0; i < this->arms.size(); i++) {
+                const ParameterStatistics& arm = this->arms[i];
+                if (0 == arm.pulls) {
+                    return i;
+                }
+                long double mean = arm.reward / arm.pulls;
+                long double variance = arm.squareReward / arm.pulls - mean * mean + std::sqrt(2.0L * logPulls / arm.pulls);
+                long double score = mean + std::sqrt(logPulls / arm.pulls * (variance < 0.25L ? variance : 0.25L));
+                if (score > bestScore) {
+                    best = i;
+                    bestScore = score;
+                }
+            }
+            return best;
+        }
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef GENETICALGORITHM_PARETOSORT_H
+#define GENETICALGORITHM_PARETOSORT_H
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+namespace GeneticAlgorithm {
+
+    /* 两个目标的非支配排序和拥挤距离，两个目标都是越小越好
+     *
+     * 先按第一个目标排序，再依次把每个点放进第一个不支配它的前沿。同一个前沿里面后加入的
+     * 点第二个目标最小，各个前沿最后一个点的第二个目标随前沿序号单调不减，可以二分查找，
+     * 总共 O(n log n) 。
+     */
+    class ParetoSort {
+
+    public:
+
+        // 一个个体的两个目标，以及排序的结果
+        struct Point {
+            long double first;
+            long double second;
+            unsigned long rank;
+            long double crowding;
+        };
+
+        /**
+         * 计算每个点所在的前沿（0 是最好的）和拥挤距离（越大越好，边界上的点是无穷大）
+         *
+         * @param std::vector<Point>& points
+         * @return unsigned long 前沿的个数
+         */
+        unsigned long rank(std::vector<Point>& points) {
+            std::vector<unsigned long> order(points.size());
+            for (unsigned long i = 0; i < order.size(); i++) {
+                order[i] = i;
+            }
+            std::sort(order.begin(), order.end(), [&points](unsigned long a, unsigned long b) -> bool {
+                if (points[a].first != points[b].first) {
+                    return points[a].first < points[b].first;
+                }
+                return points[a].second < points[b].second;
+            });
+            // fronts[k] 按第一个目标从小到大保存第 k 个前沿的点
+            std::vector<std::vector<unsigned long>> fronts;
+            unsigned long low, high, middle;
+            for (unsigned long i : order) {
+                low = 0;
+                high = fronts.size();
+                while (low < high) {
+                    middle = (low + high) / 2;
+                    if (this->dominates(points[fronts[middle].back()], points[i])) {
+                        low = middle + 1;
+                    } else {
+                        high = middle;
+                    }
+                }
+                if (low == fronts.size()) {
+                    fronts.push_back(std::vector<unsigned long>());
+                }
+                fronts[low].push_back(i);
+                points[i].rank = low;
+            }
+            for (auto& front : fronts) {
+                this->crowding(points, front);
+            }
+            return fronts.size();
+        }
+
+        /**
+         * 拥挤比较：前沿序号小的好，同一个前沿里面拥挤距离大的好
+         *
+         * @param const Point& a
+         * @param const Point& b
+         * @return bool a 比 b 好
+         */
+        static bool better(const Point& a, const Point& b) {
+            if (a.rank != b.rank) {
+                return a.rank < b.rank;
+            }
+            return a.crowding > b.crowding;
+        }
+
+    private:
+
+        // 私有，a 是否支配 b
+        bool dominates(const Point& a, const Point& b) {
+            return a.first <= b.first && a.second <= b.second && (a.first < b.first || a.second < b.second);
+        }
+
+        // 私有，计算一个前沿的拥挤距离，前沿中的点已经按第一个目标排好序，第二个目标是反序的
+        void crowding(std::vector<Point>& points, const std::vector<unsigned long>& front) {
+            const long double infinity = std::numeric_limits<long double>::infinity();
+            unsigned long size = front.size();
+            for (unsigned long i : front) {
+                points[i].crowding = 0.0L;
+            }
+            points[front[0]].crowding = infinity;
+            points[front[size - 1]].crowding = infinity;
+            if (size < 3) {
+                return;
+            }
+            long double firstRange = points[front[size - 1]].first - points[front[0]].first;
+            long double secondRange = points[front[0]].second - points[front[size - 1]].second;
+            for (unsigned long k = 1; k + 1 < size; k++) {
+                Point& point = points[front[k]];
+                if (firstRange > 0) {
+                    point.crowding += (points[front[k + 1]].first - points[front[k - 1]].first) / firstRange;
+                }
+                if (secondRange > 0) {
+                    point.crowding += (points[front[k - 1]].second - points[front[k + 1]].second) / secondRange;
+                }
+            }
+        }
+
+    };
+
+}
+
+#endif
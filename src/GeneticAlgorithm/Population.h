@@ -2,8 +2,12 @@
 #define GENETICALGORITHM_POPULATION_H
 
 #include "Chromosome.h"
+#include "ParetoSort.h"
 #include <iostream>
 #include <algorithm>
+#include <unordered_set>
+#include <vector>
+#include <cmath>
 
 namespace GeneticAlgorithm {
 
@@ -115,6 +119,95 @@ namespace GeneticAlgorithm {
             this->maxFitnessChromosomeOffset = 0;
         }
 
+        // 表达出来的表达式不同的个体数量，按哈希值统计，O(n)
+        unsigned long getDistinctNumber() {
+            std::unordered_set<std::size_t> hashes;
+            hashes.reserve(this->numberOfChromosome);
+            for (unsigned long i = 0; i < this->numberOfChromosome; i++) {
+                hashes.insert(this->chromosomeArray[i]->getExpressionHash());
+            }
+            return hashes.size();
+        }
+
+        // 适应度的熵，把 [0, 1] 平均分成 bins 段统计，O(n) 。所有个体适应度接近时为 0
+        long double getFitnessEntropy(unsigned long bins = 64) {
+            std::vector<unsigned long> histogram(bins, 0);
+            unsigned long bin;
+            for (unsigned long i = 0; i < this->numberOfChromosome; i++) {
+                long double fitness = this->chromosomeArray[i]->getFitness();
+                bin = fitness >= 1.0L ? bins - 1 : (fitness > 0.0L ? (unsigned long)(fitness * bins) : 0);
+                histogram[bin]++;
+            }
+            long double entropy = 0.0L, p;
+            for (unsigned long i = 0; i < bins; i++) {
+                if (0 != histogram[i]) {
+                    p = (long double)histogram[i] / this->numberOfChromosome;
+                    entropy -= p * std::log(p);
+                }
+            }
+            return entropy;
+        }
+
+        // 多目标：新个体和种群合并，按非支配排序和拥挤距离保留原来数量的个体，其余的删除。
+        // 两个目标是误差（1 - 适应度）和表达出来的节点个数。之后种群按拥挤比较从好到差排列，
+        // 位置越靠前越好。number 为 0 时只排序
+        void selectPareto(Chromosome** offspring, unsigned long number) {
+            unsigned long total = this->numberOfChromosome + number;
+            std::vector<Chromosome*> all(total);
+            std::vector<ParetoSort::Point> points, duplicatedPoints;
+            std::vector<unsigned long> order, duplicated;
+            std::unordered_set<std::size_t> hashes;
+            ParetoSort::Point point;
+            for (unsigned long i = 0; i < total; i++) {
+                all[i] = i < this->numberOfChromosome ? this->chromosomeArray[i] : offspring[i - this->numberOfChromosome];
+                long double fitness = all[i]->getFitness();
+                point.first = fitness == fitness ? 1.0L - fitness : 1.0L; // nan 当作最差
+                point.second = all[i]->getExpressedSize();
+                // 表达式相同的个体只有第一个参加排序，其余的排在最后，否则前沿会被同一个表达式占满
+                if (hashes.insert(all[i]->getExpressionHash()).second) {
+                    points.push_back(point);
+                    order.push_back(i);
+                } else {
+                    duplicatedPoints.push_back(point);
+                    duplicated.push_back(i);
+                }
+            }
+            unsigned long frontNumber = ParetoSort().rank(points);
+            for (unsigned long i = 0; i < duplicated.size(); i++) {
+                duplicatedPoints[i].rank = frontNumber;
+                duplicatedPoints[i].crowding = -duplicatedPoints[i].first; // 误差小的优先
+                points.push_back(duplicatedPoints[i]);
+                order.push_back(duplicated[i]);
+            }
+            // points[k] 对应 all[order[k]] ，下面按 points 的下标排序
+            std::vector<Chromosome*> unique(total);
+            for (unsigned long k = 0; k < total; k++) {
+                unique[k] = all[order[k]];
+                order[k] = k;
+            }
+            all.swap(unique);
+            std::sort(order.begin(), order.end(), [&points](unsigned long a, unsigned long b) -> bool {
+                return ParetoSort::better(points[a], points[b]);
+            });
+            this->frontSize = 0;
+            for (unsigned long i = 0; i < total; i++) {
+                if (i < this->numberOfChromosome) {
+                    this->chromosomeArray[i] = all[order[i]];
+                    if (0 == points[order[i]].rank) {
+                        this->frontSize++;
+                    }
+                } else {
+                    delete all[order[i]];
+                }
+            }
+            this->isMaxFitnessChromosomeCache = false;
+        }
+
+        // 最近一次 selectPareto() 之后第一个前沿的个体数量，它们排在种群的最前面
+        unsigned long getFrontSize() {
+            return this->frontSize;
+        }
+
     private:
         // 染色体数量
         unsigned long numberOfChromosome;
@@ -126,6 +219,8 @@ namespace GeneticAlgorithm {
         Chromosome* maxFitnessChromosomeCache;
         // 最大适应度个体的偏移位置
         unsigned long maxFitnessChromosomeOffset;
+        // 第一个前沿的个体数量
+        unsigned long frontSize = 0;
 
     };
 
@@ -4,6 +4,8 @@
 #include "PopulationFactory.h"
 #include "ChromosomeFactory.h"
 #include "Population.h"
+#include "../Expression/Program.h"
+#include <vector>
 
 namespace GeneticAlgorithm {
 
@@ -13,23 +15,105 @@ namespace GeneticAlgorithm {
 
     public:
 
+        /**
+         * 生成的个体都属于 context ，见 ChromosomeFactory
+         *
+         * @param EvolutionContext& context
+         */
+        PopulationFactory(EvolutionContext& context = EvolutionContext::getDefault()) : context(&context) {
+        }
+
         /**
          * 返回种群实体
          * @param unsigned long numberOfChromosome 种群的大小，
          * @param unsigned long lengthOfChromosome 个体染色体的长度
          * @param long double min 数字区域数字最小值
          * @param long double min 数字区域数字最大值
+         * @param unsigned long numberOfGene 每个染色体的基因个数
+         * @param int linkingFunction 连接各个基因的二元函数
          * @return Population*
          */
-         Population* buildRandomPopulation(unsigned long numberOfChromosome, unsigned long lengthOfChromosome, long double min, long double max) {
-             auto chromosomeFactory = ChromosomeFactory();
+         Population* buildRandomPopulation(unsigned long numberOfChromosome, unsigned long lengthOfChromosome, long double min, long double max, unsigned long numberOfGene = 1, int linkingFunction = Op::ADD) {
+             auto chromosomeFactory = ChromosomeFactory(*this->context);
              auto population = new Population(numberOfChromosome);
              for (unsigned long i = 0; i < numberOfChromosome; i++) {
-                 population->setChromosome(i, chromosomeFactory.buildRandomChromosome(lengthOfChromosome, min, max));
+                 population->setChromosome(i, chromosomeFactory.buildRandomChromosome(lengthOfChromosome, min, max, numberOfGene, linkingFunction));
              }
              return population;
          }
 
+         /**
+          * 用已有的表达式作为种子创建种群，例如之前保存的最优个体
+          *
+          * 种子按 ChromosomeFactory::buildFromProgram() 编码后放在最前面，剩下的个体中
+          * mutatedRatio 比例是种子的变异副本（轮流复制每个种子，变异概率 r ），其余随机生成。
+          *
+          * @param const std::vector<Expression::Program>& seeds 种子，多于种群大小时只用前面的
+          * @param unsigned long numberOfChromosome 种群的大小
+          * @param unsigned long lengthOfChromosome 个体染色体的长度
+          * @param long double min 数字区域数字最小值
+          * @param long double max 数字区域数字最大值
+          * @param unsigned long numberOfGene 每个染色体的基因个数
+          * @param int linkingFunction 连接各个基因的二元函数
+          * @param long double mutatedRatio 变异副本的比例
+          * @param long double r 变异副本的变异概率
+          * @return Population*
+          */
+         Population* buildSeededPopulation(const std::vector<Expression::Program>& seeds, unsigned long numberOfChromosome, unsigned long lengthOfChromosome, long double min, long double max, unsigned long numberOfGene = 1, int linkingFunction = Op::ADD, long double mutatedRatio = 0.5, long double r = 0.1) {
+             auto chromosomeFactory = ChromosomeFactory(*this->context);
+             auto population = new Population(numberOfChromosome);
+             unsigned long seedNumber = seeds.size() < numberOfChromosome ? seeds.size() : numberOfChromosome;
+             unsigned long i = 0;
+             try {
+                 for (; i < seedNumber; i++) {
+                     population->setChromosome(i, chromosomeFactory.buildFromProgram(seeds[i], lengthOfChromosome, min, max, numberOfGene, linkingFunction));
+                 }
+             } catch (const char*) {
+                 delete population; // 没有设置的位置是 nullptr
+                 throw;
+             }
+             unsigned long mutatedNumber = 0 == seedNumber ? 0 : (unsigned long)(mutatedRatio * (numberOfChromosome - seedNumber));
+             for (unsigned long k = 0; k < mutatedNumber; k++, i++) {
+                 Chromosome* copy = chromosomeFactory.buildFromChromosome(population->getChromosome(k % seedNumber));
+                 copy->mutation(r);
+                 population->setChromosome(i, copy);
+             }
+             for (; i < numberOfChromosome; i++) {
+                 population->setChromosome(i, chromosomeFactory.buildRandomChromosome(lengthOfChromosome, min, max, numberOfGene, linkingFunction));
+             }
+             return population;
+         }
+
+         /**
+          * 部分重新初始化，用新的随机个体替换种群末尾的 number 个个体，最优的个体不会被替换
+          * @param Population* population 种群
+          * @param unsigned long number 替换的个体数量
+          * @param unsigned long lengthOfChromosome 个体染色体的长度
+          * @param long double min 数字区域数字最小值
+          * @param long double max 数字区域数字最大值
+          * @param unsigned long numberOfGene 每个染色体的基因个数
+          * @param int linkingFunction 连接各个基因的二元函数
+          * @return unsigned long 实际替换的个体数量
+          */
+         unsigned long reinitialize(Population* population, unsigned long number, unsigned long lengthOfChromosome, long double min, long double max, unsigned long numberOfGene = 1, int linkingFunction = Op::ADD) {
+             auto chromosomeFactory = ChromosomeFactory(*this->context);
+             Chromosome* maxChromosome = population->getMaxFitnessChromosome();
+             unsigned long replaced = 0;
+             for (unsigned long offset = population->getSize(); offset > 0 && replaced < number; offset--) {
+                 if ((void*)population->getChromosome(offset - 1) == (void*)maxChromosome) {
+                     continue;
+                 }
+                 population->replaceChromosome(offset - 1, chromosomeFactory.buildRandomChromosome(lengthOfChromosome, min, max, numberOfGene, linkingFunction));
+                 replaced++;
+             }
+             return replaced;
+         }
+
+    private:
+
+        /** @var EvolutionContext* 生成的个体所属的环境 */
+        EvolutionContext* context;
+
     };
 
 }
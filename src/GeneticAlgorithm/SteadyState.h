@@ -0,0 +1,272 @@
+#ifndef GENETICALGORITHM_STEADYSTATE_H
+#define GENETICALGORITHM_STEADYSTATE_H
+
+#include "Population.h"
+#include "PopulationFactory.h"
+#include "Chromosome.h"
+#include "EvolutionContext.h"
+#include <random>
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <limits>
+
+namespace GeneticAlgorithm {
+
+    /**
+     * 稳态流程
+     *
+     * 没有“代”：每个工作线程不停地选择父代、交叉、变异、计算适应度，新个体比种群中最差的
+     * 个体好就立刻替换它。最差的个体用保存种群位置的最小堆维护，替换以后只需要 O(log n)
+     * 调整，不需要排序。选择、交叉和变异在锁内完成（工作线程共用这个对象的随机数引擎，它不是
+     * 线程安全的，而且父代可能被其它线程替换掉），计算适应度在锁外并行，所以适应度越贵并行的效果越好。
+     */
+    class SteadyState {
+
+    private:
+        // 工作线程数量
+        unsigned long threadNumber;
+        // 染色体or个体的数量
+        unsigned long numberOfChromosome;
+        // 变异概率
+        long double r;
+        // 存储一个Population实例
+        Population* population = nullptr;
+        // 最小堆，保存种群中的位置，堆顶是适应度最小的个体
+        std::vector<unsigned long> heap;
+        // 保护种群和堆
+        std::mutex lock;
+        // 已经开始计算的新个体数量
+        std::atomic<unsigned long> evaluationNumber;
+        // 替换进种群的新个体数量
+        unsigned long insertionNumber = 0;
+        // 最大适应度
+        long double maxFitness = 0.0;
+        // 最大适应度个体在种群中的位置
+        unsigned long maxFitnessOffset = 0;
+        // 最多计算多少个新个体
+        unsigned long maxEvaluation;
+        // 达到多大的适应度就停止
+        long double stopFitness;
+        // 是否开启调试
+        bool debug = false;
+        // 每个染色体的基因个数
+        unsigned long numberOfGene = 1;
+        // 连接各个基因的二元函数
+        int linkingFunction = Op::ADD;
+        // 自己的随机数引擎和适应度函数，种群中的个体都属于它
+        EvolutionContext context;
+
+    public:
+        // 构造方法，threadNumber 为 0 时使用硬件线程数
+        SteadyState(unsigned long threadNumber = 0) : evaluationNumber(0) {
+            if (0 == threadNumber) {
+                threadNumber = std::thread::hardware_concurrency();
+            }
+            this->threadNumber = threadNumber < 1 ? 1 : threadNumber;
+        }
+
+        // 销毁对象时用于释放内存
+        ~SteadyState() {
+            if (nullptr != this->population) {
+                delete this->population;
+            }
+        }
+
+        SteadyState(const SteadyState&) = delete;
+
+        SteadyState& operator=(const SteadyState&) = delete;
+
+        // 主流程运行，计算了 maxEvaluation 个新个体或者适应度达到 stopFitness 时停止
+        void run(
+            unsigned long numberOfChromosome,
+            unsigned long lengthOfChromosome,
+            long double min,
+            long double max,
+            unsigned long maxEvaluation,
+            long double stopFitness,
+            long double r
+        ) {
+            using namespace std;
+            if (numberOfChromosome < 2) {
+                throw "numberOfChromosome < 2";
+            }
+            if (nullptr != this->population) {
+                delete this->population;
+            }
+            this->numberOfChromosome = numberOfChromosome;
+            this->r = r;
+            this->maxEvaluation = maxEvaluation;
+            this->stopFitness = stopFitness;
+            this->evaluationNumber = 0;
+            this->insertionNumber = 0;
+            this->population = PopulationFactory(this->context).buildRandomPopulation(numberOfChromosome, lengthOfChromosome, min, max, this->numberOfGene, this->linkingFunction);
+            this->buildHeap();
+            if (this->debug) {
+                cout << "初始, 最大适应度=" << this->maxFitness << ", 个体信息：";
+                this->getMaxFitnessChromosome()->dump();
+            }
+            vector<thread> threads;
+            for (unsigned long i = 0; i < this->threadNumber; i++) {
+                threads.push_back(thread(&SteadyState::work, this));
+            }
+            for (auto& worker : threads) {
+                worker.join();
+            }
+            if (this->debug) {
+                cout << "结束。新个体=" << this->evaluationNumber << ", 替换=" << this->insertionNumber << endl;
+            }
+        }
+
+        // 设置debug模式，为true的时候打印调试信息
+        void setDebug(bool enableDebug) {
+            this->debug = enableDebug;
+        }
+
+        // 设置多基因染色体，和 MainProcess::setGeneNumber() 相同，染色体长度必须是基因个数的倍数，下一次 run() 生效
+        void setGeneNumber(unsigned long numberOfGene, int linkingFunction = Op::ADD) {
+            this->numberOfGene = numberOfGene;
+            this->linkingFunction = linkingFunction;
+        }
+
+        // 设置适应度函数，见 MainProcess::setObjective() ，下一次 run() 生效，对象使用期间不能释放
+        void setObjective(const Fitness::Objective* objective) {
+            this->context.setObjective(objective);
+        }
+
+        // 设置随机数种子，默认的种子在创建时从 GlobalCppRandomEngine 取
+        void seed(unsigned long seed) {
+            this->context.seed(seed);
+        }
+
+        // 获取已经计算的新个体数量
+        unsigned long getEvaluationNumber() {
+            return this->evaluationNumber;
+        }
+
+        // 获取替换进种群的新个体数量
+        unsigned long getInsertionNumber() {
+            return this->insertionNumber;
+        }
+
+        // 获取最大的适应度
+        long double getMaxFitness() {
+            return this->maxFitness;
+        }
+
+        // 获取Fitness最大值的Chromosome
+        Chromosome* getMaxFitnessChromosome() {
+            return this->population->getChromosome(this->maxFitnessOffset);
+        }
+
+    private:
+
+        // 私有，工作线程
+        void work() {
+            Chromosome* offspring;
+            while (true) {
+                {
+                    std::lock_guard<std::mutex> guard(this->lock);
+                    if (this->isFinished()) {
+                        return;
+                    }
+                    // 在锁内占用一次计算的名额，多个线程同时计算时总数也不会超过 maxEvaluation
+                    this->evaluationNumber++;
+                    offspring = this->select()->crossover(this->select());
+                    if (0 < this->r) {
+                        offspring->mutation(this->r);
+                    }
+                }
+                offspring->getFitness(); // 锁外计算
+                std::lock_guard<std::mutex> guard(this->lock);
+                this->insert(offspring);
+            }
+        }
+
+        // 私有，是否应该停止
+        bool isFinished() {
+            return this->evaluationNumber >= this->maxEvaluation || this->maxFitness >= this->stopFitness;
+        }
+
+        // 私有，锦标赛选择一个个体
+        Chromosome* select() {
+            std::default_random_engine& engine = this->context.getEngine();
+            std::uniform_int_distribution<unsigned long> range(0, this->numberOfChromosome - 1);
+            Chromosome* selectChromosome1 = this->population->getChromosome(range(engine));
+            Chromosome* selectChromosome2 = this->population->getChromosome(range(engine));
+            return selectChromosome1->getFitness() > selectChromosome2->getFitness() ? selectChromosome1 : selectChromosome2;
+        }
+
+        // 私有，新个体比最差的个体好就替换它，否则丢弃
+        void insert(Chromosome* offspring) {
+            unsigned long worst = this->heap[0];
+            if (!(this->key(offspring) > this->key(this->population->getChromosome(worst)))) {
+                delete offspring;
+                return;
+            }
+            this->population->replaceChromosome(worst, offspring);
+            this->insertionNumber++;
+            this->siftDown(0);
+            if (offspring->getFitness() > this->maxFitness) {
+                this->maxFitness = offspring->getFitness();
+                this->maxFitnessOffset = worst;
+                if (this->debug) {
+                    std::cout << "新个体=" << this->evaluationNumber << ", 最大适应度=" << this->maxFitness << ", 个体信息：";
+                    offspring->dump();
+                }
+            }
+        }
+
+        // 私有，堆中比较用的适应度，nan 当作最小
+        long double key(Chromosome* chromosome) {
+            long double fitness = chromosome->getFitness();
+            return fitness == fitness ? fitness : -std::numeric_limits<long double>::infinity();
+        }
+
+        // 私有，堆中第 i 个的适应度
+        long double keyAt(unsigned long i) {
+            return this->key(this->population->getChromosome(this->heap[i]));
+        }
+
+        // 私有，建堆，O(n)
+        void buildHeap() {
+            this->heap.resize(this->numberOfChromosome);
+            this->maxFitness = -std::numeric_limits<long double>::infinity();
+            for (unsigned long i = 0; i < this->numberOfChromosome; i++) {
+                this->heap[i] = i;
+                if (this->key(this->population->getChromosome(i)) > this->maxFitness) {
+                    this->maxFitness = this->key(this->population->getChromosome(i));
+                    this->maxFitnessOffset = i;
+                }
+            }
+            for (unsigned long i = this->numberOfChromosome / 2; i > 0; i--) {
+                this->siftDown(i - 1);
+            }
+        }
+
+        // 私有，下沉，只有堆顶会被替换成更好的个体，所以不需要上浮
+        void siftDown(unsigned long i) {
+            unsigned long child, size = this->heap.size();
+            while (true) {
+                child = 2 * i + 1;
+                if (child >= size) {
+                    return;
+                }
+                if (child + 1 < size && this->keyAt(child + 1) < this->keyAt(child)) {
+                    child++;
+                }
+                if (!(this->keyAt(child) < this->keyAt(i))) {
+                    return;
+                }
+                std::swap(this->heap[i], this->heap[child]);
+                i = child;
+            }
+        }
+
+    };
+
+}
+
+#endif
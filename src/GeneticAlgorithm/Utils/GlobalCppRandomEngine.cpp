@@ -0,0 +1,7 @@
+#include "GlobalCppRandomEngine.h"
+
+namespace GeneticAlgorithm::Utils {
+
+    std::default_random_engine GlobalCppRandomEngine::engine;
+
+}
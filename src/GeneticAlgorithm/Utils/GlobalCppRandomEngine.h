@@ -18,8 +18,6 @@ namespace GeneticAlgorithm::Utils {
 
     };
 
-    std::default_random_engine GlobalCppRandomEngine::engine;
-
 }
 
 #endif
@@ -0,0 +1,21 @@
+#include "Trace.h"
+
+namespace GeneticAlgorithm::Utils {
+
+    std::atomic<bool> Trace::enabled(false);
+
+    unsigned long Trace::bufferCapacity = 1UL << 16;
+
+    const std::chrono::steady_clock::time_point Trace::origin = std::chrono::steady_clock::now();
+
+    std::mutex Trace::registryLock;
+
+    std::vector<std::unique_ptr<Trace::Buffer>> Trace::buffers;
+
+    std::map<unsigned long, std::string> Trace::laneNames;
+
+    thread_local Trace::Holder Trace::holder;
+
+    thread_local unsigned long Trace::currentLane = 0;
+
+}
@@ -0,0 +1,274 @@
+#ifndef GENETICALGORITHM_UTILS_TRACE_H
+#define GENETICALGORITHM_UTILS_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <map>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cstdio>
+
+namespace GeneticAlgorithm::Utils {
+
+    /* 事件追踪，输出 Chrome trace / Perfetto 能打开的 JSON
+     *
+     * 每个线程第一次记录事件时拿到自己的环形缓冲区，之后只有这个线程写它：写入事件再用
+     * release 更新计数，不加锁。缓冲区写满后覆盖最早的事件。线程结束后缓冲区留给之后的
+     * 线程继续使用，所以反复创建线程（例如 Multithreading::runContinue()）不会让内存增长。
+     *
+     * 没有开启时每个追踪点只有一次 relaxed 的原子读。事件按“泳道”显示，线程可以用
+     * setLane() 指定自己的泳道和名字，例如每个岛一个泳道。
+     *
+     * write() 应该在没有线程在记录事件的时候调用，例如 join() 之后。
+     */
+    class Trace {
+
+    public:
+
+        // 一个事件，duration 为 0 时是瞬时事件
+        struct Event {
+            const char* name;
+            const char* category;
+            unsigned long lane;
+            unsigned long begin; // 纳秒，从程序启动时算起
+            unsigned long duration;
+            long argument; // 小于 0 时不输出
+        };
+
+        // 记录一段时间的作用域对象，析构时写入一个事件
+        class Scope {
+
+        public:
+
+            Scope(const char* name, const char* category, long argument = -1) {
+                this->name = isEnabled() ? name : nullptr;
+                if (nullptr != this->name) {
+                    this->category = category;
+                    this->argument = argument;
+                    this->begin = now();
+                }
+            }
+
+            ~Scope() {
+                if (nullptr != this->name) {
+                    complete(this->name, this->category, this->begin, now(), this->argument);
+                }
+            }
+
+            Scope(const Scope&) = delete;
+
+            Scope& operator=(const Scope&) = delete;
+
+        private:
+            const char* name;
+            const char* category;
+            long argument;
+            unsigned long begin;
+        };
+
+        /**
+         * 开启追踪
+         *
+         * @param unsigned long capacity 每个线程最多保留的事件数，向上取到 2 的幂，只对之后新建的缓冲区有效
+         * @return void
+         */
+        static void enable(unsigned long capacity = 1UL << 16) {
+            unsigned long size = 1;
+            while (size < capacity) {
+                size <<= 1;
+            }
+            bufferCapacity = size;
+            enabled.store(true, std::memory_order_release);
+        }
+
+        // 关闭追踪，已经记录的事件保留
+        static void disable() {
+            enabled.store(false, std::memory_order_release);
+        }
+
+        // 是否开启了追踪
+        static bool isEnabled() {
+            return enabled.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * 设置当前线程的泳道
+         *
+         * @param unsigned long lane 泳道编号，对应 JSON 里的 tid
+         * @param const std::string& name 泳道的名字
+         * @return void
+         */
+        static void setLane(unsigned long lane, const std::string& name) {
+            currentLane = lane;
+            std::lock_guard<std::mutex> guard(registryLock);
+            laneNames[lane] = name;
+        }
+
+        // 从程序启动时算起的纳秒数
+        static unsigned long now() {
+            return (unsigned long)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+        }
+
+        /**
+         * 记录一段已经结束的时间
+         *
+         * @param const char* name 事件名，必须是字符串常量
+         * @param const char* category 分类，必须是字符串常量
+         * @param unsigned long begin now() 的返回值
+         * @param unsigned long end now() 的返回值
+         * @param long argument 附加的数字，例如代数，小于 0 时不输出
+         * @return void
+         */
+        static void complete(const char* name, const char* category, unsigned long begin, unsigned long end, long argument = -1) {
+            if (!isEnabled()) {
+                return;
+            }
+            Buffer* buffer = currentBuffer();
+            unsigned long count = buffer->count.load(std::memory_order_relaxed);
+            Event& event = buffer->events[count & (buffer->events.size() - 1)];
+            event.name = name;
+            event.category = category;
+            event.lane = currentLane;
+            event.begin = begin;
+            event.duration = end > begin ? end - begin : 0;
+            event.argument = argument;
+            buffer->count.store(count + 1, std::memory_order_release);
+        }
+
+        // 记录一个瞬时事件
+        static void instant(const char* name, const char* category, long argument = -1) {
+            if (!isEnabled()) {
+                return;
+            }
+            unsigned long time = now();
+            complete(name, category, time, time, argument);
+        }
+
+        /**
+         * 按 Chrome trace 的 JSON 格式输出所有缓冲区中的事件
+         *
+         * @param std::ostream& output
+         * @return unsigned long 输出的事件数
+         */
+        static unsigned long write(std::ostream& output) {
+            std::lock_guard<std::mutex> guard(registryLock);
+            char line[512];
+            unsigned long written = 0;
+            output << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+            for (auto& lane : laneNames) {
+                output << (0 == written ? "\n" : ",\n");
+                output << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << lane.first << ",\"args\":{\"name\":\"";
+                writeEscaped(output, lane.second);
+                output << "\"}}";
+                written++;
+            }
+            unsigned long events = 0;
+            for (auto& buffer : buffers) {
+                unsigned long count = buffer->count.load(std::memory_order_acquire);
+                unsigned long size = buffer->events.size();
+                for (unsigned long i = count > size ? count - size : 0; i < count; i++) {
+                    const Event& event = buffer->events[i & (size - 1)];
+                    if (0 == event.duration) {
+                        snprintf(line, sizeof(line), "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%lu",
+                            event.name, event.category, event.begin / 1000.0, event.lane);
+                    } else {
+                        snprintf(line, sizeof(line), "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%lu",
+                            event.name, event.category, event.begin / 1000.0, event.duration / 1000.0, event.lane);
+                    }
+                    output << (0 == written ? "\n" : ",\n") << line;
+                    if (event.argument >= 0) {
+                        output << ",\"args\":{\"value\":" << event.argument << "}";
+                    }
+                    output << "}";
+                    written++;
+                    events++;
+                }
+            }
+            output << "\n]}\n";
+            return events;
+        }
+
+        // 丢弃已经记录的事件
+        static void clear() {
+            std::lock_guard<std::mutex> guard(registryLock);
+            for (auto& buffer : buffers) {
+                buffer->count.store(0, std::memory_order_release);
+            }
+        }
+
+    private:
+
+        // 一个线程的环形缓冲区
+        struct Buffer {
+            std::vector<Event> events;
+            std::atomic<unsigned long> count;
+            bool idle;
+        };
+
+        // 线程结束时把缓冲区标记为空闲
+        struct Holder {
+            Buffer* buffer = nullptr;
+            ~Holder() {
+                if (nullptr != this->buffer) {
+                    std::lock_guard<std::mutex> guard(registryLock);
+                    this->buffer->idle = true;
+                }
+            }
+        };
+
+        static std::atomic<bool> enabled;
+
+        static unsigned long bufferCapacity;
+
+        static const std::chrono::steady_clock::time_point origin;
+
+        static std::mutex registryLock;
+
+        static std::vector<std::unique_ptr<Buffer>> buffers;
+
+        static std::map<unsigned long, std::string> laneNames;
+
+        static thread_local Holder holder;
+
+        static thread_local unsigned long currentLane;
+
+        // 私有，当前线程的缓冲区，第一次调用时取一个空闲的或者新建
+        static Buffer* currentBuffer() {
+            if (nullptr != holder.buffer) {
+                return holder.buffer;
+            }
+            std::lock_guard<std::mutex> guard(registryLock);
+            for (auto& buffer : buffers) {
+                if (buffer->idle) {
+                    buffer->idle = false;
+                    holder.buffer = buffer.get();
+                    return holder.buffer;
+                }
+            }
+            std::unique_ptr<Buffer> buffer(new Buffer());
+            buffer->events.resize(bufferCapacity);
+            buffer->count.store(0, std::memory_order_relaxed);
+            buffer->idle = false;
+            holder.buffer = buffer.get();
+            buffers.push_back(std::move(buffer));
+            return holder.buffer;
+        }
+
+        // 私有，输出 JSON 字符串的内容
+        static void writeEscaped(std::ostream& output, const std::string& text) {
+            for (char c : text) {
+                if ('"' == c || '\\' == c) {
+                    output << '\\';
+                }
+                output << c;
+            }
+        }
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,7 @@
+#include "BatchInference.h"
+
+namespace Inference {
+
+    const unsigned long BatchInference::BLOCK_ROWS;
+
+}
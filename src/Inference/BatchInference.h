@@ -0,0 +1,384 @@
+#ifndef INFERENCE_BATCHINFERENCE_H
+#define INFERENCE_BATCHINFERENCE_H
+
+#include "../Expression/Program.h"
+#include "../Data/MappedFile.h"
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <limits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace Inference {
+
+    /* 多线程批量推理，用训练好的表达式计算大文件中每一行的结果
+     *
+     * 输入文件用 mmap 映射后切成若干块，各个线程取块、解析成按列存储的数据、用
+     * Expression::Program::evaluateBlock() 批量计算，再由调用 run() 的线程按顺序把每块
+     * 的结果直接 write() 到输出文件。同时在处理中的块数有上限，内存占用不随文件大小增长。
+     *
+     * 输入格式：
+     *   CSV：每行一条数据，逗号分隔，第 i 列对应变量 xi ，可以跳过一行表头
+     *   二进制：按行存储的 double（本机字节序），需要指定列数
+     * 输出格式：
+     *   CSV：每行一个结果
+     *   二进制：每条数据一个 double
+     */
+    class BatchInference {
+
+    public:
+
+        /**
+         * @param const Expression::Program& program 表达式，会先化简
+         * @param unsigned long threadNumber 线程数，0 表示使用全部核心
+         */
+        BatchInference(const Expression::Program& program, unsigned long threadNumber = 0) {
+            this->program = program.simplify();
+            this->threadNumber = 0 == threadNumber ? std::thread::hardware_concurrency() : threadNumber;
+            if (0 == this->threadNumber) {
+                this->threadNumber = 1;
+            }
+            this->columnNumber = this->program.getVariableNumber();
+        }
+
+        // 设置输入为二进制格式，columns 为每行的列数；为 0 时输入为 CSV
+        void setBinaryInput(unsigned long columns) {
+            this->binaryInputColumns = columns;
+        }
+
+        // 设置 CSV 输入的第一行是否为表头
+        void setHeader(bool hasHeader) {
+            this->header = hasHeader;
+        }
+
+        // 设置输出为二进制格式
+        void setBinaryOutput(bool binary) {
+            this->binaryOutput = binary;
+        }
+
+        // 设置每块的大小，字节
+        void setChunkSize(unsigned long bytes) {
+            this->chunkSize = bytes < 4096 ? 4096 : bytes;
+        }
+
+        /**
+         * 执行推理
+         *
+         * @param const std::string& inputFile
+         * @param const std::string& outputFile
+         * @return unsigned long 处理的行数
+         */
+        unsigned long run(const std::string& inputFile, const std::string& outputFile) {
+            using namespace std;
+            if (0 != this->binaryInputColumns && this->binaryInputColumns < this->columnNumber) {
+                throw "Error, input has fewer columns than the expression needs, in Inference::BatchInference::run().";
+            }
+            Data::MappedFile input(inputFile);
+            this->split(input);
+            int output = open(outputFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (output < 0) {
+                throw "Error, can not open output file, in Inference::BatchInference::run().";
+            }
+            this->chunks.assign(this->boundaries.size() - 1, Chunk());
+            this->nextChunk = 0;
+            this->written = 0;
+            this->error = nullptr;
+            vector<thread> workers;
+            for (unsigned long i = 0; i < this->threadNumber; i++) {
+                workers.push_back(thread(&BatchInference::work, this, &input));
+            }
+            unsigned long rows = 0;
+            const char* failure = nullptr;
+            for (unsigned long i = 0; i < this->chunks.size(); i++) {
+                unique_lock<mutex> lock(this->lock);
+                this->chunkDone.wait(lock, [this, i]() {
+                    return this->chunks[i].done || nullptr != this->error;
+                });
+                if (nullptr != this->error) {
+                    failure = this->error;
+                    break;
+                }
+                Chunk& chunk = this->chunks[i];
+                lock.unlock();
+                // 计算结果直接写出，不再拷贝
+                bool ok = this->binaryOutput
+                    ? this->writeAll(output, (const char*)chunk.results.data(), chunk.results.size() * sizeof(double))
+                    : this->writeAll(output, chunk.text.data(), chunk.text.size());
+                rows += chunk.results.size();
+                lock.lock();
+                vector<double>().swap(chunk.results);
+                string().swap(chunk.text);
+                this->written = i + 1;
+                this->chunkTaken.notify_all();
+                if (!ok) {
+                    this->error = "Error, write() failed, in Inference::BatchInference::run().";
+                    failure = this->error;
+                    this->chunkTaken.notify_all();
+                    break;
+                }
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+            close(output);
+            if (nullptr != failure) {
+                throw failure;
+            }
+            return rows;
+        }
+
+    private:
+
+        // 一块输入的处理结果
+        struct Chunk {
+            bool done = false;
+            std::vector<double> results;
+            std::string text;
+        };
+
+        // 每次批量计算的行数
+        static const unsigned long BLOCK_ROWS = 1024;
+
+        /** @var Expression::Program 化简后的表达式 */
+        Expression::Program program;
+
+        /** @var unsigned long 线程数 */
+        unsigned long threadNumber;
+
+        /** @var unsigned long 表达式用到的变量个数 */
+        unsigned long columnNumber;
+
+        /** @var unsigned long 二进制输入的列数，0 表示输入是 CSV */
+        unsigned long binaryInputColumns = 0;
+
+        /** @var bool CSV 第一行是否为表头 */
+        bool header = false;
+
+        /** @var bool 是否输出二进制 */
+        bool binaryOutput = false;
+
+        /** @var unsigned long 每块的大小，字节 */
+        unsigned long chunkSize = 4 * 1024 * 1024;
+
+        /** @var std::vector<unsigned long> 各块在文件中的边界 */
+        std::vector<unsigned long> boundaries;
+
+        /** @var std::vector<Chunk> 各块的结果 */
+        std::vector<Chunk> chunks;
+
+        /** @var unsigned long 下一个待处理的块 */
+        unsigned long nextChunk = 0;
+
+        /** @var unsigned long 已经写出的块数 */
+        unsigned long written = 0;
+
+        /** @var const char* 工作线程中发生的错误 */
+        const char* error = nullptr;
+
+        std::mutex lock;
+
+        std::condition_variable chunkDone;
+
+        std::condition_variable chunkTaken;
+
+        // 私有，把文件按行切块
+        void split(Data::MappedFile& input) {
+            const char* data = input.getData();
+            unsigned long size = input.getSize();
+            unsigned long begin = 0, end;
+            this->boundaries.clear();
+            if (this->header && 0 == this->binaryInputColumns) {
+                const char* newline = nullptr == data ? nullptr : (const char*)memchr(data, '\n', size);
+                begin = nullptr == newline ? size : newline - data + 1;
+            }
+            this->boundaries.push_back(begin);
+            if (0 != this->binaryInputColumns) {
+                unsigned long rowBytes = this->binaryInputColumns * sizeof(double);
+                if (0 != size % rowBytes) {
+                    throw "Error, binary input size is not a multiple of the row size, in Inference::BatchInference.";
+                }
+                unsigned long step = std::max(1UL, this->chunkSize / rowBytes) * rowBytes;
+                for (end = begin + step; end < size; end += step) {
+                    this->boundaries.push_back(end);
+                }
+            } else {
+                while (begin < size) {
+                    end = begin + this->chunkSize;
+                    if (end >= size) {
+                        break;
+                    }
+                    const char* newline = (const char*)memchr(data + end, '\n', size - end);
+                    if (nullptr == newline) {
+                        break;
+                    }
+                    begin = newline - data + 1;
+                    this->boundaries.push_back(begin);
+                }
+            }
+            if (this->boundaries.back() != size) {
+                this->boundaries.push_back(size);
+            }
+        }
+
+        // 私有，工作线程
+        void work(Data::MappedFile* input) {
+            using namespace std;
+            unsigned long index;
+            unsigned long window = 2 * this->threadNumber;
+            vector<double> block(max(1UL, this->columnNumber) * BLOCK_ROWS);
+            vector<double> workspace;
+            vector<const double*> columns(max(1UL, this->columnNumber));
+            for (unsigned long c = 0; c < columns.size(); c++) {
+                columns[c] = block.data() + c * BLOCK_ROWS;
+            }
+            while (true) {
+                {
+                    unique_lock<mutex> lock(this->lock);
+                    this->chunkTaken.wait(lock, [this, window]() {
+                        return nullptr != this->error || this->nextChunk >= this->chunks.size() || this->nextChunk < this->written + window;
+                    });
+                    if (nullptr != this->error || this->nextChunk >= this->chunks.size()) {
+                        return;
+                    }
+                    index = this->nextChunk++;
+                }
+                Chunk result;
+                try {
+                    const char* begin = input->getData() + this->boundaries[index];
+                    const char* end = input->getData() + this->boundaries[index + 1];
+                    if (0 != this->binaryInputColumns) {
+                        this->processBinary(begin, end, block, columns, workspace, result);
+                    } else {
+                        this->processCsv(begin, end, block, columns, workspace, result);
+                    }
+                    if (!this->binaryOutput) {
+                        this->format(result);
+                    }
+                } catch (const char* message) {
+                    lock_guard<mutex> lock(this->lock);
+                    this->error = message;
+                    this->chunkDone.notify_all();
+                    this->chunkTaken.notify_all();
+                    return;
+                }
+                lock_guard<mutex> lock(this->lock);
+                result.done = true;
+                swap(this->chunks[index], result);
+                this->chunkDone.notify_all();
+            }
+        }
+
+        // 私有，计算一批数据，结果追加到 result
+        void evaluate(unsigned long rows, std::vector<const double*>& columns, std::vector<double>& workspace, Chunk& result) {
+            unsigned long offset = result.results.size();
+            result.results.resize(offset + rows);
+            this->program.evaluateBlock<double>(columns.data(), rows, result.results.data() + offset, workspace);
+        }
+
+        // 私有，处理一块二进制输入
+        void processBinary(const char* begin, const char* end, std::vector<double>& block, std::vector<const double*>& columns, std::vector<double>& workspace, Chunk& result) {
+            unsigned long width = this->binaryInputColumns;
+            unsigned long total = (end - begin) / (width * sizeof(double));
+            result.results.reserve(total);
+            double value;
+            for (unsigned long first = 0; first < total; first += BLOCK_ROWS) {
+                unsigned long rows = std::min(BLOCK_ROWS, total - first);
+                // 按行存储转成按列存储
+                for (unsigned long r = 0; r < rows; r++) {
+                    const char* row = begin + (first + r) * width * sizeof(double);
+                    for (unsigned long c = 0; c < this->columnNumber; c++) {
+                        memcpy(&value, row + c * sizeof(double), sizeof(double));
+                        block[c * BLOCK_ROWS + r] = value;
+                    }
+                }
+                this->evaluate(rows, columns, workspace, result);
+            }
+        }
+
+        // 私有，处理一块 CSV 输入
+        void processCsv(const char* begin, const char* end, std::vector<double>& block, std::vector<const double*>& columns, std::vector<double>& workspace, Chunk& result) {
+            char field[64];
+            unsigned long rows = 0, column, length;
+            const char* position = begin;
+            const char* fieldEnd;
+            while (position < end) {
+                const char* lineEnd = (const char*)memchr(position, '\n', end - position);
+                if (nullptr == lineEnd) {
+                    lineEnd = end;
+                }
+                const char* contentEnd = lineEnd;
+                if (contentEnd > position && '\r' == contentEnd[-1]) {
+                    contentEnd--;
+                }
+                if (contentEnd == position) { // 跳过空行
+                    position = lineEnd + 1;
+                    continue;
+                }
+                column = 0;
+                while (column < this->columnNumber) {
+                    fieldEnd = (const char*)memchr(position, ',', contentEnd - position);
+                    if (nullptr == fieldEnd) {
+                        fieldEnd = contentEnd;
+                    }
+                    length = std::min((unsigned long)(fieldEnd - position), (unsigned long)sizeof(field) - 1);
+                    memcpy(field, position, length);
+                    field[length] = '\0';
+                    block[column * BLOCK_ROWS + rows] = 0 == length ? std::numeric_limits<double>::quiet_NaN() : strtod(field, nullptr);
+                    column++;
+                    if (fieldEnd == contentEnd) {
+                        break;
+                    }
+                    position = fieldEnd + 1;
+                }
+                for (; column < this->columnNumber; column++) { // 缺少的列
+                    block[column * BLOCK_ROWS + rows] = std::numeric_limits<double>::quiet_NaN();
+                }
+                rows++;
+                if (BLOCK_ROWS == rows) {
+                    this->evaluate(rows, columns, workspace, result);
+                    rows = 0;
+                }
+                position = lineEnd + 1;
+            }
+            if (rows > 0) {
+                this->evaluate(rows, columns, workspace, result);
+            }
+        }
+
+        // 私有，把一块的结果格式化成文本
+        void format(Chunk& result) {
+            char buffer[32];
+            int length;
+            result.text.reserve(result.results.size() * 20);
+            for (double value : result.results) {
+                length = snprintf(buffer, sizeof(buffer), "%.17g\n", value);
+                result.text.append(buffer, length);
+            }
+        }
+
+        // 私有，写出全部数据
+        bool writeAll(int output, const char* data, unsigned long size) {
+            ssize_t count;
+            while (size > 0) {
+                count = write(output, data, size);
+                if (count < 0) {
+                    return false;
+                }
+                data += count;
+                size -= count;
+            }
+            return true;
+        }
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,24 @@
+#include "Op.h"
+
+// 类内已经给出了值，这里是取地址或者按引用传递时需要的定义
+const int Op::ADD;
+const int Op::SUB;
+const int Op::PRO;
+const int Op::DES;
+const int Op::END;
+const int Op::SQRT;
+const int Op::EXP;
+const int Op::LOG;
+const int Op::SIN;
+const int Op::ABS;
+const int Op::MIN;
+const int Op::MAX;
+const int Op::IF;
+
+const int Op::OP_OPERATION;
+const int Op::OP_NUMBER;
+const int Op::OP_VARIABLE;
+
+const int Op::OP_ATTR_LEFT;
+const int Op::OP_ATTR_RIGHT;
+const int Op::OP_ATTR_THIRD;
@@ -2,35 +2,49 @@
 #define OP_H
 
 #include "GNode/Node.h"
+#include "GNode/ArenaTree.h"
+#include "FunctionRegistry.h"
 #include "GeneticAlgorithm/Utils/GlobalCppRandomEngine.h"
 #include <random>
 #include <iostream>
+#include <vector>
+#include <algorithm>
 
 class Op {
 
 public:
 
-    static const int ADD; // 加
-    static const int SUB; // 减
-    static const int PRO; // 乘
-    static const int DES; // 除
-    static const int END; // 停止操作
-
-    static const int OP_OPERATION; // 运算符
-    static const int OP_NUMBER; // 数字
-
-    static const int OP_ATTR_LEFT; // 是左侧的数字
-    static const int OP_ATTR_RIGHT; // 是右侧的数字
+    static const int ADD = 1; // 加
+    static const int SUB = 2; // 减
+    static const int PRO = 3; // 乘
+    static const int DES = 4; // 除
+    static const int END = 5; // 停止操作
+    static const int SQRT = 6; // 开方，sqrt(|a|)
+    static const int EXP = 7; // 指数
+    static const int LOG = 8; // 对数，log(|a|)
+    static const int SIN = 9; // 正弦
+    static const int ABS = 10; // 绝对值
+    static const int MIN = 11; // 最小值
+    static const int MAX = 12; // 最大值
+    static const int IF = 13; // 三元，a > 0 时为 b ，否则为 c
+
+    static const int OP_OPERATION = -1; // 运算符
+    static const int OP_NUMBER = -2; // 数字
+    static const int OP_VARIABLE = -5; // 输入变量，getTypeValue() 是变量的序号
+
+    static const int OP_ATTR_LEFT = -3; // 是左侧的数字
+    static const int OP_ATTR_RIGHT = -4; // 是右侧的数字
+    static const int OP_ATTR_THIRD = -6; // 三元函数的第三个参数
 
 private:
 
     int opType; // OP_OPERATION or OP_NUMBER
 
-    long double opNumber; // value of op if OP_NUMBER
+    long double opNumber = 0.0; // value of op if OP_NUMBER
 
-    int opTypeNumber; // op type value if OP_OPERATION
+    int opTypeNumber = 0; // op type value if OP_OPERATION, index of variable if OP_VARIABLE
 
-    int numberLeftOrRight; // 是左侧的还是右侧的
+    int numberLeftOrRight = 0; // 是左侧的还是右侧的
 
     long double opNumberMin = 0.0;
 
@@ -39,17 +53,60 @@ private:
 public:
 
     static Op* getRandomNumberOp(long double min = 0.0, long double max = 1.0) {
+        return new Op(makeRandomNumberOp(GeneticAlgorithm::Utils::GlobalCppRandomEngine::engine, min, max));
+    }
+
+    // 从 FunctionRegistry 中启用的函数和 END 中随机选一个
+    static Op* getRandomOptionOp() {
+        return new Op(makeRandomOptionOp(GeneticAlgorithm::Utils::GlobalCppRandomEngine::engine));
+    }
+
+    // 同 getRandomNumberOp() ，按值返回，不分配内存，使用调用者的随机数引擎
+    static Op makeRandomNumberOp(std::default_random_engine& engine, long double min = 0.0, long double max = 1.0) {
         using namespace std;
-        using GeneticAlgorithm::Utils::GlobalCppRandomEngine;
         uniform_real_distribution<long double> realDistribution(min, max);
-        return new Op(Op::OP_NUMBER, realDistribution(GlobalCppRandomEngine::engine), min, max);
+        return Op(Op::OP_NUMBER, realDistribution(engine), min, max);
     }
 
-    static Op* getRandomOptionOp() {
+    // 同 getRandomOptionOp() ，按值返回，不分配内存，使用调用者的随机数引擎
+    static Op makeRandomOptionOp(std::default_random_engine& engine) {
         using namespace std;
-        using GeneticAlgorithm::Utils::GlobalCppRandomEngine;
-        uniform_int_distribution<int> opTypeDistribution(ADD, END);
-        return new Op(Op::OP_OPERATION, opTypeDistribution(GlobalCppRandomEngine::engine));
+        // 可选的运算符只在 FunctionRegistry 改变时重新生成，每个线程一份
+        static thread_local vector<int> choices;
+        static thread_local unsigned long choicesVersion = 0;
+        if (choices.empty() || choicesVersion != FunctionRegistry::getVersion()) {
+            choices = FunctionRegistry::getEnabled();
+            choices.push_back(END);
+            sort(choices.begin(), choices.end());
+            choicesVersion = FunctionRegistry::getVersion();
+        }
+        uniform_int_distribution<unsigned long> opTypeDistribution(0, choices.size() - 1);
+        return Op(Op::OP_OPERATION, choices[opTypeDistribution(engine)]);
+    }
+
+    // 尾部的随机终结符：variableNumber 大于 0 时按 variableRate 的概率生成输入变量 x0 到
+    // x(variableNumber-1) ，否则是数字。变量也记住 min 和 max ，之后变异成数字时使用
+    static Op makeRandomTerminalOp(std::default_random_engine& engine, int variableNumber, long double variableRate, long double min = 0.0, long double max = 1.0) {
+        using namespace std;
+        if (variableNumber > 0) {
+            bernoulli_distribution isVariable((double)variableRate);
+            if (isVariable(engine)) {
+                uniform_int_distribution<int> index(0, variableNumber - 1);
+                return makeVariableOp(index(engine), min, max);
+            }
+        }
+        return makeRandomNumberOp(engine, min, max);
+    }
+
+    // 第 slot 个参数对应的属性，0 为 OP_ATTR_LEFT ，1 为 OP_ATTR_RIGHT ，2 为 OP_ATTR_THIRD
+    static int getSlotAttribute(int slot) {
+        if (0 == slot) {
+            return OP_ATTR_LEFT;
+        }
+        if (1 == slot) {
+            return OP_ATTR_RIGHT;
+        }
+        return OP_ATTR_THIRD;
     }
 
     static Op* getRandomOp(long double min = 0.0, long double max = 1.0) {
@@ -62,13 +119,36 @@ public:
         return getRandomOptionOp();
     }
 
+    static Op* getVariableOp(int index) {
+        return new Op(Op::OP_VARIABLE, index);
+    }
+
+    // 输入变量，同时记住变异成数字时的范围
+    static Op makeVariableOp(int index, long double min = 0.0, long double max = 1.0) {
+        Op op(Op::OP_VARIABLE, index);
+        op.opNumberMin = min;
+        op.opNumberMax = max;
+        return op;
+    }
+
     static Op* createLike(Op* source) {
         if (OP_OPERATION == source->getOpType()) {
             return new Op(source->getOpType(), source->getTypeValue());
         }
+        if (OP_VARIABLE == source->getOpType()) {
+            Op* op = new Op(source->getOpType(), source->getTypeValue());
+            op->opNumberMin = source->getMin();
+            op->opNumberMax = source->getMax();
+            return op;
+        }
         return new Op(source->getOpType(), source->getValue(), source->getMin(), source->getMax());
     }
 
+    // 数字 0 ，用于定长数组中的默认值，例如 FixedChromosome
+    Op() {
+        opType = OP_NUMBER;
+    }
+
     Op(int opOpType, long double number, long double min, long double max) {
         opType = opOpType;
         opNumber = number;
@@ -127,83 +207,112 @@ public:
             }
             return;
         }
-        Op* left = nullptr;
-        Op* right = nullptr;
-        Node<Op*>* nodeLeft = nullptr;
-        Node<Op*>* nodeRight = nullptr;
+        if (OP_VARIABLE == opType) {
+            cout << "x" << opTypeNumber;
+            return;
+        }
+        Node<Op*>* children[3] = {nullptr, nullptr, nullptr};
+        int arity = FunctionRegistry::getArity(opTypeNumber);
         for (auto e : node->getNodes()) {
-            if (OP_ATTR_LEFT == e->getValue()->getOpAttribute()) {
-                left = e->getValue();
-                nodeLeft = e;
+            for (int slot = 0; slot < arity; slot++) {
+                if (getSlotAttribute(slot) == e->getValue()->getOpAttribute()) {
+                    children[slot] = e;
+                }
             }
-            if (OP_ATTR_RIGHT == e->getValue()->getOpAttribute()) {
-                right = e->getValue();
-                nodeRight = e;
+        }
+        for (int slot = 0; slot < arity; slot++) {
+            if (nullptr == children[slot]) {
+                cout << "?";
+                return;
             }
         }
-        if (nullptr == left || nullptr == right) {
-            cout << "?";
+        const FunctionRegistry::Function& function = FunctionRegistry::get(opTypeNumber);
+        if (function.infix) {
+            cout << "(";
+            children[0]->getValue()->print(children[0]);
+            cout << function.name;
+            children[1]->getValue()->print(children[1]);
+            cout << ")";
             return;
         }
-        cout << "(";
-        left->print(nodeLeft);
-        if (ADD == opTypeNumber) {
-            cout << "+";
-        }
-        if (SUB == opTypeNumber) {
-            cout << "-";
-        }
-        if (PRO == opTypeNumber) {
-            cout << "*";
-        }
-        if (DES == opTypeNumber) {
-            cout << "/";
+        cout << function.name << "(";
+        for (int slot = 0; slot < arity; slot++) {
+            if (slot > 0) {
+                cout << ",";
+            }
+            children[slot]->getValue()->print(children[slot]);
         }
-        right->print(nodeRight);
         cout << ")";
     }
 
-    long double calculate(GNode::Node<Op*>* node) {
+    long double calculate(GNode::Node<Op*>* node, const long double* variables = nullptr) {
         using namespace std;
         if (OP_NUMBER == opType) {
             return opNumber;
         }
-        long double left = 0;
-        long double right = 0;
+        if (OP_VARIABLE == opType) {
+            return nullptr == variables ? 0 : variables[opTypeNumber];
+        }
+        long double arguments[3] = {0, 0, 0};
+        int arity = FunctionRegistry::getArity(opTypeNumber);
         for (auto e : node->getNodes()) {
-            if (OP_ATTR_LEFT == e->getValue()->getOpAttribute()) {
-                left = e->getValue()->calculate(e);
-            } else {
-                right = e->getValue()->calculate(e);
+            for (int slot = 0; slot < arity; slot++) {
+                if (getSlotAttribute(slot) == e->getValue()->getOpAttribute()) {
+                    arguments[slot] = e->getValue()->calculate(e, variables);
+                }
             }
         }
-        if (ADD == opTypeNumber) {
-            return left + right;
+        return FunctionRegistry::apply<long double>(opTypeNumber, arguments);
+    }
+
+    // 打印 tree 中以 node 为根的表达式，参数按子节点的位置排列
+    void print(const GNode::ArenaTree<Op*>& tree, GNode::ArenaTree<Op*>::Index node) {
+        using namespace std;
+        if (OP_OPERATION != opType) {
+            print(nullptr);
+            return;
         }
-        if (SUB == opTypeNumber) {
-            return left - right;
+        int arity = FunctionRegistry::getArity(opTypeNumber);
+        if ((int)tree.getChildNumber(node) < arity) {
+            cout << "?";
+            return;
         }
-        if (PRO == opTypeNumber) {
-            return left * right;
+        const FunctionRegistry::Function& function = FunctionRegistry::get(opTypeNumber);
+        if (function.infix) {
+            cout << "(";
+            tree.getValue(tree.getChild(node, 0))->print(tree, tree.getChild(node, 0));
+            cout << function.name;
+            tree.getValue(tree.getChild(node, 1))->print(tree, tree.getChild(node, 1));
+            cout << ")";
+            return;
         }
-        if (right < 1E-18) {
-            return 0;
+        cout << function.name << "(";
+        for (int slot = 0; slot < arity; slot++) {
+            if (slot > 0) {
+                cout << ",";
+            }
+            tree.getValue(tree.getChild(node, slot))->print(tree, tree.getChild(node, slot));
         }
-        return left / right;
+        cout << ")";
     }
 
-};
-
-const int Op::ADD = 1;
-const int Op::SUB = 2;
-const int Op::PRO = 3;
-const int Op::DES = 4;
-const int Op::END = 5;
-
-const int Op::OP_OPERATION = -1;
-const int Op::OP_NUMBER = -2;
+    // 计算 tree 中以 node 为根的表达式
+    long double calculate(const GNode::ArenaTree<Op*>& tree, GNode::ArenaTree<Op*>::Index node, const long double* variables = nullptr) {
+        if (OP_NUMBER == opType) {
+            return opNumber;
+        }
+        if (OP_VARIABLE == opType) {
+            return nullptr == variables ? 0 : variables[opTypeNumber];
+        }
+        long double arguments[3] = {0, 0, 0};
+        int arity = FunctionRegistry::getArity(opTypeNumber);
+        auto children = tree.getNodes(node);
+        for (int slot = 0; slot < arity && slot < (int)children.size(); slot++) {
+            arguments[slot] = tree.getValue(children[slot])->calculate(tree, children[slot], variables);
+        }
+        return FunctionRegistry::apply<long double>(opTypeNumber, arguments);
+    }
 
-const int Op::OP_ATTR_LEFT = -3;
-const int Op::OP_ATTR_RIGHT = -4;
+};
 
 #endif
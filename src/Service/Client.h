@@ -0,0 +1,109 @@
+#ifndef SERVICE_CLIENT_H
+#define SERVICE_CLIENT_H
+
+#include "Protocol.h"
+#include <string>
+#include <map>
+#include <functional>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace Service {
+
+    /* 本地服务的客户端，一个对象是一个连接
+     */
+    class Client {
+
+    public:
+
+        // 连接到 socketPath 上的服务
+        Client(const std::string& socketPath) {
+            sockaddr_un address;
+            Protocol::makeAddress(socketPath, address);
+            this->fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if (this->fd < 0) {
+                throw "Error, socket() failed, in Service::Client.";
+            }
+            if (0 != ::connect(this->fd, (sockaddr*)&address, sizeof(address))) {
+                ::close(this->fd);
+                throw "Error, can not connect to the server, in Service::Client.";
+            }
+        }
+
+        ~Client() {
+            ::close(this->fd);
+        }
+
+        Client(const Client&) = delete;
+
+        Client& operator=(const Client&) = delete;
+
+        /**
+         * 提交任务并等待结果，字段见 Server
+         *
+         * @param const std::map<std::string, std::string>& job
+         * @param const std::function<void(const Protocol::Frame&)>& callback 收到 ACCEPTED 和 PROGRESS 时调用，可以为空
+         * @return Protocol::Frame 最后的 RESULT 或者 ERROR
+         */
+        Protocol::Frame submit(const std::map<std::string, std::string>& job, const std::function<void(const Protocol::Frame&)>& callback = nullptr) {
+            this->send(Protocol::SUBMIT, Protocol::formatFields(job));
+            Protocol::Frame frame;
+            while (true) {
+                this->receive(frame);
+                if (Protocol::RESULT == frame.type || Protocol::ERROR == frame.type) {
+                    return frame;
+                }
+                if (callback) {
+                    callback(frame);
+                }
+            }
+        }
+
+        /**
+         * 查询服务的状态：工作线程数、空闲线程数、运行和排队的任务数等
+         *
+         * @return std::map<std::string, std::string>
+         */
+        std::map<std::string, std::string> getStatus() {
+            this->send(Protocol::STATUS, "");
+            Protocol::Frame frame;
+            this->receive(frame);
+            if (Protocol::STATUS != frame.type) {
+                throw "Error, unexpected reply, in Service::Client::getStatus().";
+            }
+            return Protocol::parseFields(frame.payload);
+        }
+
+        /**
+         * 让服务停止，排队和运行中的任务都会被取消
+         *
+         * @return void
+         */
+        void shutdown() {
+            this->send(Protocol::SHUTDOWN, "");
+        }
+
+    private:
+        // 描述符
+        int fd;
+
+        // 私有，发送一帧
+        void send(char type, const std::string& payload) {
+            if (!Protocol::writeFrame(this->fd, type, payload)) {
+                throw "Error, connection closed, in Service::Client.";
+            }
+        }
+
+        // 私有，接收一帧
+        void receive(Protocol::Frame& frame) {
+            if (!Protocol::readFrame(this->fd, frame)) {
+                throw "Error, connection closed, in Service::Client.";
+            }
+        }
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef SERVICE_CONNECTION_H
+#define SERVICE_CONNECTION_H
+
+#include "Protocol.h"
+#include <string>
+#include <mutex>
+#include <unistd.h>
+#include <sys/socket.h>
+
+namespace Service {
+
+    /* 服务端的一个客户端连接
+     *
+     * 同一个连接上的多个任务会从不同的线程发送进度，发送时加锁保证帧不交错。客户端断开
+     * 或者发送失败以后 isOpen() 返回 false ，任务据此提前结束。最后一个引用释放时关闭描述符。
+     */
+    class Connection {
+
+    public:
+
+        Connection(int fd) : fd(fd) {
+        }
+
+        ~Connection() {
+            ::close(this->fd);
+        }
+
+        Connection(const Connection&) = delete;
+
+        Connection& operator=(const Connection&) = delete;
+
+        // 发送一帧，连接已经断开时返回 false
+        bool send(char type, const std::string& payload) {
+            std::lock_guard<std::mutex> guard(this->lock);
+            if (this->open && !Protocol::writeFrame(this->fd, type, payload)) {
+                this->open = false;
+            }
+            return this->open;
+        }
+
+        // 客户端是否还在
+        bool isOpen() {
+            std::lock_guard<std::mutex> guard(this->lock);
+            return this->open;
+        }
+
+        // 断开连接，阻塞在读这个连接的线程会立刻返回
+        void close() {
+            std::lock_guard<std::mutex> guard(this->lock);
+            this->open = false;
+            ::shutdown(this->fd, SHUT_RDWR);
+        }
+
+        // 描述符，只用于读
+        int getFd() {
+            return this->fd;
+        }
+
+    private:
+        // 描述符
+        int fd;
+        // 连接是否可用
+        bool open = true;
+        // 保护发送
+        std::mutex lock;
+    };
+
+}
+
+#endif
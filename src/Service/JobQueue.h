@@ -0,0 +1,101 @@
+#ifndef SERVICE_JOBQUEUE_H
+#define SERVICE_JOBQUEUE_H
+
+#include "Connection.h"
+#include "../Data/Dataset.h"
+#include "../Fitness/Objective.h"
+#include "../Expression/Program.h"
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+
+namespace Service {
+
+    // 一个进化任务
+    struct Job {
+        // 任务编号，从 1 开始
+        unsigned long id;
+        // 优先级，越大越先运行
+        long priority;
+        // 最多使用的线程数，也就是岛的个数
+        unsigned long cores;
+        // 种群大小
+        unsigned long population;
+        // 染色体长度
+        unsigned long length;
+        // 初始种群中数字的范围
+        long double min;
+        long double max;
+        // 最大迭代次数
+        unsigned long generations;
+        // 达到多大的适应度就停止
+        long double stopFitness;
+        // 每次迭代保留多少个上一代的个体
+        unsigned long keep;
+        // 变异概率
+        long double r;
+        // 每隔多少代报告一次进度，同时在岛之间交换最好的个体
+        unsigned long progress;
+        // 初始种群的种子
+        std::vector<Expression::Program> seeds;
+        // 数据集和适应度函数，都是 nullptr 时使用原来的适应度
+        std::shared_ptr<const Data::Dataset> dataset;
+        std::shared_ptr<const Fitness::Objective> objective;
+        // 提交任务的连接，进度和结果发回这里
+        std::shared_ptr<Connection> connection;
+        // 提交的时间
+        std::chrono::steady_clock::time_point submitted;
+    };
+
+    /* 按优先级排队的任务
+     *
+     * 优先级高的先运行，相同时先提交的先运行。只看排在最前面的任务：它还不能开始（例如
+     * 空闲的线程不够）时后面的任务也等待，不让小任务一直插队把大任务饿死。
+     */
+    class JobQueue {
+
+    public:
+
+        // 加入队列
+        void push(const std::shared_ptr<Job>& job) {
+            this->jobs[Key(-job->priority, job->id)] = job;
+        }
+
+        // 排在最前面的任务满足 canStart 时取出，否则返回 nullptr
+        std::shared_ptr<Job> take(const std::function<bool(const Job&)>& canStart) {
+            if (this->jobs.empty() || !canStart(*this->jobs.begin()->second)) {
+                return std::shared_ptr<Job>();
+            }
+            std::shared_ptr<Job> job = this->jobs.begin()->second;
+            this->jobs.erase(this->jobs.begin());
+            return job;
+        }
+
+        // 取出所有任务
+        std::vector<std::shared_ptr<Job>> clear() {
+            std::vector<std::shared_ptr<Job>> result;
+            for (auto& e : this->jobs) {
+                result.push_back(e.second);
+            }
+            this->jobs.clear();
+            return result;
+        }
+
+        // 排队的任务数量
+        unsigned long size() {
+            return this->jobs.size();
+        }
+
+    private:
+        // 负的优先级和任务编号，从小到大就是运行的顺序
+        typedef std::pair<long, unsigned long> Key;
+        // 排队的任务
+        std::map<Key, std::shared_ptr<Job>> jobs;
+    };
+
+}
+
+#endif
@@ -0,0 +1,15 @@
+#include "Protocol.h"
+
+namespace Service {
+
+    // 类内已经给出了值，这里是按引用传递时需要的定义
+    const char Protocol::SUBMIT;
+    const char Protocol::ACCEPTED;
+    const char Protocol::PROGRESS;
+    const char Protocol::RESULT;
+    const char Protocol::ERROR;
+    const char Protocol::STATUS;
+    const char Protocol::SHUTDOWN;
+    const unsigned long Protocol::MAX_FRAME;
+
+}
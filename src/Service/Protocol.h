@@ -0,0 +1,203 @@
+#ifndef SERVICE_PROTOCOL_H
+#define SERVICE_PROTOCOL_H
+
+#include <string>
+#include <map>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace Service {
+
+    /* 本地服务的帧协议
+     *
+     * 每一帧是 4 字节大端序的长度 n ，1 字节的类型，再跟 n 字节的内容。内容是若干行
+     * "键=值"，有的帧在字段后面空一行再跟正文（例如 RESULT 的正文是 Chromosome::save()
+     * 的格式）。客户端发 SUBMIT 、STATUS 或 SHUTDOWN ，服务端对 SUBMIT 先回 ACCEPTED ，
+     * 之后同一个连接上不断发 PROGRESS ，最后是 RESULT 或者 ERROR 。
+     */
+    class Protocol {
+
+    public:
+
+        // 帧的类型
+        static const char SUBMIT = 'S'; // 客户端提交任务
+        static const char ACCEPTED = 'A'; // 任务进入队列，字段 job 是任务编号
+        static const char PROGRESS = 'P'; // 任务的进度
+        static const char RESULT = 'R'; // 任务完成，正文是最优个体
+        static const char ERROR = 'E'; // 任务失败或者请求有误，字段 message 是原因
+        static const char STATUS = 'Q'; // 查询服务状态，服务端用同样的类型回复
+        static const char SHUTDOWN = 'X'; // 停止服务
+
+        // 一帧内容的最大长度
+        static const unsigned long MAX_FRAME = 16UL << 20;
+
+        // 一帧
+        struct Frame {
+            char type;
+            std::string payload;
+        };
+
+        /**
+         * 读一帧，对方关闭连接时返回 false
+         *
+         * @param int fd
+         * @param Frame& frame
+         * @return bool
+         */
+        static bool readFrame(int fd, Frame& frame) {
+            unsigned char header[5];
+            if (!readAll(fd, header, sizeof(header))) {
+                return false;
+            }
+            unsigned long length = ((unsigned long)header[0] << 24) | ((unsigned long)header[1] << 16) | ((unsigned long)header[2] << 8) | header[3];
+            if (length > MAX_FRAME) {
+                throw "Error, frame too large, in Service::Protocol::readFrame().";
+            }
+            frame.type = (char)header[4];
+            frame.payload.resize(length);
+            if (length > 0 && !readAll(fd, &frame.payload[0], length)) {
+                throw "Error, connection closed inside a frame, in Service::Protocol::readFrame().";
+            }
+            return true;
+        }
+
+        /**
+         * 写一帧，对方已经关闭连接时返回 false
+         *
+         * @param int fd
+         * @param char type
+         * @param const std::string& payload
+         * @return bool
+         */
+        static bool writeFrame(int fd, char type, const std::string& payload) {
+            if (payload.size() > MAX_FRAME) {
+                throw "Error, frame too large, in Service::Protocol::writeFrame().";
+            }
+            unsigned long length = payload.size();
+            std::string frame(5, '\0');
+            frame[0] = (char)(length >> 24);
+            frame[1] = (char)(length >> 16);
+            frame[2] = (char)(length >> 8);
+            frame[3] = (char)length;
+            frame[4] = type;
+            frame += payload;
+            return writeAll(fd, frame.data(), frame.size());
+        }
+
+        /**
+         * 解析 "键=值" 的行，遇到空行停止，没有 "=" 的行忽略
+         *
+         * @param const std::string& payload
+         * @return std::map<std::string, std::string>
+         */
+        static std::map<std::string, std::string> parseFields(const std::string& payload) {
+            std::map<std::string, std::string> fields;
+            std::string::size_type begin = 0;
+            while (begin < payload.size()) {
+                std::string::size_type end = payload.find('\n', begin);
+                if (std::string::npos == end) {
+                    end = payload.size();
+                }
+                if (end == begin) {
+                    break;
+                }
+                std::string::size_type equal = payload.find('=', begin);
+                if (equal < end) {
+                    fields[payload.substr(begin, equal - begin)] = payload.substr(equal + 1, end - equal - 1);
+                }
+                begin = end + 1;
+            }
+            return fields;
+        }
+
+        /**
+         * 字段后面的正文，没有时返回空字符串
+         *
+         * @param const std::string& payload
+         * @return std::string
+         */
+        static std::string getBody(const std::string& payload) {
+            if (0 == payload.compare(0, 1, "\n")) {
+                return payload.substr(1);
+            }
+            std::string::size_type separator = payload.find("\n\n");
+            return std::string::npos == separator ? std::string() : payload.substr(separator + 2);
+        }
+
+        /**
+         * 把字段格式化成 "键=值" 的行
+         *
+         * @param const std::map<std::string, std::string>& fields
+         * @return std::string
+         */
+        static std::string formatFields(const std::map<std::string, std::string>& fields) {
+            std::string payload;
+            for (auto& field : fields) {
+                payload += field.first + "=" + field.second + "\n";
+            }
+            return payload;
+        }
+
+        /**
+         * 填写 Unix 域套接字的地址
+         *
+         * @param const std::string& path
+         * @param sockaddr_un& address
+         * @return void
+         */
+        static void makeAddress(const std::string& path, sockaddr_un& address) {
+            address = sockaddr_un();
+            address.sun_family = AF_UNIX;
+            if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+                throw "Error, bad socket path, in Service::Protocol::makeAddress().";
+            }
+            path.copy(address.sun_path, path.size());
+        }
+
+    private:
+
+        // 私有，读满 size 个字节，一开始就遇到连接关闭时返回 false
+        static bool readAll(int fd, void* buffer, unsigned long size) {
+            char* p = static_cast<char*>(buffer);
+            unsigned long done = 0;
+            while (done < size) {
+                ssize_t n = ::recv(fd, p + done, size - done, 0);
+                if (n < 0 && EINTR == errno) {
+                    continue;
+                }
+                if (n <= 0) {
+                    if (0 == done) {
+                        return false;
+                    }
+                    throw "Error, connection closed inside a frame, in Service::Protocol.";
+                }
+                done += (unsigned long)n;
+            }
+            return true;
+        }
+
+        // 私有，写完 size 个字节，不产生 SIGPIPE
+        static bool writeAll(int fd, const void* buffer, unsigned long size) {
+            const char* p = static_cast<const char*>(buffer);
+            unsigned long done = 0;
+            while (done < size) {
+                ssize_t n = ::send(fd, p + done, size - done, MSG_NOSIGNAL);
+                if (n < 0 && EINTR == errno) {
+                    continue;
+                }
+                if (n <= 0) {
+                    return false;
+                }
+                done += (unsigned long)n;
+            }
+            return true;
+        }
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,483 @@
+#ifndef SERVICE_SERVER_H
+#define SERVICE_SERVER_H
+
+#include "Protocol.h"
+#include "Connection.h"
+#include "JobQueue.h"
+#include "WorkerPool.h"
+#include "../GeneticAlgorithm/Multithreading.h"
+#include "../GeneticAlgorithm/Chromosome.h"
+#include "../Expression/Parser.h"
+#include "../Data/Dataset.h"
+#include "../Fitness/Objective.h"
+#include "../Op.h"
+#include <string>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <sstream>
+#include <iostream>
+#include <cstdlib>
+#include <chrono>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+namespace Service {
+
+    /**
+     * 常驻的本地进化服务
+     *
+     * 在 Unix 域套接字上接收任务（帧格式见 Protocol ），进程一直运行，工作线程和读过的数据集
+     * 都留在内存里，短任务不再有启动进程和读取数据的开销。
+     *   数据集：按路径缓存，文件修改时间变了才重新读取，同一个数据集和指标共用一个适应度函数
+     *   调度：任务按优先级排队（ JobQueue ），每个任务最多使用 cores 个工作线程，每个线程
+     *   运行一个岛，空闲的线程够用时才开始
+     *   进度：每 progress 代在岛之间交换最好的个体，同时给客户端发一帧 PROGRESS ，客户端
+     *   断开以后任务提前结束
+     *
+     * 每个岛是一个 MainProcess ，有自己的随机数引擎、适应度函数和尾部的输入变量（
+     * GeneticAlgorithm::EvolutionContext ），使用不同数据集和指标的任务可以同时运行。
+     *
+     * 任务的字段，都可以省略：
+     *   population=1000 length=50 min=0 max=10 generations=300 stop=0.9999 keep=population/2
+     *   r=0.1 cores=1 priority=0 progress=10 data=CSV 文件 header=0 metric=mse seed=中缀表达式
+     * 有 data 时 min 和 max 默认是 -2 和 2 ，相对路径相对于服务的工作目录。
+     */
+    class Server {
+
+    public:
+
+        // 在 socketPath 上监听，workerNumber 为 0 时使用硬件线程数
+        Server(const std::string& socketPath, unsigned long workerNumber = 0) : socketPath(socketPath), pool(workerNumber), stopping(false) {
+            this->freeCores = this->pool.getWorkerNumber();
+        }
+
+        Server(const Server&) = delete;
+
+        Server& operator=(const Server&) = delete;
+
+        // 设置debug模式，为true的时候打印每个任务的开始和结束
+        void setDebug(bool enableDebug) {
+            this->debug = enableDebug;
+        }
+
+        // 监听并处理请求，收到 SHUTDOWN 或者调用 stop() 以后取消所有任务并返回
+        void serve() {
+            int listenFd = this->listen();
+            while (!this->stopping) {
+                pollfd waiting = {listenFd, POLLIN, 0};
+                if (::poll(&waiting, 1, 200) <= 0) {
+                    continue;
+                }
+                int fd = ::accept(listenFd, nullptr, nullptr);
+                if (fd < 0) {
+                    continue;
+                }
+                std::shared_ptr<Connection> connection(new Connection(fd));
+                {
+                    std::lock_guard<std::mutex> guard(this->lock);
+                    this->connections.insert(connection);
+                    this->readers++;
+                }
+                std::thread([this, connection]() {
+                    this->read(connection);
+                }).detach();
+            }
+            ::close(listenFd);
+            ::unlink(this->socketPath.c_str());
+            this->finish();
+        }
+
+        // 停止服务，可以在其它线程调用
+        void stop() {
+            this->stopping = true;
+        }
+
+    private:
+        // 缓存的数据集
+        struct DatasetEntry {
+            // 读取时文件的修改时间
+            time_t modified;
+            std::shared_ptr<const Data::Dataset> dataset;
+            // 按指标名字缓存的适应度函数
+            std::map<std::string, std::shared_ptr<const Fitness::Objective>> objectives;
+        };
+
+        // 套接字路径
+        std::string socketPath;
+        // 工作线程
+        WorkerPool pool;
+        // 是否在停止
+        std::atomic<bool> stopping;
+        // 是否开启调试
+        bool debug = false;
+        // 保护以下的调度状态
+        std::mutex lock;
+        // 任务结束或者读连接的线程结束
+        std::condition_variable finished;
+        // 排队的任务
+        JobQueue queue;
+        // 空闲的工作线程数
+        unsigned long freeCores = 0;
+        // 正在运行的任务数
+        unsigned long runningJobs = 0;
+        // 最后一个任务的编号
+        unsigned long lastJobId = 0;
+        // 所有客户端连接
+        std::set<std::shared_ptr<Connection>> connections;
+        // 读连接的线程数
+        unsigned long readers = 0;
+        // 保护 datasets ，读文件时不占用调度的锁
+        std::mutex datasetLock;
+        // 按 "表头标志:路径" 缓存的数据集
+        std::map<std::string, DatasetEntry> datasets;
+
+        // 私有，创建监听的套接字，路径上残留的套接字文件会被删除
+        int listen() {
+            sockaddr_un address;
+            Protocol::makeAddress(this->socketPath, address);
+            struct stat fileStat;
+            if (0 == ::stat(this->socketPath.c_str(), &fileStat)) {
+                if (!S_ISSOCK(fileStat.st_mode)) {
+                    throw "Error, socket path exists and is not a socket, in Service::Server::serve().";
+                }
+                ::unlink(this->socketPath.c_str());
+            }
+            int listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if (listenFd < 0) {
+                throw "Error, socket() failed, in Service::Server::serve().";
+            }
+            if (0 != ::bind(listenFd, (sockaddr*)&address, sizeof(address)) || 0 != ::listen(listenFd, 64)) {
+                ::close(listenFd);
+                throw "Error, can not listen on the socket path, in Service::Server::serve().";
+            }
+            return listenFd;
+        }
+
+        // 私有，处理一个连接上的请求，直到客户端断开
+        void read(std::shared_ptr<Connection> connection) {
+            Protocol::Frame frame;
+            try {
+                while (Protocol::readFrame(connection->getFd(), frame)) {
+                    if (Protocol::SUBMIT == frame.type) {
+                        this->submit(connection, Protocol::parseFields(frame.payload));
+                    } else if (Protocol::STATUS == frame.type) {
+                        connection->send(Protocol::STATUS, Protocol::formatFields(this->getStatus()));
+                    } else if (Protocol::SHUTDOWN == frame.type) {
+                        this->stop();
+                    } else {
+                        connection->send(Protocol::ERROR, "message=Error, unknown frame type, in Service::Server.\n");
+                    }
+                }
+            } catch (const char* message) {
+                connection->send(Protocol::ERROR, std::string("message=") + message + "\n");
+            }
+            // 客户端断开以后它的任务不再需要
+            connection->close();
+            std::lock_guard<std::mutex> guard(this->lock);
+            this->connections.erase(connection);
+            connection.reset();
+            this->readers--;
+            this->finished.notify_all();
+        }
+
+        // 私有，检查任务并放进队列
+        void submit(const std::shared_ptr<Connection>& connection, const std::map<std::string, std::string>& fields) {
+            std::shared_ptr<Job> job;
+            try {
+                job = this->makeJob(fields);
+            } catch (const char* message) {
+                connection->send(Protocol::ERROR, std::string("message=") + message + "\n");
+                return;
+            }
+            job->connection = connection;
+            {
+                std::lock_guard<std::mutex> guard(this->lock);
+                job->id = ++this->lastJobId;
+            }
+            // 先回复编号，再进入队列，保证 ACCEPTED 在这个任务的 PROGRESS 之前
+            std::map<std::string, std::string> accepted;
+            accepted["job"] = std::to_string(job->id);
+            connection->send(Protocol::ACCEPTED, Protocol::formatFields(accepted));
+            std::lock_guard<std::mutex> guard(this->lock);
+            if (this->stopping) {
+                connection->send(Protocol::ERROR, "message=Error, server is stopping, in Service::Server.\n");
+                return;
+            }
+            this->queue.push(job);
+            this->schedule();
+        }
+
+        // 私有，按字段创建任务，字段有误时抛出异常
+        std::shared_ptr<Job> makeJob(const std::map<std::string, std::string>& fields) {
+            static const char* names[] = {
+                "population", "length", "min", "max", "generations", "stop", "keep", "r",
+                "cores", "priority", "progress", "data", "header", "metric", "seed"
+            };
+            for (auto& field : fields) {
+                if (std::find(std::begin(names), std::end(names), field.first) == std::end(names)) {
+                    throw "Error, unknown job field, in Service::Server.";
+                }
+            }
+            // 有数据集时数字的默认范围和 ./GEP.out fit 相同
+            bool hasData = fields.end() != fields.find("data");
+            std::shared_ptr<Job> job(new Job());
+            job->population = getCount(fields, "population", 1000);
+            job->length = getCount(fields, "length", 50);
+            job->min = getNumber(fields, "min", hasData ? -2.0L : 0.0L);
+            job->max = getNumber(fields, "max", hasData ? 2.0L : 10.0L);
+            job->generations = getCount(fields, "generations", 300);
+            job->stopFitness = getNumber(fields, "stop", 0.9999L);
+            job->keep = getCount(fields, "keep", job->population / 2);
+            job->r = getNumber(fields, "r", 0.1L);
+            job->cores = getCount(fields, "cores", 1);
+            job->priority = (long)getNumber(fields, "priority", 0);
+            job->progress = getCount(fields, "progress", 10);
+            if (job->population < 2 || job->keep >= job->population) {
+                throw "Error, keep must < population, in Service::Server.";
+            }
+            if (job->length < 8) {
+                throw "Error, length must >= 8, in Service::Server.";
+            }
+            job->cores = job->cores < 1 ? 1 : (job->cores > this->pool.getWorkerNumber() ? this->pool.getWorkerNumber() : job->cores);
+            job->progress = job->progress < 1 ? 1 : job->progress;
+            auto seed = fields.find("seed");
+            if (fields.end() != seed) {
+                job->seeds.push_back(Expression::Parser::parse(seed->second));
+            }
+            auto data = fields.find("data");
+            if (fields.end() != data) {
+                auto metric = fields.find("metric");
+                this->loadObjective(*job, data->second, 0 != getNumber(fields, "header", 0), fields.end() == metric ? "mse" : metric->second);
+            }
+            job->submitted = std::chrono::steady_clock::now();
+            return job;
+        }
+
+        // 私有，读取数字字段
+        static long double getNumber(const std::map<std::string, std::string>& fields, const char* name, long double defaultValue) {
+            auto field = fields.find(name);
+            if (fields.end() == field) {
+                return defaultValue;
+            }
+            char* end;
+            long double value = std::strtold(field->second.c_str(), &end);
+            if (field->second.empty() || '\0' != *end || value != value) {
+                throw "Error, bad number in job field, in Service::Server.";
+            }
+            return value;
+        }
+
+        // 私有，读取非负整数字段
+        static unsigned long getCount(const std::map<std::string, std::string>& fields, const char* name, unsigned long defaultValue) {
+            long double value = getNumber(fields, name, defaultValue);
+            if (value < 0 || value > 1e15L || value != (unsigned long)value) {
+                throw "Error, bad count in job field, in Service::Server.";
+            }
+            return (unsigned long)value;
+        }
+
+        // 私有，找到或者读取数据集，以及它对应指标的适应度函数
+        void loadObjective(Job& job, const std::string& path, bool header, const std::string& metric) {
+            std::lock_guard<std::mutex> guard(this->datasetLock);
+            struct stat fileStat;
+            if (0 != ::stat(path.c_str(), &fileStat)) {
+                throw "Error, can not open dataset, in Service::Server.";
+            }
+            DatasetEntry& entry = this->datasets[(header ? "1:" : "0:") + path];
+            if (!entry.dataset || entry.modified != fileStat.st_mtime) {
+                // 正在运行的任务仍然持有旧的数据集
+                entry.dataset = std::make_shared<const Data::Dataset>(Data::Dataset::fromCsv(path, header));
+                entry.modified = fileStat.st_mtime;
+                entry.objectives.clear();
+            }
+            std::shared_ptr<const Fitness::Objective>& objective = entry.objectives[metric];
+            if (!objective) {
+                try {
+                    objective.reset(Fitness::Objective::create(metric, *entry.dataset));
+                } catch (const char* message) {
+                    entry.objectives.erase(metric);
+                    throw;
+                }
+            }
+            job.dataset = entry.dataset;
+            job.objective = objective;
+        }
+
+        // 私有，调用时持有 lock ，开始所有能开始的任务
+        void schedule() {
+            while (!this->stopping) {
+                std::shared_ptr<Job> job = this->queue.take([this](const Job& job) -> bool {
+                    return job.cores <= this->freeCores;
+                });
+                if (!job) {
+                    return;
+                }
+                this->freeCores -= job->cores;
+                this->runningJobs++;
+                if (this->debug) {
+                    std::cout << "任务" << job->id << "开始，线程数=" << job->cores << "，排队" << this->queue.size() << "个" << std::endl;
+                }
+                this->pool.post([this, job]() {
+                    this->run(job);
+                });
+            }
+        }
+
+        // 私有，在工作线程上运行一个任务，每个岛一个线程
+        void run(std::shared_ptr<Job> job) {
+            using namespace std::chrono;
+            using GeneticAlgorithm::MainProcess;
+            steady_clock::time_point started = steady_clock::now();
+            const char* error = nullptr;
+            try {
+                // 每个岛有自己的随机数引擎，种子在创建时取，岛之间和任务之间不共用
+                GeneticAlgorithm::Multithreading islands(job->cores);
+                islands.setDebug(false);
+                islands.setSeeds(job->seeds);
+                islands.setObjective(job->objective.get());
+                unsigned long done = 0;
+                bool first = true;
+                while (true) {
+                    unsigned long count = job->progress < job->generations - done ? job->progress : job->generations - done;
+                    this->parallel(job->cores, [&islands, &job, first, count](unsigned long island) {
+                        MainProcess* process = islands.getIsland(island);
+                        if (first) {
+                            process->run(job->population, job->length, job->min, job->max, count, job->stopFitness, job->keep, job->r);
+                        } else {
+                            process->runContinue(count, job->stopFitness, job->keep, job->r);
+                        }
+                    });
+                    done += count;
+                    first = false;
+                    std::map<std::string, std::string> progress;
+                    progress["job"] = std::to_string(job->id);
+                    progress["generation"] = std::to_string(done);
+                    progress["fitness"] = formatNumber(islands.getMaxFitness());
+                    if (!job->connection->send(Protocol::PROGRESS, Protocol::formatFields(progress)) || this->stopping) {
+                        error = "Error, job cancelled, in Service::Server.";
+                        break;
+                    }
+                    if (done >= job->generations || islands.getMaxFitness() >= job->stopFitness) {
+                        std::map<std::string, std::string> result;
+                        result["job"] = progress["job"];
+                        result["generation"] = progress["generation"];
+                        result["fitness"] = progress["fitness"];
+                        result["wait_ms"] = std::to_string(duration_cast<milliseconds>(started - job->submitted).count());
+                        result["run_ms"] = std::to_string(duration_cast<milliseconds>(steady_clock::now() - started).count());
+                        std::ostringstream model;
+                        islands.getMaxFitnessChromosome()->save(model);
+                        job->connection->send(Protocol::RESULT, Protocol::formatFields(result) + "\n" + model.str());
+                        break;
+                    }
+                    islands.exchange();
+                }
+            } catch (const char* message) {
+                error = message;
+            } catch (...) {
+                error = "Error, unexpected exception, in Service::Server.";
+            }
+            if (nullptr != error) {
+                job->connection->send(Protocol::ERROR, "job=" + std::to_string(job->id) + "\nmessage=" + error + "\n");
+            }
+            std::lock_guard<std::mutex> guard(this->lock);
+            this->freeCores += job->cores;
+            this->runningJobs--;
+            if (this->debug) {
+                std::cout << "任务" << job->id << (nullptr == error ? "完成" : "失败") << "，用时" << duration_cast<milliseconds>(steady_clock::now() - started).count() << "ms" << std::endl;
+            }
+            job.reset();
+            this->schedule();
+            this->finished.notify_all();
+        }
+
+        // 私有，island 从 0 到 count - 1 同时运行，0 在当前线程上，其余的交给工作线程
+        void parallel(unsigned long count, const std::function<void(unsigned long)>& function) {
+            std::mutex latchLock;
+            std::condition_variable latch;
+            unsigned long left = count;
+            const char* error = nullptr;
+            auto task = [&](unsigned long island) {
+                const char* message = nullptr;
+                try {
+                    function(island);
+                } catch (const char* e) {
+                    message = e;
+                } catch (...) {
+                    message = "Error, unexpected exception, in Service::Server.";
+                }
+                std::lock_guard<std::mutex> guard(latchLock);
+                error = nullptr == error ? message : error;
+                if (0 == --left) {
+                    latch.notify_all();
+                }
+            };
+            // 调度时已经为这个任务留出了 count 个线程，这些任务不会等不到线程
+            for (unsigned long island = 1; island < count; island++) {
+                this->pool.post([&task, island]() {
+                    task(island);
+                });
+            }
+            task(0);
+            std::unique_lock<std::mutex> guard(latchLock);
+            latch.wait(guard, [&left]() -> bool {
+                return 0 == left;
+            });
+            if (nullptr != error) {
+                throw error;
+            }
+        }
+
+        // 私有，服务的状态
+        std::map<std::string, std::string> getStatus() {
+            std::map<std::string, std::string> status;
+            std::lock_guard<std::mutex> guard(this->lock);
+            status["workers"] = std::to_string(this->pool.getWorkerNumber());
+            status["idle"] = std::to_string(this->freeCores);
+            status["running"] = std::to_string(this->runningJobs);
+            status["queued"] = std::to_string(this->queue.size());
+            status["jobs"] = std::to_string(this->lastJobId);
+            std::lock_guard<std::mutex> datasetGuard(this->datasetLock);
+            status["datasets"] = std::to_string(this->datasets.size());
+            return status;
+        }
+
+        // 私有，停止时取消排队的任务，等待运行中的任务和读连接的线程结束
+        void finish() {
+            std::unique_lock<std::mutex> guard(this->lock);
+            for (auto& job : this->queue.clear()) {
+                job->connection->send(Protocol::ERROR, "job=" + std::to_string(job->id) + "\nmessage=Error, server is stopping, in Service::Server.\n");
+            }
+            this->finished.wait(guard, [this]() -> bool {
+                return 0 == this->runningJobs;
+            });
+            for (auto& connection : this->connections) {
+                connection->close();
+            }
+            this->finished.wait(guard, [this]() -> bool {
+                return 0 == this->readers;
+            });
+        }
+
+        // 私有，适应度用足够的位数写出
+        static std::string formatNumber(long double value) {
+            std::ostringstream output;
+            output.precision(12);
+            output << value;
+            return output.str();
+        }
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef SERVICE_WORKERPOOL_H
+#define SERVICE_WORKERPOOL_H
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+namespace Service {
+
+    /* 常驻的工作线程
+     *
+     * 线程在构造时创建，之后一直等待任务，按提交的顺序执行，任务之间不再创建线程。析构时
+     * 先执行完已经提交的任务再结束线程。任务不能抛出异常。
+     */
+    class WorkerPool {
+
+    public:
+
+        // 创建 workerNumber 个线程，0 时使用硬件线程数
+        WorkerPool(unsigned long workerNumber) {
+            if (0 == workerNumber) {
+                workerNumber = std::thread::hardware_concurrency();
+            }
+            if (0 == workerNumber) {
+                workerNumber = 1;
+            }
+            for (unsigned long i = 0; i < workerNumber; i++) {
+                this->workers.push_back(std::thread([this]() {
+                    this->work();
+                }));
+            }
+        }
+
+        ~WorkerPool() {
+            {
+                std::lock_guard<std::mutex> guard(this->lock);
+                this->stopping = true;
+            }
+            this->ready.notify_all();
+            for (auto& worker : this->workers) {
+                worker.join();
+            }
+        }
+
+        WorkerPool(const WorkerPool&) = delete;
+
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        // 提交一个任务
+        void post(std::function<void()> task) {
+            {
+                std::lock_guard<std::mutex> guard(this->lock);
+                this->tasks.push_back(std::move(task));
+            }
+            this->ready.notify_one();
+        }
+
+        // 线程数
+        unsigned long getWorkerNumber() {
+            return this->workers.size();
+        }
+
+    private:
+        // 工作线程
+        std::vector<std::thread> workers;
+        // 等待执行的任务
+        std::deque<std::function<void()>> tasks;
+        // 保护 tasks 和 stopping
+        std::mutex lock;
+        // 有新任务或者要结束
+        std::condition_variable ready;
+        // 析构中，执行完剩下的任务就结束
+        bool stopping = false;
+
+        // 私有，工作线程的循环
+        void work() {
+            std::unique_lock<std::mutex> guard(this->lock);
+            while (true) {
+                this->ready.wait(guard, [this]() -> bool {
+                    return this->stopping || !this->tasks.empty();
+                });
+                if (this->tasks.empty()) {
+                    return;
+                }
+                std::function<void()> task = std::move(this->tasks.front());
+                this->tasks.pop_front();
+                guard.unlock();
+                task();
+                guard.lock();
+            }
+        }
+
+    };
+
+}
+
+#endif
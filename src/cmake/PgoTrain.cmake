@@ -0,0 +1,57 @@
+# 运行 PGO 训练负载，由 CMakeLists.txt 里的 GEP.profile 目标以 cmake -P 的方式调用
+#
+# 参数：
+#   COMPILER_ID             编译器，GNU 或者 Clang
+#   INSTRUMENTED            插桩版本的可执行程序
+#   INSTRUMENTED_OBJECT_DIR 插桩版本目标文件所在目录（GCC 在这里生成 .gcda）
+#   PROFILE                 GCC：GEP.out 目标文件所在目录；Clang：合并后的 .profdata 文件
+#   LLVM_PROFDATA           Clang 使用的 llvm-profdata
+#   WORK_DIR                训练负载的工作目录
+
+file(MAKE_DIRECTORY "${WORK_DIR}")
+
+if(COMPILER_ID STREQUAL "GNU")
+    # 先删掉上一次训练留下的计数，否则 GCC 会把多次运行的结果累加起来
+    file(GLOB_RECURSE OLD_PROFILES "${INSTRUMENTED_OBJECT_DIR}/*.gcda" "${PROFILE}/*.gcda")
+    if(OLD_PROFILES)
+        file(REMOVE ${OLD_PROFILES})
+    endif()
+else()
+    file(GLOB OLD_PROFILES "${WORK_DIR}/*.profraw")
+    if(OLD_PROFILES)
+        file(REMOVE ${OLD_PROFILES})
+    endif()
+    set(ENV{LLVM_PROFILE_FILE} "${WORK_DIR}/GEP-%p.profraw")
+endif()
+
+execute_process(
+    COMMAND "${INSTRUMENTED}" workload
+    WORKING_DIRECTORY "${WORK_DIR}"
+    RESULT_VARIABLE WORKLOAD_RESULT
+    OUTPUT_FILE "${WORK_DIR}/workload.log"
+)
+if(NOT WORKLOAD_RESULT EQUAL 0)
+    message(FATAL_ERROR "PGO training workload failed: ${WORKLOAD_RESULT}, see ${WORK_DIR}/workload.log")
+endif()
+
+if(COMPILER_ID STREQUAL "GNU")
+    # .gcda 的文件名跟着目标文件走，按相对路径复制到 GEP.out 的目标文件目录下
+    file(GLOB_RECURSE PROFILES RELATIVE "${INSTRUMENTED_OBJECT_DIR}" "${INSTRUMENTED_OBJECT_DIR}/*.gcda")
+    if(NOT PROFILES)
+        message(FATAL_ERROR "PGO training workload did not produce any .gcda file")
+    endif()
+    foreach(PROFILE_FILE ${PROFILES})
+        get_filename_component(PROFILE_FILE_DIR "${PROFILE}/${PROFILE_FILE}" DIRECTORY)
+        file(MAKE_DIRECTORY "${PROFILE_FILE_DIR}")
+        configure_file("${INSTRUMENTED_OBJECT_DIR}/${PROFILE_FILE}" "${PROFILE}/${PROFILE_FILE}" COPYONLY)
+    endforeach()
+else()
+    file(GLOB RAW_PROFILES "${WORK_DIR}/*.profraw")
+    execute_process(
+        COMMAND "${LLVM_PROFDATA}" merge -output=${PROFILE} ${RAW_PROFILES}
+        RESULT_VARIABLE MERGE_RESULT
+    )
+    if(NOT MERGE_RESULT EQUAL 0)
+        message(FATAL_ERROR "llvm-profdata merge failed: ${MERGE_RESULT}")
+    endif()
+endif()
@@ -4,17 +4,42 @@
  * $ cmake --build .
  *
  */
+#include "GEP.h"
 #include "GeneticAlgorithm/MainProcess.h"
 #include "GeneticAlgorithm/Multithreading.h"
+#include "GeneticAlgorithm/SteadyState.h"
+#include "GeneticAlgorithm/FixedMainProcess.h"
+#include "GeneticAlgorithm/MultiTargetProcess.h"
+#include "Expression/Program.h"
+#include "Expression/CodeGenerator.h"
+#include "Expression/Parser.h"
+#include "Inference/BatchInference.h"
+#include "Benchmark/ScalingBenchmark.h"
+#include "Data/Dataset.h"
+#include "Fitness/Objective.h"
+#include "Fitness/MultiTarget.h"
+#include "Fitness/Screening.h"
+#include "Service/Server.h"
+#include "Service/Client.h"
+#ifdef GEP_ENABLE_NATIVE_KERNEL
+#include "Expression/NativeKernel.h"
+#endif
 #include <random>
 #include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+#include <vector>
+#include <memory>
+#include <map>
+#include <sstream>
 
 using namespace GeneticAlgorithm;
 using namespace std;
 
 int useMainProcess() {
     try {
-        MainProcess mainProcess = MainProcess();
+        MainProcess mainProcess;
         mainProcess.setDebug(true);
         mainProcess.run(
             1000, // 种群大小
@@ -62,11 +87,593 @@ int useMultithreading() {
     return 0;
 }
 
-int main()
+/*
+ * 定长染色体（$ ./GEP.out fixed [长度]）
+ *
+ * 常用的长度 20、50、100 使用编译期长度的 FixedMainProcess ，其它长度退回 MainProcess
+ */
+template<unsigned long N>
+int runFixed() {
+    try {
+        FixedMainProcess<N> mainProcess;
+        mainProcess.setDebug(true);
+        mainProcess.run(1000, 0.0L, 4.0L, 1000, 0.99L, 500, 0.1L);
+    } catch (const char* message) {
+        cout << message << endl;
+    }
+    return 0;
+}
+
+int useFixed(unsigned long length) {
+    switch (length) {
+        case 20:
+            return runFixed<20>();
+        case 50:
+            return runFixed<50>();
+        case 100:
+            return runFixed<100>();
+        default:
+            break;
+    }
+    try {
+        MainProcess mainProcess;
+        mainProcess.setDebug(true);
+        mainProcess.run(1000, length, 0.0L, 4.0L, 1000, 0.99L, 500, 0.1L);
+    } catch (const char* message) {
+        cout << message << endl;
+    }
+    return 0;
+}
+
+/*
+ * 自适应参数（$ ./GEP.out adaptive）
+ *
+ * 每个岛从不同的 (keep, r) 开始，每 5 代按进展在这几组参数中重新选择，变异概率再按
+ * 1/5 成功法则调整，结束后按平均进展列出每组参数
+ */
+int useAdaptive() {
+    try {
+        vector<ParameterSetting> settings = {
+            {30, 0.02L}, // 每次迭代保留的个体数量，变异概率
+            {150, 0.1L},
+            {270, 0.05L},
+            {100, 0.3L}
+        };
+        Multithreading mainProcess = Multithreading(settings.size());
+        mainProcess.setIslandSettings(settings);
+        mainProcess.setParameterArms(settings, 5);
+        mainProcess.setAdaptiveMutation(true);
+        mainProcess.run(300, 20, 1.0L, 4.0L, 10, 0.9999999L, 150, 0.1L);
+        unsigned long loop = 10;
+        while (loop < 2000 && mainProcess.getMaxFitness() < 0.9999999L) {
+            mainProcess.exchange();
+            mainProcess.runContinue(10, 0.9999999L, 150, 0.1L);
+            loop += 10;
+        }
+        cout << "代数<=" << loop << ", 最大适应度=" << mainProcess.getMaxFitness() << ", 个体信息：";
+        mainProcess.getMaxFitnessChromosome()->dump();
+        cout << "keep r 选中次数 代数 平均进展" << endl;
+        for (auto& e : mainProcess.getParameterStatistics()) {
+            cout << e.setting.keep << " " << e.setting.r << " " << e.pulls << " " << e.generations << " " << e.getMeanReward() << endl;
+        }
+        for (unsigned long i = 0; i < settings.size(); i++) {
+            cout << "岛" << i << ": keep=" << mainProcess.getKeep(i) << ", r=" << mainProcess.getMutationRate(i) << endl;
+        }
+    } catch (const char* message) {
+        cout << message << endl;
+    }
+    return 0;
+}
+
+/*
+ * 固定的训练负载，给 PGO 构建使用（$ ./GEP.out workload）
+ *
+ * 随机数种子固定、单线程、适应度不可能达到 stopFitness ，所以每次运行执行的代数和
+ * 计算路径都完全一样，profile 可以重复生成。
+ */
+int useTrainingWorkload() {
+    using GeneticAlgorithm::Utils::GlobalCppRandomEngine;
+    GlobalCppRandomEngine::engine.seed(20210801);
+    try {
+        MainProcess mainProcess;
+        mainProcess.setDebug(false);
+        mainProcess.run(
+            1000, // 种群大小
+            50, // 染色体长度
+            0.0L, // 初始范围
+            4.0L, // 初始范围
+            60, // 最大迭代次数
+            2.0L, // 停止迭代适应度，适应度最大为 1 ，不会提前停止
+            500, // 每次迭代保留多少个上一代的高适应度个体
+            0.1L // 变异概率
+        );
+        mainProcess.runContinue(20, 2.0L, 1, 0.05L); // 覆盖 keep=1 时的分支
+        cout << "Max fitness=" << mainProcess.getMaxFitness() << endl;
+        mainProcess.getMaxFitnessChromosome()->dump();
+    } catch (const char* message) {
+        cout << message << endl;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * 进化后把最优个体导出为 C 函数（$ ./GEP.out export kernel.c [函数名]）
+ */
+int useExport(const string& fileName, const string& functionName) {
+    try {
+        MainProcess mainProcess;
+        mainProcess.setDebug(false);
+        mainProcess.run(1000, 50, 0.0L, 4.0L, 1000, 0.99L, 500, 0.1L);
+        auto chromosome = mainProcess.getMaxFitnessChromosome();
+        chromosome->dump();
+        auto program = chromosome->compile().simplify();
+        ofstream file(fileName.c_str());
+        file << Expression::CodeGenerator().generate(program, functionName);
+        file.close();
+        if (!file) {
+            cout << "Can not write " << fileName << endl;
+            return 1;
+        }
+        cout << "Exported " << functionName << " to " << fileName << endl;
+#ifdef GEP_ENABLE_NATIVE_KERNEL
+        Expression::NativeKernel kernel(program, functionName);
+        vector<long double> variables(program.getVariableNumber(), 0.0L);
+        cout << "Native kernel=" << kernel.call(variables.data()) << endl;
+#endif
+    } catch (const char* message) {
+        cout << message << endl;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * 进化后把最优个体保存到文件（$ ./GEP.out evolve model.txt），可以用于 infer
+ */
+int useEvolve(const string& fileName) {
+    try {
+        MainProcess mainProcess;
+        mainProcess.setDebug(false);
+        mainProcess.run(1000, 50, 0.0L, 4.0L, 1000, 0.99L, 500, 0.1L);
+        mainProcess.getMaxFitnessChromosome()->dump();
+        ofstream file(fileName.c_str());
+        mainProcess.getMaxFitnessChromosome()->save(file);
+        file.close();
+        if (!file) {
+            cout << "Can not write " << fileName << endl;
+            return 1;
+        }
+    } catch (const char* message) {
+        cout << message << endl;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * 按误差和表达式大小两个目标进化，输出帕累托前沿（$ ./GEP.out pareto）
+ */
+int useParetoFront() {
+    try {
+        MainProcess mainProcess;
+        mainProcess.setDebug(false);
+        mainProcess.setMultiObjective(true);
+        mainProcess.run(1000, 50, 0.0L, 4.0L, 300, 2.0L, 500, 0.1L);
+        for (auto chromosome : mainProcess.getParetoFront()) {
+            cout << "size=" << chromosome->getExpressedSize() << ", fitness=" << chromosome->getFitness() << ", ";
+            chromosome->dump();
+        }
+    } catch (const char* message) {
+        cout << message << endl;
+        return 1;
+    }
+    return 0;
+}
+
+// 种子：Chromosome::save() 保存的文件，或者中缀表达式
+Expression::Program loadSeed(const string& seed) {
+    ifstream file(seed.c_str());
+    if (file) {
+        Chromosome* chromosome = ChromosomeFactory().buildFromStream(file);
+        Expression::Program program = chromosome->compile();
+        delete chromosome;
+        return program;
+    }
+    return Expression::Parser::parse(seed);
+}
+
+/*
+ * 在数据集上进化，CSV 的最后一列是目标值
+ * $ ./GEP.out fit data.csv [mse|mae|r2|hits|accuracy] [--header] [--seed 文件或表达式]... [--save model.txt] [--racing 子集行数] [--blocked 线程数] [--shared] [--incremental 预算MiB] [--screen]
+ *
+ * --racing 时新个体先在随机子集上计算，明显比精英差的不再完整计算（ Fitness::RacingEvaluator ）
+ * --blocked 时一代的新个体一起分块计算，线程数为 0 时使用硬件线程数（ Fitness::BlockedEvaluation ）
+ * --shared 时一代的新个体共用相同的子表达式，按块在数据集上计算（ Fitness::scoreStore() ）
+ * --incremental 时每个基因保留每个节点在数据集上的值，点变异后只重新计算一条路径，所有节点
+ *     共用给定的内存预算（ MainProcess::setIncrementalEvaluation() ）
+ * 同时给出几种计算方式时依次以 --racing、--blocked、--shared、--incremental 为准，都不给时每个个体解码后整个计算
+ * --screen 时先用每一列的范围做区间分析，每一行都一定溢出或者是 nan 的个体不计算（ Fitness::ScreenedObjective ）
+ */
+int useFit(int argc, char* argv[]) {
+    try {
+        string objectiveName = "mse", saveFile;
+        bool header = false, racing = false, blocked = false, shared = false, incremental = false, screen = false;
+        unsigned long sampleRows = 0, blockedThreads = 1, incrementalBudget = 0;
+        vector<Expression::Program> seeds;
+        for (int i = 3; i < argc; i++) {
+            if (string("--header") == argv[i]) {
+                header = true;
+            } else if (string("--racing") == argv[i] && i + 1 < argc) {
+                racing = true;
+                sampleRows = strtoul(argv[++i], nullptr, 10);
+            } else if (string("--blocked") == argv[i] && i + 1 < argc) {
+                blocked = true;
+                blockedThreads = strtoul(argv[++i], nullptr, 10);
+            } else if (string("--incremental") == argv[i] && i + 1 < argc) {
+                incrementalBudget = strtoul(argv[++i], nullptr, 10);
+                incremental = true;
+            } else if (string("--shared") == argv[i]) {
+                shared = true;
+            } else if (string("--screen") == argv[i]) {
+                screen = true;
+            } else if (string("--seed") == argv[i] && i + 1 < argc) {
+                seeds.push_back(loadSeed(argv[++i]));
+            } else if (string("--save") == argv[i] && i + 1 < argc) {
+                saveFile = argv[++i];
+            } else {
+                objectiveName = argv[i];
+            }
+        }
+        Data::Dataset dataset = Data::Dataset::fromCsv(argv[2], header);
+        unique_ptr<Fitness::Objective> objective(Fitness::Objective::create(objectiveName, dataset));
+        unique_ptr<Fitness::ScreenedObjective> screened(screen ? new Fitness::ScreenedObjective(*objective) : nullptr);
+        MainProcess mainProcess;
+        mainProcess.setDebug(false);
+        mainProcess.setObjective(screen ? screened.get() : objective.get());
+        mainProcess.setSeeds(seeds);
+        mainProcess.setRacing(racing, sampleRows);
+        mainProcess.setBlockedEvaluation(blocked, blockedThreads);
+        mainProcess.setSharedEvaluation(shared);
+        mainProcess.setIncrementalEvaluation(incremental, incrementalBudget << 20);
+        mainProcess.run(1000, 50, -2.0L, 2.0L, 300, 0.9999L, 500, 0.1L);
+        cout << "Rows=" << dataset.getRowNumber() << ", " << objectiveName << " fitness=" << mainProcess.getMaxFitness()
+            << ", generations=" << mainProcess.getLoopNumber() << endl;
+        if (racing) {
+            Fitness::RacingStatistics statistics = mainProcess.getRacingStatistics();
+            cout << "Racing: candidates=" << statistics.candidates << ", rejected on sample=" << statistics.sampleRejections
+                << ", aborted=" << statistics.earlyAborts << ", full=" << statistics.fullEvaluations
+                << ", rows evaluated=" << statistics.rowsEvaluated << ", rows saved=" << statistics.getRowsSaved() << endl;
+        }
+        if (screen) {
+            Expression::Program program = mainProcess.getMaxFitnessChromosome()->compile();
+            cout << "Screened=" << screened->getScreenedNumber() << ", instructions=" << program.size() << ", simplified="
+                << program.simplify().size() << ", range-aware=" << screened->getAnalysis().simplify(program).size() << endl;
+        }
+        mainProcess.getMaxFitnessChromosome()->dump();
+        if (!saveFile.empty()) {
+            ofstream file(saveFile.c_str());
+            mainProcess.getMaxFitnessChromosome()->save(file);
+            file.close();
+            if (!file) {
+                cout << "Can not write " << saveFile << endl;
+                return 1;
+            }
+        }
+    } catch (const char* message) {
+        cout << message << endl;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * 一个种群同时拟合多个目标值，每个个体只计算一次
+ * $ ./GEP.out targets                     表达式的值逼近 10、20、…、100
+ * $ ./GEP.out targets data.csv 目标值列数 [mse|mae|r2|hits|accuracy] [--header]   CSV 的最后几列是目标值
+ */
+int useMultiTarget(int argc, char* argv[]) {
+    try {
+        vector<string> arguments;
+        bool header = false;
+        for (int i = 2; i < argc; i++) {
+            if (string("--header") == argv[i]) {
+                header = true;
+            } else {
+                arguments.push_back(argv[i]);
+            }
+        }
+        string fileName = arguments.size() > 0 ? arguments[0] : "";
+        unsigned long targetNumber = arguments.size() > 1 ? strtoul(arguments[1].c_str(), nullptr, 10) : 1;
+        string objectiveName = arguments.size() > 2 ? arguments[2] : "mse";
+        Data::Dataset dataset;
+        unique_ptr<Fitness::MultiTargetObjective> objective;
+        if (fileName.empty()) {
+            vector<long double> targets;
+            for (int i = 1; i <= 10; i++) {
+                targets.push_back(10.0L * i);
+            }
+            objective.reset(new Fitness::ConstantTargetObjective(targets));
+        } else {
+            dataset = Data::Dataset::fromCsv(fileName, header, targetNumber);
+            objective.reset(Fitness::MultiTargetObjective::create(objectiveName, dataset));
+        }
+        MultiTargetProcess process;
+        process.setObjective(objective.get());
+        process.run(1000, 50, fileName.empty() ? 0.0L : -2.0L, fileName.empty() ? 10.0L : 2.0L, 300, 0.9999L, 20, 0.1L);
+        cout << "Targets=" << process.getTargetNumber() << ", generations=" << process.getLoopNumber()
+            << ", evaluations=" << process.getEvaluationNumber() << endl;
+        for (unsigned long k = 0; k < process.getTargetNumber(); k++) {
+            cout << "#" << k << " fitness=" << process.getMaxFitness(k) << ", ";
+            process.getMaxFitnessChromosome(k)->dump();
+        }
+        process.setObjective(nullptr);
+    } catch (const char* message) {
+        cout << message << endl;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * 常驻服务，数据集和工作线程留在内存里，在 Unix 域套接字上接收任务，字段见 Service::Server
+ * $ ./GEP.out serve /tmp/gep.sock [工作线程数]
+ */
+int useServer(const string& socketPath, unsigned long workerNumber) {
+    try {
+        Service::Server server(socketPath, workerNumber);
+        server.setDebug(true);
+        cout << "Listening on " << socketPath << endl;
+        server.serve();
+    } catch (const char* message) {
+        cout << message << endl;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * 服务的客户端，打印进度和最优个体
+ * $ ./GEP.out client /tmp/gep.sock data=train.csv metric=r2 cores=2 priority=5 generations=300
+ * $ ./GEP.out client /tmp/gep.sock --status
+ * $ ./GEP.out client /tmp/gep.sock --shutdown
+ */
+int useClient(int argc, char* argv[]) {
+    try {
+        Service::Client client(argv[2]);
+        if (argc > 3 && string("--status") == argv[3]) {
+            cout << Service::Protocol::formatFields(client.getStatus());
+            return 0;
+        }
+        if (argc > 3 && string("--shutdown") == argv[3]) {
+            client.shutdown();
+            return 0;
+        }
+        map<string, string> job;
+        for (int i = 3; i < argc; i++) {
+            string field = argv[i];
+            string::size_type equal = field.find('=');
+            if (string::npos == equal) {
+                cout << "Bad field " << field << ", expect name=value" << endl;
+                return 1;
+            }
+            job[field.substr(0, equal)] = field.substr(equal + 1);
+        }
+        Service::Protocol::Frame result = client.submit(job, [](const Service::Protocol::Frame& frame) {
+            map<string, string> fields = Service::Protocol::parseFields(frame.payload);
+            if (Service::Protocol::ACCEPTED == frame.type) {
+                cout << "Job " << fields["job"] << " accepted" << endl;
+            } else if (Service::Protocol::PROGRESS == frame.type) {
+                cout << "Generation=" << fields["generation"] << ", fitness=" << fields["fitness"] << endl;
+            }
+        });
+        map<string, string> fields = Service::Protocol::parseFields(result.payload);
+        if (Service::Protocol::ERROR == result.type) {
+            cout << fields["message"] << endl;
+            return 1;
+        }
+        cout << "Fitness=" << fields["fitness"] << ", generations=" << fields["generation"]
+            << ", wait=" << fields["wait_ms"] << "ms, run=" << fields["run_ms"] << "ms" << endl;
+        istringstream model(Service::Protocol::getBody(result.payload));
+        unique_ptr<Chromosome> chromosome(ChromosomeFactory().buildFromStream(model));
+        chromosome->dump();
+    } catch (const char* message) {
+        cout << message << endl;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * 稳态进化，多个线程不停地产生新个体替换最差的个体（$ ./GEP.out steady [线程数]）
+ */
+int useSteadyState(unsigned long threadNumber) {
+    try {
+        SteadyState steadyState(threadNumber);
+        steadyState.setDebug(true);
+        steadyState.run(
+            1000, // 种群大小
+            50, // 染色体长度
+            0.0L, // 初始范围
+            4.0L, // 初始范围
+            500000, // 最多计算多少个新个体
+            0.99L, // 停止的适应度
+            0.1L // 变异概率
+        );
+    } catch (const char* message) {
+        cout << message << endl;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * 批量推理
+ * $ ./GEP.out infer model.txt input.csv output.csv [--threads N] [--header] [--binary-input 列数] [--binary-output]
+ */
+int useInference(int argc, char* argv[]) {
+    try {
+        ifstream file(argv[2]);
+        if (!file) {
+            cout << "Can not read " << argv[2] << endl;
+            return 1;
+        }
+        Chromosome* chromosome = ChromosomeFactory().buildFromStream(file);
+        Expression::Program program = chromosome->compile();
+        delete chromosome;
+        unsigned long threadNumber = 0;
+        for (int i = 5; i < argc; i++) {
+            if (string("--threads") == argv[i] && i + 1 < argc) {
+                threadNumber = strtoul(argv[++i], nullptr, 10);
+            }
+        }
+        Inference::BatchInference inference(program, threadNumber);
+        for (int i = 5; i < argc; i++) {
+            if (string("--header") == argv[i]) {
+                inference.setHeader(true);
+            } else if (string("--binary-input") == argv[i] && i + 1 < argc) {
+                inference.setBinaryInput(strtoul(argv[++i], nullptr, 10));
+            } else if (string("--binary-output") == argv[i]) {
+                inference.setBinaryOutput(true);
+            }
+        }
+        cout << "Rows=" << inference.run(argv[3], argv[4]) << endl;
+    } catch (const char* message) {
+        cout << message << endl;
+        return 1;
+    }
+    return 0;
+}
+
+// 逗号分隔的数字列表，例如 1,2,4
+vector<unsigned long> parseList(const string& text) {
+    vector<unsigned long> result;
+    const char* p = text.c_str();
+    char* end;
+    while ('\0' != *p) {
+        result.push_back(strtoul(p, &end, 10));
+        p = ',' == *end ? end + 1 : end;
+        if (end == p && '\0' != *p) {
+            break;
+        }
+    }
+    return result;
+}
+
+/*
+ * 扩展性测试
+ * $ ./GEP.out bench [结果文件] [--threads 1,2,4] [--population 250,1000] [--length 25,50,100] [--generations 20]
+ */
+int useBenchmark(int argc, char* argv[]) {
+    try {
+        Benchmark::ScalingBenchmark benchmark;
+        string fileName;
+        for (int i = 2; i < argc; i++) {
+            if (string("--threads") == argv[i] && i + 1 < argc) {
+                benchmark.setThreads(parseList(argv[++i]));
+            } else if (string("--population") == argv[i] && i + 1 < argc) {
+                benchmark.setPopulations(parseList(argv[++i]));
+            } else if (string("--length") == argv[i] && i + 1 < argc) {
+                benchmark.setLengths(parseList(argv[++i]));
+            } else if (string("--generations") == argv[i] && i + 1 < argc) {
+                benchmark.setGenerations(strtoul(argv[++i], nullptr, 10));
+            } else {
+                fileName = argv[i];
+            }
+        }
+        auto results = benchmark.run(cout);
+        if (!fileName.empty()) {
+            ofstream file(fileName.c_str());
+            Benchmark::ScalingBenchmark::writeHeader(file);
+            for (auto& result : results) {
+                Benchmark::ScalingBenchmark::writeRow(file, result);
+            }
+            file.close();
+            if (!file) {
+                cout << "Can not write " << fileName << endl;
+                return 1;
+            }
+        }
+    } catch (const char* message) {
+        cout << message << endl;
+        return 1;
+    }
+    return 0;
+}
+
+int runCommand(int argc, char* argv[])
 {
     using GeneticAlgorithm::Utils::GlobalCppRandomEngine;
+    if (argc > 1 && string("workload") == argv[1]) {
+        return useTrainingWorkload();
+    }
+    if (argc > 4 && string("infer") == argv[1]) {
+        return useInference(argc, argv);
+    }
+    if (argc > 1 && string("bench") == argv[1]) {
+        return useBenchmark(argc, argv);
+    }
+    if (argc > 2 && string("client") == argv[1]) {
+        return useClient(argc, argv);
+    }
     random_device randomSeed;
     GlobalCppRandomEngine::engine.seed(randomSeed());
+    if (argc > 2 && string("evolve") == argv[1]) {
+        return useEvolve(argv[2]);
+    }
+    if (argc > 1 && string("steady") == argv[1]) {
+        return useSteadyState(argc > 2 ? strtoul(argv[2], nullptr, 10) : 0);
+    }
+    if (argc > 2 && string("serve") == argv[1]) {
+        return useServer(argv[2], argc > 3 ? strtoul(argv[3], nullptr, 10) : 0);
+    }
+    if (argc > 2 && string("fit") == argv[1]) {
+        return useFit(argc, argv);
+    }
+    if (argc > 1 && string("targets") == argv[1]) {
+        return useMultiTarget(argc, argv);
+    }
+    if (argc > 1 && string("multi") == argv[1]) {
+        return useMultithreading();
+    }
+    if (argc > 1 && string("fixed") == argv[1]) {
+        return useFixed(argc > 2 ? strtoul(argv[2], nullptr, 10) : 50);
+    }
+    if (argc > 1 && string("adaptive") == argv[1]) {
+        return useAdaptive();
+    }
+    if (argc > 1 && string("pareto") == argv[1]) {
+        return useParetoFront();
+    }
+    if (argc > 2 && string("export") == argv[1]) {
+        return useExport(argv[2], argc > 3 ? argv[3] : "gep_kernel");
+    }
     return useMainProcess();
-    //return useMultithreading();
+}
+
+/*
+ * 设置了环境变量 GEP_TRACE 时记录每一代每个阶段的时间，结束后写到这个文件，
+ * 用 chrome://tracing 或者 https://ui.perfetto.dev 打开
+ * $ GEP_TRACE=trace.json ./GEP.out multi
+ */
+int main(int argc, char* argv[])
+{
+    using GeneticAlgorithm::Utils::Trace;
+    const char* traceFile = getenv("GEP_TRACE");
+    if (nullptr != traceFile && '\0' != traceFile[0]) {
+        Trace::enable();
+        Trace::setLane(0, "main");
+    }
+    int result = runCommand(argc, argv);
+    if (Trace::isEnabled()) {
+        ofstream file(traceFile);
+        unsigned long events = Trace::write(file);
+        file.close();
+        if (!file) {
+            cout << "Can not write " << traceFile << endl;
+            return 1;
+        }
+        cout << "Trace events=" << events << ", written to " << traceFile << endl;
+    }
+    return result;
 }